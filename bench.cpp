@@ -0,0 +1,326 @@
+// bench.cpp
+// Benchmark harness: times the routing heuristics on generated
+// instances and writes one CSV row per run, so results can be diffed
+// across commits. Run with `make bench`, or directly:
+//
+//     ./bench.out [--max N] [--only SOLVER] [--out FILE] [--rev LABEL]
+//
+// --max caps the instance size (default 1000000), --only runs a single
+// solver, --out names the CSV file (default bench_results.csv) and
+// --rev labels its rows, e.g. with the commit being measured.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include "include/addresses.hpp"
+#include "include/distances.hpp"
+#include "include/metrics.hpp"
+#include "include/neighbors.hpp"
+
+using std::cout;
+using std::string;
+using std::vector;
+
+// candidate neighbors per point for the neighbor-list solvers
+const int BENCH_NEIGHBORS = 8;
+
+// random starts for the multi-start solver
+const int BENCH_STARTS = 8;
+
+/**
+ * Another metric that counts how often it is evaluated. Copies share
+ * the counter, so it also counts inside worker threads. Searches that
+ * run on the k-d tree or the SIMD scans compute distances themselves
+ * and are not counted.
+ */
+template <class Base>
+struct CountingMetric {
+    Base base;
+    std::atomic<long> *count;
+    CountingMetric(std::atomic<long> *count_in = nullptr) : count(count_in) { }
+    double operator()(double x1, double y1, double x2, double y2) const {
+        count->fetch_add(1, std::memory_order_relaxed);
+        return base(x1, y1, x2, y2);
+    }
+    int kernel() const { return base.kernel(); }
+};
+
+// Solvers
+
+enum SolverId {
+    SOLVE_GREEDY,
+    SOLVE_HILBERT,
+    SOLVE_GREEDY_EDGE,
+    SOLVE_OPT2,
+    SOLVE_OPT2_PARALLEL,
+    SOLVE_NEIGHBOR_OPT2,
+    SOLVE_OROPT,
+    SOLVE_HILBERT_OROPT,
+    SOLVE_GREEDY_EDGE_OROPT,
+    SOLVE_MULTISTART,
+    SOLVE_ANNEAL,
+    NUM_SOLVERS
+};
+
+struct SolverInfo {
+    const char *name;
+    int max_size;   // the O(n^2)-per-pass searches stop being practical
+};
+
+const SolverInfo SOLVERS[NUM_SOLVERS] = {
+    { "greedy", 1000000 },
+    { "hilbert", 1000000 },
+    { "greedy_edge", 1000000 },
+    { "greedy+opt2", 10000 },
+    { "greedy+opt2_parallel", 10000 },
+    { "greedy+neighbor_opt2", 1000000 },
+    { "greedy+oropt", 1000000 },
+    { "hilbert+oropt", 1000000 },
+    { "greedy_edge+oropt", 1000000 },
+    { "multistart", 100000 },
+    { "anneal", 100000 },
+};
+
+/**
+ * Runs solver on list under metric, building whatever tables it needs
+ * the same way the bool man_norm members do.
+ */
+template <class Metric>
+AddressList run_solver(int solver, const AddressList &list, const Metric &metric) {
+    bool man_norm = metric.kernel() == KERNEL_MANHATTAN;
+    BasicDistanceProvider<Metric> on_the_fly(list.get_coords(), metric, DIST_ON_THE_FLY);
+    if (solver == SOLVE_MULTISTART) {
+        return list.multistart_route(on_the_fly, BENCH_STARTS);
+    }
+    if (solver == SOLVE_ANNEAL) {
+        return list.anneal_route(on_the_fly);
+    }
+
+    AddressList route;
+    if (solver == SOLVE_HILBERT || solver == SOLVE_HILBERT_OROPT) {
+        route = list.hilbert_route(man_norm);
+    } else if (solver == SOLVE_GREEDY_EDGE || solver == SOLVE_GREEDY_EDGE_OROPT) {
+        route = list.greedy_edge_route(man_norm);
+    } else {
+        route = list.greedy_route(on_the_fly);
+    }
+    if (solver == SOLVE_GREEDY || solver == SOLVE_HILBERT || solver == SOLVE_GREEDY_EDGE) {
+        return route;
+    }
+    if (solver == SOLVE_OPT2 || solver == SOLVE_OPT2_PARALLEL) {
+        BasicDistanceProvider<Metric> dists(route.get_coords(), metric);
+        if (solver == SOLVE_OPT2) {
+            return route.opt2_rearrange(dists, OPT2_FIRST);
+        }
+        return route.opt2_rearrange_parallel(dists);
+    }
+    BasicDistanceProvider<Metric> dists(route.get_coords(), metric, DIST_ON_THE_FLY);
+    NeighborLists nbrs(route.get_coords(), BENCH_NEIGHBORS, man_norm);
+    if (solver == SOLVE_NEIGHBOR_OPT2) {
+        return route.opt2_rearrange(dists, nbrs);
+    }
+    return route.oropt_rearrange(dists, nbrs);
+}
+
+// Instances
+
+enum InstanceKind { UNIFORM, CLUSTERED, GRID, NUM_KINDS };
+
+const char *KIND_NAMES[NUM_KINDS] = { "uniform", "clustered", "grid" };
+
+// side of the square all instances are generated in
+const double BENCH_SIDE = 1e6;
+
+/**
+ * Generates n stops of the given kind, the same ones on every run:
+ * uniform over the square, in Gaussian clusters of about 100 stops,
+ * or on a square lattice. Stops are listed in random order, so the
+ * list itself is no help to the solvers.
+ */
+AddressList make_instance(InstanceKind kind, int n) {
+    std::mt19937 gen(1000003u * kind + n);
+    std::uniform_real_distribution<double> coord(0.0, BENCH_SIDE);
+    vector<Address> addrs;
+    addrs.reserve(n);
+
+    if (kind == UNIFORM) {
+        for (int i = 0; i < n; i++) {
+            addrs.push_back(Address(coord(gen), coord(gen), 0));
+        }
+    } else if (kind == CLUSTERED) {
+        int clusters = std::max(1, n / 100);
+        vector<double> cx(clusters), cy(clusters);
+        for (int c = 0; c < clusters; c++) {
+            cx[c] = coord(gen);
+            cy[c] = coord(gen);
+        }
+        std::uniform_int_distribution<int> pick(0, clusters - 1);
+        std::normal_distribution<double> spread(0.0, BENCH_SIDE / (8.0 * std::sqrt(clusters)));
+        for (int i = 0; i < n; i++) {
+            int c = pick(gen);
+            addrs.push_back(Address(cx[c] + spread(gen), cy[c] + spread(gen), 0));
+        }
+    } else {
+        int side = (int) std::ceil(std::sqrt((double) n));
+        double step = BENCH_SIDE / side;
+        for (int i = 0; i < n; i++) {
+            addrs.push_back(Address((i % side) * step, (i / side) * step, 0));
+        }
+        std::shuffle(addrs.begin(), addrs.end(), gen);
+    }
+
+    AddressList list;
+    list.bulk_add_addresses(addrs);
+    return list;
+}
+
+// Reporting
+
+struct BenchRow {
+    string instance;
+    int n;
+    bool man_norm;
+    string solver;
+    double seconds;
+    long evals;
+    double length;
+    double gap;     // over the shortest route found for the instance
+    double bound_gap;   // over the Held-Karp lower bound, or -1 if not taken
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Times solver on list, then runs it again under a counting metric to
+ * get the number of distance evaluations, so counting does not slow
+ * down the timed run.
+ */
+template <class Metric>
+BenchRow bench_solver(int solver, const AddressList &list, const Metric &metric) {
+    BenchRow row;
+    row.n = list.size();
+    row.man_norm = metric.kernel() == KERNEL_MANHATTAN;
+    row.solver = SOLVERS[solver].name;
+
+    auto start = std::chrono::steady_clock::now();
+    AddressList route = run_solver(solver, list, metric);
+    row.seconds = seconds_since(start);
+    row.length = row.man_norm ? route.man_length() : route.euc_length();
+    if (route.size() != list.size()) {
+        std::cerr << row.solver << " lost stops\n";
+        std::exit(1);
+    }
+
+    std::atomic<long> count(0);
+    run_solver(solver, list, CountingMetric<Metric>(&count));
+    row.evals = count.load();
+    return row;
+}
+
+void print_row(const BenchRow &row) {
+    char line[256], bound[32] = "       -";
+    if (row.bound_gap >= 0) {
+        std::snprintf(bound, sizeof(bound), "%7.2f%%", 100.0 * row.bound_gap);
+    }
+    std::snprintf(line, sizeof(line), "%-10s %8d %-4s %-22s %10.4f %14.3e %12.1f %7.2f%% %s\n",
+                  row.instance.c_str(), row.n, row.man_norm ? "man" : "euc", row.solver.c_str(),
+                  row.seconds, row.evals / std::max(row.seconds, 1e-9), row.length,
+                  100.0 * row.gap, bound);
+    cout << line << std::flush;
+}
+
+void write_row(FILE *out, const string &rev, const BenchRow &row) {
+    char bound[32] = "";
+    if (row.bound_gap >= 0) {
+        std::snprintf(bound, sizeof(bound), "%.6f", row.bound_gap);
+    }
+    std::fprintf(out, "%s,%s,%d,%s,%s,%.6f,%ld,%.6e,%.6f,%.6f,%s\n",
+                 rev.c_str(), row.instance.c_str(), row.n, row.man_norm ? "manhattan" : "euclidean",
+                 row.solver.c_str(), row.seconds, row.evals,
+                 row.evals / std::max(row.seconds, 1e-9), row.length, row.gap, bound);
+}
+
+int main(int argc, char **argv) {
+    int max_size = 1000000;
+    string only, out_path = "bench_results.csv", rev = "unknown";
+    for (int a = 1; a + 1 < argc; a += 2) {
+        string flag = argv[a];
+        if (flag == "--max") {
+            max_size = std::atoi(argv[a + 1]);
+        } else if (flag == "--only") {
+            only = argv[a + 1];
+        } else if (flag == "--out") {
+            out_path = argv[a + 1];
+        } else if (flag == "--rev") {
+            rev = argv[a + 1];
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (rev.empty()) {
+        rev = "unknown";
+    }
+
+    FILE *out = std::fopen(out_path.c_str(), "w");
+    if (!out) {
+        std::cerr << "cannot write " << out_path << "\n";
+        return 1;
+    }
+    std::fprintf(out, "rev,instance,n,norm,solver,seconds,evals,evals_per_s,length,gap,bound_gap\n");
+    cout << "instance          n norm solver                   time (s)       evals/s"
+            "       length     gap   bound\n";
+
+    for (int n = 100; n <= max_size; n *= 10) {
+        for (int kind = 0; kind < NUM_KINDS; kind++) {
+            AddressList list = make_instance((InstanceKind) kind, n);
+            for (int man = 0; man < 2; man++) {
+                vector<BenchRow> rows;
+                for (int solver = 0; solver < NUM_SOLVERS; solver++) {
+                    if (n > SOLVERS[solver].max_size) continue;
+                    if (!only.empty() && only != SOLVERS[solver].name) continue;
+                    if (man) {
+                        rows.push_back(bench_solver(solver, list, ManhattanMetric()));
+                    } else {
+                        rows.push_back(bench_solver(solver, list, EuclideanMetric()));
+                    }
+                    rows.back().instance = KIND_NAMES[kind];
+                }
+
+                double best = std::numeric_limits<double>::infinity();
+                for (const BenchRow &row : rows) {
+                    best = std::min(best, row.length);
+                }
+                // a proven lower bound, where it is cheap enough, says how
+                // far even the best route may be from the shortest
+                LowerBound bound;
+                bool bounded = !rows.empty() && n <= BOUND_EXACT_MAX;
+                if (bounded && man) {
+                    bound = held_karp_bound(list.get_coords(), ManhattanMetric(), false, best);
+                } else if (bounded) {
+                    bound = held_karp_bound(list.get_coords(), EuclideanMetric(), false, best);
+                }
+                for (BenchRow &row : rows) {
+                    row.gap = (best > 0) ? row.length / best - 1.0 : 0.0;
+                    row.bound_gap = (bounded && bound.value > 0) ? bound.gap(row.length) : -1.0;
+                    print_row(row);
+                    write_row(out, rev, row);
+                }
+                std::fflush(out);
+            }
+        }
+    }
+
+    std::fclose(out);
+    cout << "results written to " << out_path << "\n";
+    return 0;
+}
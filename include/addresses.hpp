@@ -1,6 +1,24 @@
 // addresses.hpp
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include "anneal.hpp"
+#include "bound.hpp"
+#include "budget.hpp"
+#include "coords.hpp"
+#include "deadlines.hpp"
+#include "distances.hpp"
+#include "greedy.hpp"
+#include "instance.hpp"
+#include "kdtree.hpp"
+#include "metrics.hpp"
+#include "multistart.hpp"
+#include "neighbors.hpp"
+#include "opt2.hpp"
+#include "oropt.hpp"
+#include "stats.hpp"
 using std::string;
 using std::vector;
 
@@ -24,37 +42,734 @@ class Address {
         string as_string() const;
 };
 
+// Hashes the coordinates of an address. Addresses compare equal when
+// their coordinates do, so this is the key for duplicate detection.
+struct CoordHash {
+    size_t operator()(const std::pair<double, double> &key) const;
+};
+
 class AddressList {
     protected:
         vector<Address> addrs;
-        double vectorial_length(vector<Address> path, bool man_norm) const;
+        CoordStore coords;
+        KdTree index;
+        bool indexed;
+        // every address inserted gets a fixed id; first_id holds the id
+        // of the first of each set of equal addresses, and pos_of and
+        // id_at map ids to indices and back
+        std::unordered_map<std::pair<double, double>, int, CoordHash> first_id;
+        vector<int> id_at, pos_of;
+        void index_inserted(int index, int count);
+        void insert_address(int index, const Address &addr_in);
+        void insert_addresses(int index, const vector<Address> &more_addrs);
+        void insert_instance(int index, const Instance &inst);
+        void erase_addresses(const vector<int> &positions);
+        void reorder_addresses(int first, const vector<int> &order);
+        AddressList permuted(const vector<int> &tour) const;
+        template <class Metric>
+        double vectorial_length(BasicDistanceProvider<Metric> &dists) const;
+        void check_provider(int provider_size) const;
+        virtual vector<double> deadline_times() const;
     public:
         AddressList();
-        virtual void bulk_add_addresses(vector<Address> more_addrs);
+        virtual void bulk_add_addresses(const vector<Address> &more_addrs);
         virtual void add_address(Address addr);
+        virtual void add_instance(const Instance &inst);
         const Address &get_address_at(int index) const;
         const Address &get_final_addr() const;
+        const CoordStore &get_coords() const;
+        virtual void set_precision(CoordPrecision precision, double unit = 1.0);
+        int index_of(const Address &addr) const;
         bool empty() const;
         int size() const;
         double euc_length() const;
         double man_length() const;
+        template <class Metric>
+        double length(BasicDistanceProvider<Metric> &dists) const;
+        void build_spatial_index();
         int euc_index_closest_to(Address addr) const;
         int man_index_closest_to(Address addr) const;
-        AddressList greedy_route(bool man_norm) const;
+        template <class Metric>
+        int index_closest_to(Address addr, const BasicDistanceProvider<Metric> &dists) const;
+        AddressList greedy_route(bool man_norm, SolveStats *stats = nullptr) const;
+        template <class Metric>
+        AddressList greedy_route(BasicDistanceProvider<Metric> &dists, SolveStats *stats = nullptr) const;
+        AddressList hilbert_route(bool man_norm) const;
+        void hilbert_reorder(bool man_norm);
+        AddressList greedy_edge_route(bool man_norm) const;
         string as_string() const;
         AddressList opt2_rearrange(bool man_norm) const;
+        template <class Metric>
+        AddressList opt2_rearrange(BasicDistanceProvider<Metric> &dists) const;
+        AddressList opt2_rearrange(bool man_norm, Opt2Strategy strategy,
+                                   double *final_len = nullptr,
+                                   SolveStats *stats = nullptr,
+                                   const SolveBudget *budget = nullptr,
+                                   bool *converged = nullptr) const;
+        template <class Metric>
+        AddressList opt2_rearrange(BasicDistanceProvider<Metric> &dists, Opt2Strategy strategy,
+                                   double *final_len = nullptr,
+                                   SolveStats *stats = nullptr,
+                                   const SolveBudget *budget = nullptr,
+                                   bool *converged = nullptr) const;
+        AddressList opt2_rearrange_parallel(bool man_norm, int num_threads = 0,
+                                            double *final_len = nullptr,
+                                            const SolveBudget *budget = nullptr,
+                                            bool *converged = nullptr) const;
+        template <class Metric>
+        AddressList opt2_rearrange_parallel(BasicDistanceProvider<Metric> &dists, int num_threads = 0,
+                                            double *final_len = nullptr,
+                                            const SolveBudget *budget = nullptr,
+                                            bool *converged = nullptr) const;
+        AddressList opt2_rearrange(bool man_norm, const NeighborLists &nbrs,
+                                   const SolveBudget *budget = nullptr,
+                                   bool *converged = nullptr) const;
+        template <class Metric>
+        AddressList opt2_rearrange(BasicDistanceProvider<Metric> &dists,
+                                   const NeighborLists &nbrs,
+                                   const SolveBudget *budget = nullptr,
+                                   bool *converged = nullptr) const;
+        AddressList oropt_rearrange(bool man_norm, const NeighborLists &nbrs,
+                                    const SolveBudget *budget = nullptr,
+                                    bool *converged = nullptr) const;
+        template <class Metric>
+        AddressList oropt_rearrange(BasicDistanceProvider<Metric> &dists,
+                                    const NeighborLists &nbrs,
+                                    const SolveBudget *budget = nullptr,
+                                    bool *converged = nullptr) const;
+        AddressList multistart_route(bool man_norm, int starts, int num_threads = 0,
+                                     unsigned seed = 1) const;
+        template <class Metric>
+        AddressList multistart_route(const BasicDistanceProvider<Metric> &dists, int starts,
+                                     int num_threads = 0, unsigned seed = 1) const;
+        AddressList anneal_route(bool man_norm, int replicas = 4, int sweeps = 100,
+                                 unsigned seed = 1, int num_threads = 0,
+                                 const SolveBudget *budget = nullptr) const;
+        template <class Metric>
+        AddressList anneal_route(const BasicDistanceProvider<Metric> &dists, int replicas = 4,
+                                 int sweeps = 100, unsigned seed = 1, int num_threads = 0,
+                                 const SolveBudget *budget = nullptr) const;
+        double lateness(bool man_norm, int *late_count = nullptr) const;
+        template <class Metric>
+        double lateness(BasicDistanceProvider<Metric> &dists, int *late_count = nullptr) const;
+        AddressList deadline_route(bool man_norm) const;
+        template <class Metric>
+        AddressList deadline_route(BasicDistanceProvider<Metric> &dists) const;
+        AddressList deadline_rearrange(bool man_norm) const;
+        template <class Metric>
+        AddressList deadline_rearrange(BasicDistanceProvider<Metric> &dists) const;
+        LowerBound lower_bound(bool man_norm, double target_gap = 0.0,
+                               int max_iters = BOUND_MAX_ITERS,
+                               const SolveBudget *budget = nullptr) const;
+        template <class Metric>
+        LowerBound lower_bound(BasicDistanceProvider<Metric> &dists, double target_gap = 0.0,
+                               int max_iters = BOUND_MAX_ITERS,
+                               const SolveBudget *budget = nullptr) const;
 };
 
+// nearby stops whose route edges insert_cheapest() considers
+const int INSERT_NEIGHBORS = 8;
+
+// stops on either side of a new one that insert_cheapest() reorders
+const int INSERT_REPAIR_RADIUS = 10;
+
 class Route : public AddressList {
+    private:
+        // k-d tree over the stops as of its last rebuild, plus those
+        // inserted since; see insert_cheapest()
+        CoordStore tree_coords, pending_coords;
+        KdTree insert_tree;
+        vector<int> insert_candidates(const Address &addr, bool man_norm);
+        void repair_around(int pos, bool man_norm);
+        Route permuted(const vector<int> &tour) const;
+    protected:
+        virtual vector<double> deadline_times() const override;
     public:
         Route(int depot_delivery_date);
         Route(Address startDepot, Address endDepot);
         virtual void add_address(Address addr) override;
-        virtual void bulk_add_addresses(vector<Address> more_addrs) override;
+        virtual void bulk_add_addresses(const vector<Address> &more_addrs) override;
+        virtual void add_instance(const Instance &inst) override;
         void add_unique_address(Address addr);
+        void insert_cheapest(Address addr, bool man_norm);
+        void remove_stops(const vector<int> &positions, bool man_norm);
+        virtual void set_precision(CoordPrecision precision, double unit = 1.0) override;
         const Address &get_final_nondepot() const;
-        Route greedy_route(bool man_norm) const;
+        Route greedy_route(bool man_norm, SolveStats *stats = nullptr) const;
+        template <class Metric>
+        Route greedy_route(BasicDistanceProvider<Metric> &dists, SolveStats *stats = nullptr) const;
+        Route hilbert_route(bool man_norm) const;
+        void hilbert_reorder(bool man_norm);
+        Route greedy_edge_route(bool man_norm) const;
         Route opt2_rearrange(bool man_norm) const;
+        template <class Metric>
+        Route opt2_rearrange(BasicDistanceProvider<Metric> &dists) const;
+        Route opt2_rearrange(bool man_norm, Opt2Strategy strategy,
+                             double *final_len = nullptr, SolveStats *stats = nullptr,
+                             const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        template <class Metric>
+        Route opt2_rearrange(BasicDistanceProvider<Metric> &dists, Opt2Strategy strategy,
+                             double *final_len = nullptr, SolveStats *stats = nullptr,
+                             const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        Route opt2_rearrange_parallel(bool man_norm, int num_threads = 0,
+                                      double *final_len = nullptr,
+                                      const SolveBudget *budget = nullptr,
+                                      bool *converged = nullptr) const;
+        template <class Metric>
+        Route opt2_rearrange_parallel(BasicDistanceProvider<Metric> &dists, int num_threads = 0,
+                                      double *final_len = nullptr,
+                                      const SolveBudget *budget = nullptr,
+                                      bool *converged = nullptr) const;
+        Route opt2_rearrange(bool man_norm, const NeighborLists &nbrs,
+                             const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        template <class Metric>
+        Route opt2_rearrange(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                             const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        Route oropt_rearrange(bool man_norm, const NeighborLists &nbrs,
+                              const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        template <class Metric>
+        Route oropt_rearrange(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                              const SolveBudget *budget = nullptr, bool *converged = nullptr) const;
+        Route multistart_route(bool man_norm, int starts, int num_threads = 0,
+                               unsigned seed = 1) const;
+        template <class Metric>
+        Route multistart_route(const BasicDistanceProvider<Metric> &dists, int starts,
+                               int num_threads = 0, unsigned seed = 1) const;
+        Route anneal_route(bool man_norm, int replicas = 4, int sweeps = 100, unsigned seed = 1,
+                           int num_threads = 0, const SolveBudget *budget = nullptr) const;
+        template <class Metric>
+        Route anneal_route(const BasicDistanceProvider<Metric> &dists, int replicas = 4,
+                           int sweeps = 100, unsigned seed = 1, int num_threads = 0,
+                           const SolveBudget *budget = nullptr) const;
+        Route deadline_route(bool man_norm) const;
+        template <class Metric>
+        Route deadline_route(BasicDistanceProvider<Metric> &dists) const;
+        Route deadline_rearrange(bool man_norm) const;
+        template <class Metric>
+        Route deadline_rearrange(BasicDistanceProvider<Metric> &dists) const;
+        LowerBound lower_bound(bool man_norm, double target_gap = 0.0,
+                               int max_iters = BOUND_MAX_ITERS,
+                               const SolveBudget *budget = nullptr) const;
+        template <class Metric>
+        LowerBound lower_bound(BasicDistanceProvider<Metric> &dists, double target_gap = 0.0,
+                               int max_iters = BOUND_MAX_ITERS,
+                               const SolveBudget *budget = nullptr) const;
 };
 
+// Members taking a distance provider are templates over its metric, so
+// the heuristics are compiled once per metric with the distance inlined.
+// The bool man_norm versions in addresses.cpp forward to these.
+
+/**
+ * Sums the distances between consecutive addresses, as given by dists.
+ */
+template <class Metric>
+double AddressList::vectorial_length(BasicDistanceProvider<Metric> &dists) const {
+    double sum_len = 0.0;
+
+    for (int i = 1; i < (int) addrs.size(); i++) {
+        sum_len += dists.dist(i-1, i);
+    }
+
+    return sum_len;
+}
+
+/**
+ * Returns the length of the list under the metric of dists, which
+ * must have been built over this list's coordinates.
+ * Throws std::invalid_argument if dists is for a different size of list.
+ */
+template <class Metric>
+double AddressList::length(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    return vectorial_length(dists);
+}
+
+/**
+ * Returns the index of the address closest to addr under the metric
+ * of dists, which must have been built over this list's coordinates.
+ * Ties go to the lowest index; returns -1 if the list is empty.
+ */
+template <class Metric>
+int AddressList::index_closest_to(Address addr, const BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    return dists.index_closest_to(addr.get_x(), addr.get_y());
+}
+
+/**
+ * As greedy_route(bool, stats), with distances taken from dists, which
+ * must have been built over this list's coordinates.
+ * Throws std::invalid_argument if dists is for a different size of list.
+ */
+template <class Metric>
+AddressList AddressList::greedy_route(BasicDistanceProvider<Metric> &dists,
+                                      SolveStats *stats) const {
+    check_provider(dists.size());
+    PhaseTimer timer(stats, PHASE_CONSTRUCT);
+    // construct route starting with first address in list,
+    // using locally closest address at each step
+    // time complexity O(n log n) via k-d tree, O(n^2) for small lists
+    if (addrs.size() <= 2) {
+        AddressList path = *this;
+        return path;
+    }
+
+    STATS_ONLY(long evals_before = dists.evaluations();)
+    vector<int> tour(1, 0);
+    vector<int> order = nearest_neighbor_order(dists, 0, 1, addrs.size());
+    STATS_ADD(stats, dist_evals, dists.evaluations() - evals_before);
+    tour.insert(tour.end(), order.begin(), order.end());
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange(bool), with distances taken from dists, which must
+ * have been built over this list's coordinates.
+ * Throws std::invalid_argument if dists is for a different size of list.
+ */
+template <class Metric>
+AddressList AddressList::opt2_rearrange(BasicDistanceProvider<Metric> &dists) const {
+    return opt2_rearrange(dists, OPT2_FIRST);
+}
+
+/**
+ * As opt2_rearrange(bool, strategy, final_len, stats, budget, converged),
+ * with distances taken from dists, which must have been built over this
+ * list's coordinates.
+ */
+template <class Metric>
+AddressList AddressList::opt2_rearrange(BasicDistanceProvider<Metric> &dists,
+                                        Opt2Strategy strategy, double *final_len,
+                                        SolveStats *stats, const SolveBudget *budget,
+                                        bool *converged) const {
+    check_provider(dists.size());
+    PhaseTimer timer(stats, PHASE_IMPROVE);
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    Opt2Result result = opt2_improve(dists, tour, false, strategy, stats, budget);
+    if (final_len) {
+        *final_len = result.length;
+    }
+    if (converged) {
+        *converged = result.converged;
+    }
+
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange_parallel(bool, num_threads, final_len, budget,
+ * converged), with distances taken from dists, which must have been
+ * built over this list's coordinates.
+ */
+template <class Metric>
+AddressList AddressList::opt2_rearrange_parallel(BasicDistanceProvider<Metric> &dists,
+                                                 int num_threads, double *final_len,
+                                                 const SolveBudget *budget,
+                                                 bool *converged) const {
+    check_provider(dists.size());
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    Opt2Result result = opt2_parallel_improve(dists, tour, false, num_threads, budget);
+    if (final_len) {
+        *final_len = result.length;
+    }
+    if (converged) {
+        *converged = result.converged;
+    }
+
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange(bool, nbrs, budget, converged), with distances
+ * taken from dists, which must have been built over this list's
+ * coordinates.
+ */
+template <class Metric>
+AddressList AddressList::opt2_rearrange(BasicDistanceProvider<Metric> &dists,
+                                        const NeighborLists &nbrs, const SolveBudget *budget,
+                                        bool *converged) const {
+    check_provider(dists.size());
+    if (nbrs.size() != (int) addrs.size()) {
+        throw std::invalid_argument("neighbor lists do not match address list");
+    }
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    opt2_neighbor_improve(dists, nbrs, tour, false, budget, converged);
+
+    return permuted(tour);
+}
+
+/**
+ * As oropt_rearrange(bool, nbrs, budget, converged), with distances
+ * taken from dists, which must have been built over this list's
+ * coordinates.
+ */
+template <class Metric>
+AddressList AddressList::oropt_rearrange(BasicDistanceProvider<Metric> &dists,
+                                         const NeighborLists &nbrs, const SolveBudget *budget,
+                                         bool *converged) const {
+    check_provider(dists.size());
+    if (nbrs.size() != (int) addrs.size()) {
+        throw std::invalid_argument("neighbor lists do not match address list");
+    }
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    oropt_improve(dists, nbrs, tour, false, budget, converged);
+
+    return permuted(tour);
+}
+
+/**
+ * As multistart_route(bool, starts, num_threads, seed), under the metric
+ * of dists, which must have been built over this list's coordinates.
+ * Only the metric is used; each worker computes distances on the fly.
+ */
+template <class Metric>
+AddressList AddressList::multistart_route(const BasicDistanceProvider<Metric> &dists, int starts,
+                                          int num_threads, unsigned seed) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 2) {
+        AddressList path = *this;
+        return path;
+    }
+
+    vector<int> tour = multistart_tour(coords, dists.get_metric(), false,
+                                       starts, num_threads, seed, nullptr);
+    return permuted(tour);
+}
+
+/**
+ * As anneal_route(bool, replicas, sweeps, seed, num_threads, budget),
+ * under the metric of dists, which must have been built over this
+ * list's coordinates. Only the metric is used; each replica computes
+ * distances on the fly.
+ */
+template <class Metric>
+AddressList AddressList::anneal_route(const BasicDistanceProvider<Metric> &dists, int replicas,
+                                      int sweeps, unsigned seed, int num_threads,
+                                      const SolveBudget *budget) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 2) {
+        AddressList path = *this;
+        return path;
+    }
+
+    vector<int> tour = anneal_tour(coords, dists.get_metric(), false, replicas, sweeps,
+                                   seed, num_threads, budget, nullptr);
+    return permuted(tour);
+}
+
+/**
+ * As lower_bound(bool, target_gap, max_iters, budget), under the metric
+ * of dists, which must have been built over this list's coordinates.
+ */
+template <class Metric>
+LowerBound AddressList::lower_bound(BasicDistanceProvider<Metric> &dists, double target_gap,
+                                    int max_iters, const SolveBudget *budget) const {
+    check_provider(dists.size());
+    return held_karp_bound(coords, dists.get_metric(), false, vectorial_length(dists),
+                           target_gap, max_iters, budget);
+}
+
+/**
+ * As lateness(bool, late_count), with travel times taken from dists,
+ * which must have been built over this list's coordinates.
+ */
+template <class Metric>
+double AddressList::lateness(BasicDistanceProvider<Metric> &dists, int *late_count) const {
+    check_provider(dists.size());
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    return path_lateness(dists, deadline_times(), tour, late_count);
+}
+
+/**
+ * As deadline_route(bool), with travel times taken from dists, which
+ * must have been built over this list's coordinates.
+ */
+template <class Metric>
+AddressList AddressList::deadline_route(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 2) {
+        AddressList path = *this;
+        return path;
+    }
+
+    vector<double> due = deadline_times();
+    vector<int> tour(1, 0);
+    vector<int> order = deadline_order(dists, due, 0, 1, addrs.size());
+    tour.insert(tour.end(), order.begin(), order.end());
+    deadline_improve(dists, due, tour, false);
+    return permuted(tour);
+}
+
+/**
+ * As deadline_rearrange(bool), with travel times taken from dists,
+ * which must have been built over this list's coordinates.
+ */
+template <class Metric>
+AddressList AddressList::deadline_rearrange(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    deadline_improve(dists, deadline_times(), tour, false);
+
+    return permuted(tour);
+}
+
+/**
+ * As greedy_route(bool, stats), with distances taken from dists, which
+ * must have been built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::greedy_route(BasicDistanceProvider<Metric> &dists, SolveStats *stats) const {
+    check_provider(dists.size());
+    PhaseTimer timer(stats, PHASE_CONSTRUCT);
+    // same as AddressList version, but preserve position of final depot
+    // time complexity O(n log n) via k-d tree, O(n^2) for small routes
+    STATS_ONLY(long evals_before = dists.evaluations();)
+    vector<int> tour(1, 0);
+    vector<int> order = nearest_neighbor_order(dists, 0, 1, addrs.size() - 1);
+    STATS_ADD(stats, dist_evals, dists.evaluations() - evals_before);
+    tour.insert(tour.end(), order.begin(), order.end());
+    tour.push_back(addrs.size() - 1);
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange(bool), with distances taken from dists, which must
+ * have been built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::opt2_rearrange(BasicDistanceProvider<Metric> &dists) const {
+    return opt2_rearrange(dists, OPT2_FIRST);
+}
+
+/**
+ * As opt2_rearrange(bool, strategy, final_len, stats, budget, converged),
+ * with distances taken from dists, which must have been built over this
+ * route's coordinates.
+ */
+template <class Metric>
+Route Route::opt2_rearrange(BasicDistanceProvider<Metric> &dists, Opt2Strategy strategy,
+                            double *final_len, SolveStats *stats, const SolveBudget *budget,
+                            bool *converged) const {
+    check_provider(dists.size());
+    PhaseTimer timer(stats, PHASE_IMPROVE);
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    Opt2Result result = opt2_improve(dists, tour, true, strategy, stats, budget);
+    if (final_len) {
+        *final_len = result.length;
+    }
+    if (converged) {
+        *converged = result.converged;
+    }
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange_parallel(bool, num_threads, final_len, budget,
+ * converged), with distances taken from dists, which must have been
+ * built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::opt2_rearrange_parallel(BasicDistanceProvider<Metric> &dists, int num_threads,
+                                     double *final_len, const SolveBudget *budget,
+                                     bool *converged) const {
+    check_provider(dists.size());
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    Opt2Result result = opt2_parallel_improve(dists, tour, true, num_threads, budget);
+    if (final_len) {
+        *final_len = result.length;
+    }
+    if (converged) {
+        *converged = result.converged;
+    }
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    return permuted(tour);
+}
+
+/**
+ * As opt2_rearrange(bool, nbrs, budget, converged), with distances
+ * taken from dists, which must have been built over this route's
+ * coordinates.
+ */
+template <class Metric>
+Route Route::opt2_rearrange(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                            const SolveBudget *budget, bool *converged) const {
+    check_provider(dists.size());
+    if (nbrs.size() != (int) addrs.size()) {
+        throw std::invalid_argument("neighbor lists do not match route");
+    }
+    if (converged) {
+        *converged = true;
+    }
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    opt2_neighbor_improve(dists, nbrs, tour, true, budget, converged);
+
+    return permuted(tour);
+}
+
+/**
+ * As oropt_rearrange(bool, nbrs, budget, converged), with distances
+ * taken from dists, which must have been built over this route's
+ * coordinates.
+ */
+template <class Metric>
+Route Route::oropt_rearrange(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                             const SolveBudget *budget, bool *converged) const {
+    check_provider(dists.size());
+    if (nbrs.size() != (int) addrs.size()) {
+        throw std::invalid_argument("neighbor lists do not match route");
+    }
+    if (converged) {
+        *converged = true;
+    }
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    oropt_improve(dists, nbrs, tour, true, budget, converged);
+
+    return permuted(tour);
+}
+
+/**
+ * As multistart_route(bool, starts, num_threads, seed), under the metric
+ * of dists, which must have been built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::multistart_route(const BasicDistanceProvider<Metric> &dists, int starts,
+                              int num_threads, unsigned seed) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<int> tour = multistart_tour(coords, dists.get_metric(), true,
+                                       starts, num_threads, seed, nullptr);
+    return permuted(tour);
+}
+
+/**
+ * As anneal_route(bool, replicas, sweeps, seed, num_threads, budget),
+ * under the metric of dists, which must have been built over this
+ * route's coordinates.
+ */
+template <class Metric>
+Route Route::anneal_route(const BasicDistanceProvider<Metric> &dists, int replicas, int sweeps,
+                          unsigned seed, int num_threads, const SolveBudget *budget) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<int> tour = anneal_tour(coords, dists.get_metric(), true, replicas, sweeps,
+                                   seed, num_threads, budget, nullptr);
+    return permuted(tour);
+}
+
+/**
+ * As lower_bound(bool, target_gap, max_iters, budget), under the metric
+ * of dists, which must have been built over this route's coordinates.
+ */
+template <class Metric>
+LowerBound Route::lower_bound(BasicDistanceProvider<Metric> &dists, double target_gap,
+                              int max_iters, const SolveBudget *budget) const {
+    check_provider(dists.size());
+    return held_karp_bound(coords, dists.get_metric(), true, vectorial_length(dists),
+                           target_gap, max_iters, budget);
+}
+
+/**
+ * As deadline_route(bool), with travel times taken from dists, which
+ * must have been built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::deadline_route(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<double> due = deadline_times();
+    vector<int> tour(1, 0);
+    vector<int> order = deadline_order(dists, due, 0, 1, addrs.size() - 1);
+    tour.insert(tour.end(), order.begin(), order.end());
+    tour.push_back(addrs.size() - 1);
+    deadline_improve(dists, due, tour, true);
+
+    return permuted(tour);
+}
+
+/**
+ * As deadline_rearrange(bool), with travel times taken from dists,
+ * which must have been built over this route's coordinates.
+ */
+template <class Metric>
+Route Route::deadline_rearrange(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    if (addrs.size() <= 3) {
+        Route ret = *this;
+        return ret;
+    }
+
+    vector<int> tour(addrs.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    deadline_improve(dists, deadline_times(), tour, true);
+
+    return permuted(tour);
+}
+
 #endif
@@ -0,0 +1,269 @@
+// anneal.hpp
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include "budget.hpp"
+#include "coords.hpp"
+#include "distances.hpp"
+#include "multistart.hpp"
+#include "neighbors.hpp"
+#include "oropt.hpp"
+#include "pool.hpp"
+#include "tour.hpp"
+using std::vector;
+
+#ifndef ANNEAL_HPP
+#define ANNEAL_HPP
+
+// candidate neighbors per point that annealing moves link to
+const int ANNEAL_NEIGHBORS = 8;
+
+// sweeps each replica makes between exchanges of temperatures
+const int ANNEAL_SWAP_SWEEPS = 5;
+
+// starting temperatures of the hottest and the coldest replica, as
+// fractions of the average edge of the starting tour
+const double ANNEAL_HOT = 0.3;
+const double ANNEAL_COLD = 0.01;
+
+// every temperature cools geometrically to this fraction of its start
+const double ANNEAL_END_SCALE = 0.05;
+
+/**
+ * One simulated annealing chain. It holds its own tour as a CyclicTour,
+ * closed through a phantom city as in OrOptSearch, and its own random
+ * generator. Each step picks a city a and one of its listed neighbors
+ * c and proposes, at random, either the 2-opt move that makes them
+ * adjacent or moving a next to c (a relocate move). Both are evaluated
+ * in O(1) from the edges they change; a move that lengthens the tour
+ * by delta is accepted with probability exp(-delta / temperature).
+ */
+template <class Metric>
+class AnnealReplica {
+    private:
+        BasicDistanceProvider<Metric> dists;
+        const NeighborLists &nbrs;
+        bool fixed_ends;
+        int phantom;
+        int first_city;
+        CyclicTour cyc;
+        std::mt19937 gen;
+        double length;
+
+        double len(int a, int b) {
+            return (a == phantom || b == phantom) ? 0.0 : dists.dist(a, b);
+        }
+        bool breakable(int a, int b) const {
+            return !fixed_ends || (a != phantom && b != phantom);
+        }
+        void try_2opt(int a, int c, bool forward, double limit);
+        void try_relocate(int a, int c, bool after, double limit);
+        double measure();
+    public:
+        AnnealReplica(const CoordStore &coords, const Metric &metric, const NeighborLists &nbrs_in,
+                      const vector<int> &tour, bool fixed_ends_in, unsigned seed);
+        void run(long steps, double temp, const SolveBudget *budget);
+        double get_length() const { return length; }
+        vector<int> path() const;
+};
+
+template <class Metric>
+AnnealReplica<Metric>::AnnealReplica(const CoordStore &coords, const Metric &metric,
+                                     const NeighborLists &nbrs_in, const vector<int> &tour,
+                                     bool fixed_ends_in, unsigned seed)
+    : dists(coords, metric, DIST_ON_THE_FLY), nbrs(nbrs_in), fixed_ends(fixed_ends_in),
+      phantom(coords.size()), first_city(tour.empty() ? -1 : tour[0]), gen(seed) {
+    vector<int> cities(tour);
+    cities.push_back(phantom);
+    cyc = CyclicTour(cities, phantom + 1);
+    length = measure();
+}
+
+/**
+ * Replaces the edges (a, b) and (c, d) by (a, c) and (b, d), where b
+ * and d follow a and c in the direction given by forward.
+ */
+template <class Metric>
+void AnnealReplica<Metric>::try_2opt(int a, int c, bool forward, double limit) {
+    int b = forward ? cyc.next(a) : cyc.prev(a);
+    int d = forward ? cyc.next(c) : cyc.prev(c);
+    if (c == b || d == a || !breakable(a, b) || !breakable(c, d)) return;
+
+    double delta = len(a, c) + len(b, d) - len(a, b) - len(c, d);
+    if (delta <= limit) {
+        cyc.exchange(a, b, c, d);
+        length += delta;
+    }
+}
+
+/**
+ * Moves a from between p and nx to between u and v = next(u), where
+ * u is c if after is true and prev(c) otherwise.
+ */
+template <class Metric>
+void AnnealReplica<Metric>::try_relocate(int a, int c, bool after, double limit) {
+    int p = cyc.prev(a), nx = cyc.next(a);
+    int u = after ? c : cyc.prev(c);
+    int v = cyc.next(u);
+    if (u == p || u == a || !breakable(p, a) || !breakable(a, nx) || !breakable(u, v)) return;
+
+    double delta = len(p, nx) - len(p, a) - len(a, nx) + len(u, a) + len(a, v) - len(u, v);
+    if (delta <= limit) {
+        // as in OrOptSearch::try_segment() for a segment of one
+        cyc.exchange(p, a, u, v);
+        cyc.exchange(p, u, nx, a);
+        length += delta;
+    }
+}
+
+template <class Metric>
+double AnnealReplica<Metric>::measure() {
+    double sum_len = 0.0;
+    int city = phantom;
+    for (int k = 0; k < cyc.size(); k++) {
+        int next = cyc.next(city);
+        sum_len += len(city, next);
+        city = next;
+    }
+    return sum_len;
+}
+
+/**
+ * Makes steps proposals at temperature temp, or fewer if budget, when
+ * not null, runs out. The tour length is then measured afresh, so
+ * rounding does not pile up over many steps.
+ */
+template <class Metric>
+void AnnealReplica<Metric>::run(long steps, double temp, const SolveBudget *budget) {
+    if (phantom < 4 || nbrs.per_point() == 0) return;
+    std::uniform_int_distribution<int> pick_city(0, phantom - 1);
+    std::uniform_int_distribution<int> pick_nbr(0, nbrs.per_point() - 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    for (long s = 0; s < steps; s++) {
+        if (budget && s % BUDGET_CHECK_INTERVAL == 0 && budget->expired()) break;
+        int a = pick_city(gen);
+        int c = nbrs.of(a)[pick_nbr(gen)];
+        // accepting delta <= limit has probability exp(-delta / temp)
+        double limit = -temp * std::log(1.0 - unit(gen));
+        unsigned bits = gen();
+        if (bits & 1) {
+            try_2opt(a, c, bits & 2, limit);
+        } else {
+            try_relocate(a, c, bits & 2, limit);
+        }
+    }
+    length = measure();
+}
+
+/**
+ * Returns the tour as an open path. With fixed_ends the path begins
+ * where the original one did.
+ */
+template <class Metric>
+vector<int> AnnealReplica<Metric>::path() const {
+    vector<int> cities = cyc.walk_from(phantom);
+    cities.erase(cities.begin());
+    if (fixed_ends && !cities.empty() && cities.front() != first_city) {
+        std::reverse(cities.begin(), cities.end());
+    }
+    return cities;
+}
+
+/**
+ * Simulated annealing with parallel tempering over the points of
+ * coords. The greedy tour, shortened by OrOptSearch, seeds replicas
+ * chains (see AnnealReplica) held at a geometric ladder of temperatures
+ * from ANNEAL_HOT to ANNEAL_COLD times the average edge. The chains run
+ * side by side on a WorkPool of num_threads threads (0 for one per
+ * hardware thread). Every ANNEAL_SWAP_SWEEPS sweeps of n steps they
+ * stop, and chains at neighboring temperatures trade places with the
+ * Metropolis probability, so good tours found while hot work their way
+ * down to be refined cold. The whole ladder cools to ANNEAL_END_SCALE
+ * of its start over the given number of sweeps.
+ *
+ * The shortest tour seen at the end of any round, after a final
+ * OrOptSearch, is returned as an open path. Each chain's generator is
+ * seeded from seed and its index, and trades are drawn from a generator
+ * seeded with seed, so the same seed gives the same tour whatever the
+ * thread count, unless budget, if not null, runs out first. If best_len
+ * is not null, the length of the returned tour is stored there.
+ */
+template <class Metric>
+vector<int> anneal_tour(const CoordStore &coords, const Metric &metric, bool fixed_ends,
+                        int replicas, int sweeps, unsigned seed, int num_threads,
+                        const SolveBudget *budget, double *best_len) {
+    int n = coords.size();
+    replicas = std::max(1, replicas);
+    NeighborLists nbrs(coords, ANNEAL_NEIGHBORS, metric.kernel() == KERNEL_MANHATTAN);
+    BasicDistanceProvider<Metric> dists(coords, metric, DIST_ON_THE_FLY);
+    vector<int> best_tour = multistart_construct(dists, fixed_ends, -1);
+    oropt_improve(dists, nbrs, best_tour, fixed_ends, budget);
+    double best = path_length(dists, best_tour);
+
+    int rounds = (std::max(0, sweeps) + ANNEAL_SWAP_SWEEPS - 1) / ANNEAL_SWAP_SWEEPS;
+    if (n >= 5 && rounds > 0 && best > 0.0) {
+        vector<std::unique_ptr<AnnealReplica<Metric> > > chains;
+        for (int r = 0; r < replicas; r++) {
+            chains.emplace_back(new AnnealReplica<Metric>(coords, metric, nbrs, best_tour,
+                                                          fixed_ends, seed + 7919u * (r + 1)));
+        }
+        // ladder[k] is the temperature of rung k, coldest first, and
+        // chain_at[k] the chain standing on it
+        double avg_edge = best / (n - 1);
+        vector<double> ladder(replicas);
+        vector<int> chain_at(replicas);
+        for (int k = 0; k < replicas; k++) {
+            double frac = (replicas > 1) ? (double) k / (replicas - 1) : 0.0;
+            ladder[k] = avg_edge * ANNEAL_COLD * std::pow(ANNEAL_HOT / ANNEAL_COLD, frac);
+            chain_at[k] = k;
+        }
+
+        std::mt19937 trades(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        WorkPool pool(num_threads);
+        long steps = (long) ANNEAL_SWAP_SWEEPS * n;
+        for (int round = 0; round < rounds; round++) {
+            if (budget && budget->expired()) break;
+            double scale = (rounds > 1) ? std::pow(ANNEAL_END_SCALE, (double) round / (rounds - 1))
+                                        : ANNEAL_END_SCALE;
+            for (int k = 0; k < replicas; k++) {
+                AnnealReplica<Metric> *chain = chains[chain_at[k]].get();
+                double temp = ladder[k] * scale;
+                pool.submit([chain, steps, temp, budget]() {
+                    chain->run(steps, temp, budget);
+                });
+            }
+            pool.wait();
+
+            for (int k = 0; k < replicas; k++) {
+                const AnnealReplica<Metric> &chain = *chains[chain_at[k]];
+                if (chain.get_length() < best - OPT2_MIN_GAIN) {
+                    best = chain.get_length();
+                    best_tour = chain.path();
+                }
+            }
+            // trade alternate pairs of rungs, so every pair gets a turn
+            for (int k = round % 2; k + 1 < replicas; k += 2) {
+                double e_cold = chains[chain_at[k]]->get_length();
+                double e_hot = chains[chain_at[k + 1]]->get_length();
+                double x = (e_cold - e_hot) * (1.0 / (ladder[k] * scale) - 1.0 / (ladder[k + 1] * scale));
+                if (x >= 0.0 || unit(trades) < std::exp(x)) {
+                    std::swap(chain_at[k], chain_at[k + 1]);
+                }
+            }
+        }
+        oropt_improve(dists, nbrs, best_tour, fixed_ends, budget);
+        best = path_length(dists, best_tour);
+    }
+
+    if (best_len) {
+        *best_len = best;
+    }
+    return best_tour;
+}
+
+#endif
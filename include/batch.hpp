@@ -0,0 +1,67 @@
+// batch.hpp
+#include <vector>
+#include "addresses.hpp"
+#include "stats.hpp"
+using std::vector;
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+// routes are grouped into tasks of about this many stops, so that a
+// plan of many small routes does not pay for a task per route
+const int BATCH_CHUNK_STOPS = 1024;
+
+// candidate neighbors per stop for the neighbor-list searches
+const int BATCH_NEIGHBORS = 8;
+
+// How solve_batch() builds a first route from each input route.
+enum BatchConstruct {
+    BATCH_KEEP,          // start from the route as given
+    BATCH_GREEDY,        // Route::greedy_route()
+    BATCH_GREEDY_EDGE,   // Route::greedy_edge_route()
+    BATCH_HILBERT        // Route::hilbert_route()
+};
+
+// How solve_batch() then improves it.
+enum BatchImprove {
+    BATCH_NO_IMPROVE,
+    BATCH_OPT2,            // Route::opt2_rearrange(), exhaustive
+    BATCH_NEIGHBOR_OPT2,   // Route::opt2_rearrange() over neighbor lists
+    BATCH_OROPT            // Route::oropt_rearrange()
+};
+
+/**
+ * The steps solve_batch() applies to every route. If route_seconds is
+ * positive, the improvement of each route stops after that long.
+ */
+struct BatchPipeline {
+    BatchConstruct construct;
+    BatchImprove improve;
+    bool man_norm;
+    double route_seconds;
+
+    BatchPipeline(BatchConstruct construct_in = BATCH_GREEDY, BatchImprove improve_in = BATCH_OPT2,
+                  bool man_norm_in = false, double route_seconds_in = 0.0)
+        : construct(construct_in), improve(improve_in), man_norm(man_norm_in),
+          route_seconds(route_seconds_in) { }
+};
+
+// What solve_batch() did with one route.
+struct BatchRouteStats {
+    int stops;              // including the depots
+    double start_length;    // of the route as given
+    double length;          // of the route returned
+    double seconds;         // spent on this route
+    bool converged;         // the improvement reached a local optimum
+    bool kept_input;        // nothing shorter was found, so the input stands
+    SolveStats solver;      // counts, in builds with ROUTE_STATS
+
+    BatchRouteStats()
+        : stops(0), start_length(0.0), length(0.0), seconds(0.0),
+          converged(true), kept_input(true) { }
+};
+
+vector<BatchRouteStats> solve_batch(vector<Route> &routes, const BatchPipeline &pipeline,
+                                    int num_threads = 0);
+
+#endif
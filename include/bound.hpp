@@ -0,0 +1,347 @@
+// bound.hpp
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "budget.hpp"
+#include "coords.hpp"
+#include "distances.hpp"
+#include "greedy.hpp"
+#include "neighbors.hpp"
+using std::vector;
+
+#ifndef BOUND_HPP
+#define BOUND_HPP
+
+// candidate neighbors per point whose edges the bound's trees may use
+const int BOUND_NEIGHBORS = 10;
+
+// subgradient steps taken by default
+const int BOUND_MAX_ITERS = 100;
+
+// the step size is halved after this many steps without a better bound
+const int BOUND_STALL = 5;
+
+// up to this many points the final tree is checked against every edge,
+// in O(n^2), which makes the bound certain
+const int BOUND_EXACT_MAX = 10000;
+
+/**
+ * A lower bound on the length of any route through a set of points,
+ * from held_karp_bound(). If proven is false, the bound was only taken
+ * over candidate edges, and is an estimate that may be slightly high.
+ */
+struct LowerBound {
+    double value;
+    int iterations;
+    bool proven;
+
+    LowerBound() : value(0.0), iterations(0), proven(true) { }
+
+    // how much longer than the bound a route of this length is, as a
+    // fraction of the bound
+    double gap(double length) const {
+        if (value <= 0.0) {
+            return (length > 0.0) ? std::numeric_limits<double>::infinity() : 0.0;
+        }
+        return length / value - 1.0;
+    }
+};
+
+/**
+ * Edges and penalties for the Held-Karp ascent over open paths. Adding
+ * a penalty pi[i] to each edge at point i, for every one of its
+ * target_deg[i] edges, and taking the penalties back off changes the
+ * length of no path, so the shortest tree of the right kind under the
+ * penalized lengths, less the sum of pi[i] * target_deg[i], never
+ * exceeds the shortest path. The ascent raises pi where the tree has
+ * too many edges and lowers it where it has too few, which pushes the
+ * tree towards a path and the bound up.
+ *
+ * With fixed ends the path runs from point 0 to the last point. It is
+ * a spanning tree in which those two have degree 1 and every other
+ * point degree 2, so the trees are minimum spanning trees. Otherwise
+ * both ends are free: a phantom point joined to every point by edges
+ * that cost nothing closes the path into a tour, in which every point
+ * has degree 2, and the trees are the 1-trees of the bound for closed
+ * tours, a minimum spanning tree of the points plus the phantom's two
+ * cheapest edges.
+ */
+template <class Metric>
+class HeldKarpAscent {
+    private:
+        struct Edge {
+            int a, b;
+            double len;
+        };
+        BasicDistanceProvider<Metric> dists;
+        int n, nodes;             // points, and points plus any phantom
+        bool fixed_ends;
+        vector<Edge> edges;       // between points, never the phantom
+        vector<int> target_deg;
+        vector<int> order, parent, degree;
+        bool allowed(int a, int b) const;
+        int root(int i);
+        double phantom_edges();
+    public:
+        vector<double> pi;
+        HeldKarpAscent(const CoordStore &coords, const Metric &metric, bool fixed_ends_in,
+                       const vector<int> &path);
+        double tree_bound(bool *is_path);
+        void step(double distance);
+        double exact_bound();
+};
+
+template <class Metric>
+HeldKarpAscent<Metric>::HeldKarpAscent(const CoordStore &coords, const Metric &metric,
+                                       bool fixed_ends_in, const vector<int> &path)
+    : dists(coords, metric, DIST_ON_THE_FLY), n(coords.size()),
+      nodes(fixed_ends_in ? coords.size() : coords.size() + 1), fixed_ends(fixed_ends_in),
+      target_deg(nodes, 2), parent(nodes), degree(nodes), pi(nodes, 0.0) {
+    if (fixed_ends) {
+        target_deg[0] = 1;
+        target_deg[n - 1] = 1;
+    }
+
+    // the neighbor lists, and a path through every point so that the
+    // candidates always connect
+    NeighborLists nbrs(coords, BOUND_NEIGHBORS, metric.kernel() == KERNEL_MANHATTAN);
+    for (int i = 0; i < n; i++) {
+        for (int t = 0; t < nbrs.per_point(); t++) {
+            int j = nbrs.of(i)[t];
+            edges.push_back(Edge{ std::min(i, j), std::max(i, j), 0.0 });
+        }
+    }
+    for (int p = 1; p < (int) path.size(); p++) {
+        edges.push_back(Edge{ std::min(path[p-1], path[p]), std::max(path[p-1], path[p]), 0.0 });
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge &x, const Edge &y) {
+        return x.a < y.a || (x.a == y.a && x.b < y.b);
+    });
+    vector<Edge> kept;
+    for (const Edge &e : edges) {
+        if (!kept.empty() && kept.back().a == e.a && kept.back().b == e.b) continue;
+        if (!allowed(e.a, e.b)) continue;
+        double len = dists.dist(e.a, e.b);
+        if (std::isfinite(len)) {
+            kept.push_back(Edge{ e.a, e.b, len });
+        }
+    }
+    edges.swap(kept);
+    order.resize(edges.size());
+}
+
+/**
+ * Whether a path can use the edge (a, b), with a < b: fixed ends are
+ * never joined directly unless they are the only two points.
+ */
+template <class Metric>
+bool HeldKarpAscent<Metric>::allowed(int a, int b) const {
+    return !(fixed_ends && a == 0 && b == n - 1 && n > 2);
+}
+
+template <class Metric>
+int HeldKarpAscent<Metric>::root(int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/**
+ * With free ends, joins the phantom to the two points whose edges to
+ * it are cheapest under the penalties, counting the degrees, and
+ * returns the penalized cost of the two edges. With fixed ends there
+ * is no phantom, and it returns 0.
+ */
+template <class Metric>
+double HeldKarpAscent<Metric>::phantom_edges() {
+    if (fixed_ends) return 0.0;
+    int first = -1, second = -1;
+    for (int i = 0; i < n; i++) {
+        if (first < 0 || pi[i] < pi[first]) {
+            second = first;
+            first = i;
+        } else if (second < 0 || pi[i] < pi[second]) {
+            second = i;
+        }
+    }
+    degree[first]++;
+    degree[second]++;
+    degree[n] = 2;
+    return 2 * pi[n] + pi[first] + pi[second];
+}
+
+/**
+ * Returns the bound from the minimum spanning tree over the candidate
+ * edges under the current penalties, found with Kruskal's algorithm,
+ * and any phantom edges, leaving the degree of each point in the tree
+ * in degree. is_path is set to whether every point has its target
+ * degree, in which case the tree is a shortest path over the
+ * candidates.
+ */
+template <class Metric>
+double HeldKarpAscent<Metric>::tree_bound(bool *is_path) {
+    for (int e = 0; e < (int) edges.size(); e++) {
+        order[e] = e;
+    }
+    vector<double> cost(edges.size());
+    for (int e = 0; e < (int) edges.size(); e++) {
+        cost[e] = edges[e].len + pi[edges[e].a] + pi[edges[e].b];
+    }
+    std::sort(order.begin(), order.end(), [&cost](int x, int y) {
+        return cost[x] < cost[y] || (cost[x] == cost[y] && x < y);
+    });
+
+    for (int i = 0; i < nodes; i++) {
+        parent[i] = i;
+        degree[i] = 0;
+    }
+    double total = 0.0;
+    int joined = 0;
+    for (int e : order) {
+        int ra = root(edges[e].a), rb = root(edges[e].b);
+        if (ra == rb) continue;
+        parent[ra] = rb;
+        degree[edges[e].a]++;
+        degree[edges[e].b]++;
+        total += cost[e];
+        if (++joined == n - 1) break;
+    }
+    total += phantom_edges();
+
+    *is_path = joined == n - 1;
+    for (int i = 0; i < nodes; i++) {
+        total -= pi[i] * target_deg[i];
+        *is_path = *is_path && degree[i] == target_deg[i];
+    }
+    // candidates that do not connect the points (some coordinates are
+    // not finite) bound nothing
+    return (joined == n - 1) ? total : 0.0;
+}
+
+/**
+ * Moves the penalties along the subgradient of the last tree_bound(),
+ * the excess degree of each point, by distance over its squared norm.
+ */
+template <class Metric>
+void HeldKarpAscent<Metric>::step(double distance) {
+    double norm2 = 0.0;
+    for (int i = 0; i < nodes; i++) {
+        double excess = degree[i] - target_deg[i];
+        norm2 += excess * excess;
+    }
+    if (norm2 == 0.0) return;
+    for (int i = 0; i < nodes; i++) {
+        pi[i] += distance / norm2 * (degree[i] - target_deg[i]);
+    }
+}
+
+/**
+ * Returns the bound from the minimum spanning tree over every allowed
+ * edge under the current penalties, found with Prim's algorithm in
+ * O(n^2) time and O(n) memory, and any phantom edges.
+ */
+template <class Metric>
+double HeldKarpAscent<Metric>::exact_bound() {
+    const double inf = std::numeric_limits<double>::infinity();
+    vector<double> key(n, inf);
+    vector<char> in_tree(n, 0);
+    double total = 0.0;
+    int curr = 0;
+    in_tree[0] = 1;
+    for (int added = 1; added < n; added++) {
+        int next = -1;
+        for (int i = 0; i < n; i++) {
+            if (in_tree[i]) continue;
+            int a = std::min(curr, i), b = std::max(curr, i);
+            if (allowed(a, b)) {
+                double cost = dists.dist(a, b) + pi[a] + pi[b];
+                if (cost < key[i]) {
+                    key[i] = cost;
+                }
+            }
+            if (next < 0 || key[i] < key[next]) {
+                next = i;
+            }
+        }
+        if (!(key[next] < inf)) return 0.0;
+        total += key[next];
+        in_tree[next] = 1;
+        curr = next;
+    }
+    total += phantom_edges();
+    for (int i = 0; i < nodes; i++) {
+        total -= pi[i] * target_deg[i];
+    }
+    return total;
+}
+
+/**
+ * Returns a lower bound on the length of any open path through all
+ * points of coords, starting anywhere and ending anywhere, or with
+ * fixed_ends from point 0 to the last point, by Held-Karp subgradient
+ * ascent (see
+ * HeldKarpAscent) over the edges to each point's BOUND_NEIGHBORS nearest
+ * neighbors. Each of up to max_iters steps takes O(n log n) time.
+ *
+ * upper is the length of a known path, such as the route being judged.
+ * It sets the step sizes (Polyak's rule), and the ascent stops early
+ * once the bound is within target_gap of it, or once budget, if not
+ * null, is spent. An upper of 0 or less means the length of the
+ * greedy-edge path is used instead.
+ *
+ * Up to BOUND_EXACT_MAX points, the best penalties are checked once
+ * more over all edges, so the bound is proven. Beyond that, it holds
+ * for paths over the candidate edges, which in practice include the
+ * shortest, but it is not guaranteed.
+ */
+template <class Metric>
+LowerBound held_karp_bound(const CoordStore &coords, const Metric &metric, bool fixed_ends,
+                           double upper, double target_gap = 0.0,
+                           int max_iters = BOUND_MAX_ITERS, const SolveBudget *budget = nullptr) {
+    LowerBound result;
+    int n = coords.size();
+    if (n < 2) return result;
+
+    vector<int> path = greedy_edge_path(coords, fixed_ends, metric.kernel() == KERNEL_MANHATTAN);
+    HeldKarpAscent<Metric> ascent(coords, metric, fixed_ends, path);
+    if (!(upper > 0.0)) {
+        BasicDistanceProvider<Metric> dists(coords, metric, DIST_ON_THE_FLY);
+        upper = 0.0;
+        for (int p = 1; p < n; p++) {
+            upper += dists.dist(path[p-1], path[p]);
+        }
+    }
+
+    double best = -std::numeric_limits<double>::infinity();
+    vector<double> best_pi(ascent.pi);
+    double scale = 2.0;
+    int stalled = 0;
+    for (int iter = 0; iter < max_iters; iter++) {
+        if (budget && budget->expired()) break;
+        bool is_path = false;
+        double value = ascent.tree_bound(&is_path);
+        result.iterations++;
+        if (value > best) {
+            best = value;
+            best_pi = ascent.pi;
+            stalled = 0;
+        } else if (++stalled >= BOUND_STALL) {
+            scale /= 2;
+            stalled = 0;
+        }
+        if (is_path || upper <= best * (1.0 + target_gap) || scale < 1e-4) break;
+        ascent.step(scale * (upper - value));
+    }
+    if (result.iterations == 0) return result;
+
+    ascent.pi = best_pi;
+    result.proven = n <= BOUND_EXACT_MAX && !(budget && budget->expired());
+    result.value = result.proven ? ascent.exact_bound() : best;
+    result.value = std::max(result.value, 0.0);
+    return result;
+}
+
+#endif
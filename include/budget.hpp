@@ -0,0 +1,67 @@
+// budget.hpp
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+// Limits on the local searches, for callers that need an answer within
+// a fixed time, or only one good enough. A search handed a SolveBudget
+// checks it as it goes and, once it is spent, stops after the move in
+// hand and returns the route it has reached, which is never longer than
+// the one it started from, saying that it did not converge.
+
+// the queue-driven searches check the budget once per this many cities
+const int BUDGET_CHECK_INTERVAL = 256;
+
+/**
+ * A wall-clock limit, a limit on the moves applied, and a cancellation
+ * flag, any of which can be left out. The clock starts when the budget
+ * is made, so one budget can cover several searches in a row, or
+ * searches on several threads. cancel, if given, may be set from any
+ * thread and must outlive every search using the budget.
+ *
+ * A target length may also be set, typically a lower bound times one
+ * plus the optimality gap that is good enough (see bound.hpp); a search
+ * stops once its route is no longer than that.
+ */
+class SolveBudget {
+    private:
+        std::chrono::steady_clock::time_point stop_at;
+        bool timed;
+        long max_moves;
+        const std::atomic<bool> *cancel;
+        double stop_length;
+    public:
+        // seconds and max_moves of 0 or less mean no limit
+        SolveBudget(double seconds = 0.0, long max_moves_in = 0,
+                    const std::atomic<bool> *cancel_in = nullptr)
+            : stop_at(std::chrono::steady_clock::now() +
+                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(seconds > 0.0 ? seconds : 0.0))),
+              timed(seconds > 0.0), max_moves(max_moves_in), cancel(cancel_in),
+              stop_length(-std::numeric_limits<double>::infinity()) { }
+
+        // out of time, or cancelled
+        bool expired() const {
+            if (cancel && cancel->load(std::memory_order_relaxed)) return true;
+            return timed && std::chrono::steady_clock::now() >= stop_at;
+        }
+        // a search that has applied moves moves may apply no more
+        bool moves_spent(long moves) const {
+            return max_moves > 0 && moves >= max_moves;
+        }
+        void set_target_length(double length) {
+            stop_length = length;
+        }
+        bool has_target() const {
+            return stop_length > -std::numeric_limits<double>::infinity();
+        }
+        // a search whose route is length long may stop
+        bool target_reached(double length) const {
+            return length <= stop_length;
+        }
+};
+
+#endif
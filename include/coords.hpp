@@ -0,0 +1,114 @@
+// coords.hpp
+#include <cstdint>
+#include <memory>
+#include <vector>
+using std::vector;
+
+#ifndef COORDS_HPP
+#define COORDS_HPP
+
+// How finely a CoordStore keeps coordinates. Coordinates are always
+// read back as doubles; the other precisions round every value stored,
+// and keep a 32-bit copy that nearest-point scans read instead, which
+// halves the memory they stream through.
+//
+// COORD_FLOAT32 rounds to the nearest float. Scans then compare in
+// single precision, so of two points whose distances agree to about
+// seven digits either may be found nearest, though always the same one.
+//
+// COORD_FIXED rounds to the nearest multiple of a grid unit, as TSPLIB
+// instances lie on an integer grid. With a unit that is a power of two
+// (such as the default 1), grid coordinates, their differences and
+// squared distances are exact, so Manhattan lengths and every
+// nearest-point comparison are exact; RoundedEuclideanMetric gives the
+// matching TSPLIB Euclidean distances.
+enum CoordPrecision {
+    COORD_DOUBLE,
+    COORD_FLOAT32,
+    COORD_FIXED
+};
+
+// largest grid coordinate, in units, that COORD_FIXED can hold exactly
+const int64_t FIXED_COORD_LIMIT = (int64_t) 1 << 25;
+
+/**
+ * Structure-of-arrays store for address coordinates. The x and y
+ * values are kept in two contiguous arrays so that distance scans
+ * can stream through them with vector loads instead of striding
+ * over whole Address objects.
+ *
+ * A store can also be a view of arrays kept elsewhere, such as a
+ * memory-mapped instance file, held alive by a shared owner. Views
+ * are read without copying; the first change to one copies it into
+ * the store's own arrays.
+ */
+class CoordStore {
+    private:
+        vector<double> xs, ys;
+        std::shared_ptr<const void> owner;   // set while this is a view
+        const double *view_xs, *view_ys;
+        int view_size;
+        CoordPrecision precision;
+        double unit;
+        // the 32-bit copy of the coordinates that scans read: floats
+        // with COORD_FLOAT32, or grid coordinates with COORD_FIXED
+        vector<float> narrow_xs, narrow_ys;
+        vector<int32_t> grid_xs, grid_ys;
+        void detach();
+        void narrow(int index, int count);
+    public:
+        CoordStore();
+        CoordStore(std::shared_ptr<const void> owner_in, const double *xs_in,
+                   const double *ys_in, int n);
+        bool is_view() const;
+        void reserve(int n);
+        void clear();
+        void push_back(double x, double y);
+        void insert(int index, double x, double y);
+        void insert(int index, const vector<double> &more_xs,
+                    const vector<double> &more_ys);
+        void set(int index, double x, double y);
+        int size() const;
+        double x_at(int index) const;
+        double y_at(int index) const;
+        const double *x_data() const;
+        const double *y_data() const;
+        void set_precision(CoordPrecision precision_in, double unit_in = 1.0);
+        CoordPrecision get_precision() const;
+        double get_unit() const;
+        double round(double value) const;
+        int nearest(double qx, double qy, bool man_norm) const;
+};
+
+// Nearest-point kernels over n contiguous coordinates.
+// Each returns the index of the point closest to (qx, qy), with ties
+// going to the lowest index, or -1 if no point is closer than infinity.
+// Points with an infinite coordinate are therefore never selected, which
+// callers use to mask out entries without branching in the scan.
+// The AVX and SSE2 paths are chosen at compile time; the scalar loop is
+// the fallback and also handles the tail of each scan.
+
+int argmin_sq_euclidean(const double *xs, const double *ys, int n,
+                        double qx, double qy);
+int argmin_manhattan(const double *xs, const double *ys, int n,
+                     double qx, double qy);
+
+// The same over single-precision coordinates, computed in single
+// precision with twice the lanes per vector.
+
+int argmin_sq_euclidean(const float *xs, const float *ys, int n,
+                        float qx, float qy);
+int argmin_manhattan(const float *xs, const float *ys, int n,
+                     float qx, float qy);
+
+// The same over grid coordinates, whose distances are computed exactly.
+// Points at GRID_NONE (not finite before rounding) are never selected.
+
+const int32_t GRID_NONE = INT32_MIN;
+
+int argmin_sq_euclidean(const int32_t *xs, const int32_t *ys, int n,
+                        int32_t qx, int32_t qy);
+int argmin_manhattan(const int32_t *xs, const int32_t *ys, int n,
+                     int32_t qx, int32_t qy);
+
+#endif
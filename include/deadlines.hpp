@@ -0,0 +1,287 @@
+// deadlines.hpp
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "coords.hpp"
+#include "distances.hpp"
+#include "greedy.hpp"
+#include "opt2.hpp"
+using std::vector;
+
+#ifndef DEADLINES_HPP
+#define DEADLINES_HPP
+
+// Deadline-aware routing. A tour is an open path of point indices, as
+// for the 2-opt engines, driven from its first point starting at time
+// 0; the arrival time at a point is the provider's distance travelled
+// to reach it, so a ScaledMetric provider turns distance into time.
+// due[c] is the deadline of point c, or infinity if it has none.
+
+/**
+ * Total lateness of tour: the sum over its points of how long after
+ * its deadline each is reached. If late_count is not null, the number
+ * of late points is stored there.
+ */
+template <class Provider>
+double path_lateness(Provider &dists, const vector<double> &due, const vector<int> &tour,
+                     int *late_count) {
+    double arrival = 0.0, late = 0.0;
+    int count = 0;
+    for (int p = 0; p < (int) tour.size(); p++) {
+        if (p > 0) {
+            arrival += dists.dist(tour[p-1], tour[p]);
+        }
+        if (arrival > due[tour[p]]) {
+            late += arrival - due[tour[p]];
+            count++;
+        }
+    }
+    if (late_count) {
+        *late_count = count;
+    }
+    return late;
+}
+
+/**
+ * Earliest-deadline-first visiting order of the points with indices in
+ * [first, last), starting from the point at index start. Points are
+ * taken in order of deadline; points sharing a deadline are visited in
+ * nearest-neighbor order from wherever the previous group ended.
+ */
+template <class Metric>
+vector<int> deadline_order(BasicDistanceProvider<Metric> &dists, const vector<double> &due,
+                           int start, int first, int last) {
+    vector<int> by_due;
+    for (int i = first; i < last; i++) {
+        by_due.push_back(i);
+    }
+    std::stable_sort(by_due.begin(), by_due.end(),
+                     [&due](int a, int b) { return due[a] < due[b]; });
+
+    const CoordStore &coords = dists.get_coords();
+    vector<int> order;
+    order.reserve(last - first);
+    int curr = start;
+    for (int lo = 0; lo < (int) by_due.size(); ) {
+        int hi = lo + 1;
+        while (hi < (int) by_due.size() && due[by_due[hi]] == due[by_due[lo]]) hi++;
+
+        // the group, behind the current point, as a store of its own
+        CoordStore group;
+        group.reserve(hi - lo + 1);
+        group.push_back(coords.x_at(curr), coords.y_at(curr));
+        for (int k = lo; k < hi; k++) {
+            group.push_back(coords.x_at(by_due[k]), coords.y_at(by_due[k]));
+        }
+        BasicDistanceProvider<Metric> group_dists(group, dists.get_metric(), DIST_ON_THE_FLY);
+        vector<int> group_order = nearest_neighbor_order(group_dists, 0, 1, hi - lo + 1);
+        for (int ind : group_order) {
+            order.push_back(by_due[lo + ind - 1]);
+        }
+        curr = order.back();
+        lo = hi;
+    }
+    return order;
+}
+
+/**
+ * Exhaustive 2-opt and relocate search that never lets a point become
+ * later than it already is. Each point's effective deadline is the
+ * later of its deadline and its arrival time in the starting tour, and
+ * a move is only applied if every point still meets its effective
+ * deadline, so points on time stay on time and late points get no
+ * later.
+ *
+ * Feasibility is checked in O(1) per move. slack[p] is how much later
+ * the point at position p could be reached, and suffix_slack[p] the
+ * least slack from p to the end: a part of the tour that keeps its
+ * order but is reached delta later is feasible if delta is at most its
+ * least slack. Parts scanned in a loop keep their least slack as a
+ * running minimum. A reversed part runs backwards, so it is feasible if
+ * its new arrival time plus cum at its far end is at most the least
+ * eff + cum over it, which is also kept as a running minimum.
+ *
+ * The first position never moves; the last only moves if fixed_ends
+ * is false.
+ */
+template <class Provider>
+class DeadlineSearch {
+    private:
+        Provider &dists;
+        vector<int> &tour;
+        bool fixed_ends;
+        int n;
+        vector<double> eff;            // effective deadline of each point
+        vector<double> cum;            // arrival time at each position
+        vector<double> slack;          // eff - cum at each position
+        vector<double> suffix_slack;   // least slack from each position on
+        vector<double> prev_row, curr_row;
+        void refresh();
+        bool try_2opt(int i);
+        bool try_relocate(int a);
+    public:
+        DeadlineSearch(Provider &dists_in, const vector<double> &due, vector<int> &tour_in,
+                       bool fixed_ends_in);
+        Opt2Result run();
+};
+
+template <class Provider>
+DeadlineSearch<Provider>::DeadlineSearch(Provider &dists_in, const vector<double> &due,
+                                         vector<int> &tour_in, bool fixed_ends_in)
+    : dists(dists_in), tour(tour_in), fixed_ends(fixed_ends_in), n(tour_in.size()),
+      eff(due), prev_row(dists_in.size()), curr_row(dists_in.size()) {
+    refresh();
+    for (int p = 0; p < n; p++) {
+        eff[tour[p]] = std::max(due[tour[p]], cum[p]);
+    }
+    refresh();
+}
+
+/**
+ * Recomputes arrival times and slacks after the tour changed.
+ */
+template <class Provider>
+void DeadlineSearch<Provider>::refresh() {
+    cum.assign(n, 0.0);
+    slack.assign(n, 0.0);
+    suffix_slack.assign(n + 1, std::numeric_limits<double>::infinity());
+    for (int p = 1; p < n; p++) {
+        cum[p] = cum[p-1] + dists.dist(tour[p-1], tour[p]);
+    }
+    for (int p = n - 1; p >= 0; p--) {
+        slack[p] = eff[tour[p]] - cum[p];
+        suffix_slack[p] = std::min(slack[p], suffix_slack[p+1]);
+    }
+}
+
+/**
+ * Tries reversing tour[i..j] for every j > i.
+ */
+template <class Provider>
+bool DeadlineSearch<Provider>::try_2opt(int i) {
+    int hi_lim = fixed_ends ? n - 2 : n - 1;
+    if (i >= hi_lim) return false;
+    dists.copy_row(tour[i-1], prev_row.data());
+    dists.copy_row(tour[i], curr_row.data());
+
+    double back_min = eff[tour[i]] + cum[i];
+    for (int j = i + 1; j <= hi_lim; j++) {
+        back_min = std::min(back_min, eff[tour[j]] + cum[j]);
+        double gain = dists.dist(tour[i-1], tour[i]) - prev_row[tour[j]];
+        if (j < n - 1) {
+            gain += dists.dist(tour[j], tour[j+1]) - curr_row[tour[j+1]];
+        }
+        if (gain <= OPT2_MIN_GAIN) continue;
+
+        // tour[j] is now reached first, and the rest of the part after it
+        double reach = cum[i-1] + prev_row[tour[j]];
+        if (reach + cum[j] > back_min) continue;
+        if (j < n - 1) {
+            double next_reach = reach + (cum[j] - cum[i]) + curr_row[tour[j+1]];
+            if (next_reach - cum[j+1] > suffix_slack[j+1]) continue;
+        }
+
+        std::reverse(tour.begin() + i, tour.begin() + j + 1);
+        refresh();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Tries moving the point at position a between every other pair of
+ * adjacent positions (or to the end, if that is free).
+ */
+template <class Provider>
+bool DeadlineSearch<Provider>::try_relocate(int a) {
+    int a_lim = fixed_ends ? n - 2 : n - 1;
+    if (a > a_lim) return false;
+    int s = tour[a], p = tour[a-1];
+    bool has_next = a + 1 < n;
+    int nx = has_next ? tour[a+1] : -1;
+    dists.copy_row(s, curr_row.data());
+    double removal = curr_row[p] + (has_next ? curr_row[nx] - dists.dist(p, nx) : 0.0);
+    int u_lim = fixed_ends ? n - 2 : n - 1;
+
+    // later: tour[a+1..u] is reached delta_mid earlier, then s, then the rest
+    if (has_next) {
+        double delta_mid = dists.dist(p, nx) - (cum[a+1] - cum[a-1]);
+        double mid_slack = std::numeric_limits<double>::infinity();
+        for (int u = a + 1; u <= u_lim; u++) {
+            mid_slack = std::min(mid_slack, slack[u]);
+            if (delta_mid > mid_slack) break;
+
+            bool has_v = u + 1 < n;
+            double insertion = curr_row[tour[u]];
+            if (has_v) {
+                insertion += curr_row[tour[u+1]] - dists.dist(tour[u], tour[u+1]);
+            }
+            if (removal - insertion <= OPT2_MIN_GAIN) continue;
+
+            double reach = cum[u] + delta_mid + curr_row[tour[u]];
+            if (reach > eff[s]) continue;
+            if (has_v && reach + curr_row[tour[u+1]] - cum[u+1] > suffix_slack[u+1]) continue;
+
+            std::rotate(tour.begin() + a, tour.begin() + a + 1, tour.begin() + u + 1);
+            refresh();
+            return true;
+        }
+    }
+
+    // earlier: s, then tour[u+1..a-1] reached delta_mid later, then the rest
+    double mid_slack = std::numeric_limits<double>::infinity();
+    for (int u = a - 2; u >= 0; u--) {
+        mid_slack = std::min(mid_slack, slack[u+1]);
+        double insertion = curr_row[tour[u]] + curr_row[tour[u+1]]
+                         - dists.dist(tour[u], tour[u+1]);
+        if (removal - insertion <= OPT2_MIN_GAIN) continue;
+
+        double reach = cum[u] + curr_row[tour[u]];
+        if (reach > eff[s]) continue;
+        double delta_mid = reach + curr_row[tour[u+1]] - cum[u+1];
+        if (delta_mid > mid_slack) continue;
+        if (has_next) {
+            double next_reach = cum[a-1] + delta_mid + dists.dist(p, nx);
+            if (next_reach - cum[a+1] > suffix_slack[a+1]) continue;
+        }
+
+        std::rotate(tour.begin() + u + 1, tour.begin() + a, tour.begin() + a + 1);
+        refresh();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Applies improving feasible moves, first found first, until a pass
+ * over every position finds none.
+ */
+template <class Provider>
+Opt2Result DeadlineSearch<Provider>::run() {
+    Opt2Result result = { 0, 0, n > 0 ? cum[n-1] : 0.0, true };
+    bool changed = n >= 3;
+    while (changed) {
+        changed = false;
+        result.passes++;
+        for (int i = 1; i < n; i++) {
+            while (try_2opt(i) || try_relocate(i)) {
+                result.moves++;
+                changed = true;
+            }
+        }
+    }
+    result.length = n > 0 ? cum[n-1] : 0.0;
+    return result;
+}
+
+/**
+ * Runs DeadlineSearch on tour in place.
+ */
+template <class Provider>
+Opt2Result deadline_improve(Provider &dists, const vector<double> &due, vector<int> &tour,
+                            bool fixed_ends) {
+    DeadlineSearch<Provider> search(dists, due, tour, fixed_ends);
+    return search.run();
+}
+
+#endif
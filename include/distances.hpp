@@ -0,0 +1,274 @@
+// distances.hpp
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "coords.hpp"
+#include "metrics.hpp"
+#include "stats.hpp"
+using std::vector;
+
+#ifndef DISTANCES_HPP
+#define DISTANCES_HPP
+
+// How a distance provider answers queries. DIST_AUTO picks one of the
+// other three from the number of points and the memory budget.
+enum DistanceMode {
+    DIST_AUTO,
+    DIST_DENSE,       // full n x n matrix, filled up front
+    DIST_ROW_CACHE,   // rows filled on first use, oldest evicted first
+    DIST_ON_THE_FLY   // recomputed from coordinates every time
+};
+
+// default memory budget for a provider's tables, in bytes
+const size_t DEFAULT_DISTANCE_BUDGET = (size_t) 256 << 20;
+
+DistanceMode choose_distance_mode(int n, size_t budget_bytes);
+
+/**
+ * Hook for metrics that get many distances from one point faster than
+ * one at a time, such as RoadMetric. Providers filling their tables
+ * call metric_fill_rows() first: an overload for a metric type writes
+ * the count rows of distances from each point rows[k] to every point
+ * of coords to out, one after another, and returns true. This default
+ * declines, and the provider calls the metric for each pair.
+ */
+template <class Metric>
+bool metric_fill_rows(const Metric &, const CoordStore &, const int *, int, double *) {
+    return false;
+}
+
+/**
+ * Answers distance queries between points of a CoordStore, by index,
+ * under the metric policy Metric (see metrics.hpp). Every routing
+ * heuristic reads distances through a provider, so one built for an
+ * instance can be reused across repeated solves, and the storage
+ * strategy can be matched to the instance size.
+ *
+ * The provider keeps a reference to the CoordStore, which must outlive
+ * it and must not change while it is in use. Queries may fill the row
+ * cache, so a provider should not be shared between threads, except
+ * through its const members.
+ *
+ * With ROUTE_STATS, evaluations() counts the distances the provider
+ * has computed from coordinates, including those that fill its tables.
+ * Const members do not count theirs, so concurrent readers do not race
+ * on the counter. Without ROUTE_STATS it is always 0.
+ */
+template <class Metric>
+class BasicDistanceProvider {
+    private:
+        const CoordStore *coords;
+        const double *xs, *ys;       // coordinate arrays of coords
+        Metric metric;
+        DistanceMode mode;
+        int n;
+        vector<double> dense;        // n * n, for DIST_DENSE
+        vector<double> cache;        // cached rows, n entries each
+        vector<int> row_slot;        // cache slot of each row, or -1
+        vector<int> slot_row;        // row held by each cache slot, or -1
+        int next_victim;
+#ifdef ROUTE_STATS
+        long evals;
+#endif
+        const double *cached_row(int i);
+    public:
+        BasicDistanceProvider(const CoordStore &coords_in, Metric metric_in = Metric(),
+                              DistanceMode mode_in = DIST_AUTO,
+                              size_t budget_bytes = DEFAULT_DISTANCE_BUDGET);
+        static DistanceMode choose_mode(int n, size_t budget_bytes) {
+            return choose_distance_mode(n, budget_bytes);
+        }
+        int size() const { return n; }
+        DistanceMode get_mode() const { return mode; }
+        const Metric &get_metric() const { return metric; }
+        int kernel() const { return metric.kernel(); }
+#ifdef ROUTE_STATS
+        long evaluations() const { return evals; }
+#else
+        long evaluations() const { return 0; }
+#endif
+        const CoordStore &get_coords() const { return *coords; }
+        double compute(int i, int j) const {
+            return metric(xs[i], ys[i], xs[j], ys[j]);
+        }
+        double dist_to(int i, double x, double y) const {
+            return metric(xs[i], ys[i], x, y);
+        }
+        int index_closest_to(double x, double y) const;
+        void fill_row(int i, double *out) const;
+        const double *row(int i);
+        void copy_row(int i, double *out);
+        void read_row(int i, double *out) const;
+
+        // only the storage mode is tested per call; the metric is inlined
+        double dist(int i, int j) {
+            if (mode == DIST_DENSE) {
+                return dense[(size_t) i * n + j];
+            } else if (mode == DIST_ROW_CACHE) {
+                int slot = row_slot[i];
+                if (slot >= 0) {
+                    return cache[(size_t) slot * n + j];
+                }
+                return cached_row(i)[j];
+            }
+#ifdef ROUTE_STATS
+            evals++;
+#endif
+            return metric(xs[i], ys[i], xs[j], ys[j]);
+        }
+};
+
+// A provider whose metric is chosen at run time, e.g.
+//     DistanceProvider dists(list.get_coords(), manhattan_metric);
+typedef BasicDistanceProvider<FunctionMetric> DistanceProvider;
+
+template <class Metric>
+BasicDistanceProvider<Metric>::BasicDistanceProvider(const CoordStore &coords_in,
+                                                     Metric metric_in,
+                                                     DistanceMode mode_in,
+                                                     size_t budget_bytes)
+    : coords(&coords_in), xs(coords_in.x_data()), ys(coords_in.y_data()),
+      metric(metric_in), n(coords_in.size()), next_victim(0) {
+    mode = (mode_in == DIST_AUTO) ? choose_distance_mode(n, budget_bytes) : mode_in;
+#ifdef ROUTE_STATS
+    evals = (mode == DIST_DENSE) ? (long) n * (n - 1) / 2 : 0;
+#endif
+
+    if (mode == DIST_DENSE) {
+        dense.resize((size_t) n * n);
+        vector<int> all(n);
+        for (int i = 0; i < n; i++) {
+            all[i] = i;
+        }
+        if (metric_fill_rows(metric, coords_in, all.data(), n, dense.data())) return;
+        // fill one triangle and mirror it; metrics are symmetric
+        for (int i = 0; i < n; i++) {
+            dense[(size_t) i * n + i] = 0.0;
+            for (int j = i + 1; j < n; j++) {
+                double d = compute(i, j);
+                dense[(size_t) i * n + j] = d;
+                dense[(size_t) j * n + i] = d;
+            }
+        }
+    } else if (mode == DIST_ROW_CACHE) {
+        size_t row_bytes = std::max((size_t) 1, (size_t) n * sizeof(double));
+        int slots = std::max((size_t) 1, std::min((size_t) n, budget_bytes / row_bytes));
+        cache.resize((size_t) slots * n);
+        row_slot.assign(n, -1);
+        slot_row.assign(slots, -1);
+    }
+    // DIST_ON_THE_FLY allocates scratch space for row() on first use
+}
+
+/**
+ * Returns the index of the point closest to (x, y), with ties going
+ * to the lowest index, or -1 if there are no points. Metrics ranking
+ * like a built-in norm use the store's vectorized scan (see
+ * CoordStore::nearest()); others are scanned.
+ */
+template <class Metric>
+int BasicDistanceProvider<Metric>::index_closest_to(double x, double y) const {
+    if (metric.kernel() != KERNEL_CUSTOM) {
+        return coords->nearest(x, y, metric.kernel() == KERNEL_MANHATTAN);
+    }
+
+    int best_ind = -1;
+    double best_len = 0.0;
+    for (int i = 0; i < n; i++) {
+        double len = dist_to(i, x, y);
+        if (best_ind < 0 || len < best_len) {
+            best_len = len;
+            best_ind = i;
+        }
+    }
+    return best_ind;
+}
+
+/**
+ * Computes all n distances from point i into out, bypassing any table.
+ */
+template <class Metric>
+void BasicDistanceProvider<Metric>::fill_row(int i, double *out) const {
+    if (metric_fill_rows(metric, *coords, &i, 1, out)) return;
+    double x = xs[i], y = ys[i];
+    for (int j = 0; j < n; j++) {
+        out[j] = metric(x, y, xs[j], ys[j]);
+    }
+}
+
+/**
+ * Returns row i of the cache, computing it first if needed. When the
+ * cache is full the row cached longest ago is evicted.
+ */
+template <class Metric>
+const double *BasicDistanceProvider<Metric>::cached_row(int i) {
+    int slot = row_slot[i];
+    if (slot < 0) {
+        slot = next_victim;
+        next_victim = (next_victim + 1) % slot_row.size();
+        if (slot_row[slot] >= 0) {
+            row_slot[slot_row[slot]] = -1;
+        }
+        slot_row[slot] = i;
+        row_slot[i] = slot;
+        fill_row(i, cache.data() + (size_t) slot * n);
+#ifdef ROUTE_STATS
+        evals += n;
+#endif
+    }
+    return cache.data() + (size_t) slot * n;
+}
+
+/**
+ * Returns all n distances from point i. In DIST_ON_THE_FLY mode the
+ * row lives in a scratch buffer that the next call overwrites; in
+ * DIST_ROW_CACHE mode it may be evicted by later queries.
+ */
+template <class Metric>
+const double *BasicDistanceProvider<Metric>::row(int i) {
+    if (mode == DIST_DENSE) {
+        return dense.data() + (size_t) i * n;
+    } else if (mode == DIST_ROW_CACHE) {
+        return cached_row(i);
+    }
+    cache.resize(n);
+    fill_row(i, cache.data());
+#ifdef ROUTE_STATS
+    evals += n;
+#endif
+    return cache.data();
+}
+
+/**
+ * Writes all n distances from point i to out. Unlike row(), the
+ * result stays valid however the provider is used afterwards.
+ */
+template <class Metric>
+void BasicDistanceProvider<Metric>::copy_row(int i, double *out) {
+    if (mode == DIST_ON_THE_FLY) {
+        fill_row(i, out);
+#ifdef ROUTE_STATS
+        evals += n;
+#endif
+    } else {
+        const double *src = row(i);
+        std::copy(src, src + n, out);
+    }
+}
+
+/**
+ * As copy_row(), but never fills the row cache, so several threads may
+ * call it at once. Reads the dense table if there is one, otherwise
+ * computes the row.
+ */
+template <class Metric>
+void BasicDistanceProvider<Metric>::read_row(int i, double *out) const {
+    if (mode == DIST_DENSE) {
+        const double *src = dense.data() + (size_t) i * n;
+        std::copy(src, src + n, out);
+    } else {
+        fill_row(i, out);
+    }
+}
+
+#endif
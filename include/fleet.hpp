@@ -0,0 +1,51 @@
+// fleet.hpp
+#include <string>
+#include <vector>
+#include "addresses.hpp"
+using std::string;
+using std::vector;
+
+#ifndef FLEET_HPP
+#define FLEET_HPP
+
+// How Fleet::plan() splits the addresses among trucks.
+enum FleetPartition {
+    PARTITION_SWEEP,   // equal slices of the angle around the start depot
+    PARTITION_KMEANS   // clusters of nearby addresses
+};
+
+/**
+ * A fleet of trucks, each driving its own Route between the same start
+ * and end depots. Addresses are first partitioned among the trucks,
+ * then every truck's route is optimized on its own, in parallel, and
+ * finally stops are moved or swapped between trucks wherever that
+ * shortens the total distance driven.
+ *
+ * If max_stops is positive, no truck is given more than that many
+ * addresses; partitioning throws std::invalid_argument if the fleet
+ * cannot hold them all.
+ */
+class Fleet {
+    private:
+        Address start_depot, end_depot;
+        int max_stops;
+        vector<Route> routes;
+        void check_capacity(int num_addrs) const;
+        void assign_groups(const vector<Address> &addrs, const vector<int> &group);
+    public:
+        Fleet(Address start_depot_in, Address end_depot_in, int num_trucks, int max_stops_in = 0);
+        int size() const;
+        int num_stops() const;
+        const Route &get_route(int truck) const;
+        double euc_length() const;
+        double man_length() const;
+        void assign_sweep(const vector<Address> &addrs);
+        void assign_kmeans(const vector<Address> &addrs, unsigned seed = 1, int max_iters = 50);
+        void optimize_routes(bool man_norm, int num_threads = 0);
+        int exchange_stops(bool man_norm);
+        void plan(const vector<Address> &addrs, bool man_norm,
+                  FleetPartition partition = PARTITION_SWEEP, int num_threads = 0);
+        string as_string() const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+// greedy.hpp
+#include <cstdint>
+#include <vector>
+#include "coords.hpp"
+#include "metrics.hpp"
+using std::vector;
+
+#ifndef GREEDY_HPP
+#define GREEDY_HPP
+
+// hilbert_order() ranks points by cell on a grid of 2^HILBERT_BITS
+// cells a side laid over their bounding box
+const int HILBERT_BITS = 16;
+
+// candidate neighbors per point whose edges greedy_edge_path() considers
+const int GREEDY_EDGE_NEIGHBORS = 10;
+
+vector<int> geometric_nn_order(const CoordStore &coords, int start,
+                               int first, int last, bool man_norm);
+vector<int> hilbert_order(const CoordStore &coords, int first, int last);
+vector<int> hilbert_path(const CoordStore &coords, bool fixed_ends, bool man_norm);
+vector<int> greedy_edge_path(const CoordStore &coords, bool fixed_ends, bool man_norm);
+
+/**
+ * Nearest-neighbor visiting order as in geometric_nn_order(), under the
+ * metric of dists. Metrics that rank like a built-in norm use the k-d
+ * tree or vectorized scan over coordinates; others scan the provider's
+ * rows in O(n^2).
+ */
+template <class Provider>
+vector<int> nearest_neighbor_order(Provider &dists, int start, int first, int last) {
+    if (dists.kernel() != KERNEL_CUSTOM) {
+        return geometric_nn_order(dists.get_coords(), start, first, last,
+                                  dists.kernel() == KERNEL_MANHATTAN);
+    }
+
+    vector<int> order;
+    order.reserve(last - first);
+    vector<bool> included(last - first);
+    int curr = start;
+
+    while ((int) order.size() < last - first) {
+        const double *row = dists.row(curr);
+        int nearest = -1;
+        for (int i = first; i < last; i++) {
+            if (!included[i - first] && (nearest < 0 || row[i] < row[nearest])) {
+                nearest = i;
+            }
+        }
+        order.push_back(nearest);
+        included[nearest - first] = true;
+        curr = nearest;
+    }
+
+    return order;
+}
+
+#endif
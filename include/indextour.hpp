@@ -0,0 +1,105 @@
+// indextour.hpp
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "addresses.hpp"
+#include "budget.hpp"
+#include "distances.hpp"
+#include "neighbors.hpp"
+#include "opt2.hpp"
+using std::vector;
+
+#ifndef INDEXTOUR_HPP
+#define INDEXTOUR_HPP
+
+/**
+ * A route held as a permutation of indices into a shared, immutable
+ * table of addresses: the stop at position p is the table's address
+ * indices()[p]. Copies share the table, so each tour costs one int per
+ * stop instead of a whole Address, and many candidate tours over the
+ * same addresses can be kept cheaply.
+ *
+ * The optimize members rearrange the indices in place, drawing their
+ * scratch buffers from a caller-provided Opt2Workspace, so repeated
+ * solves allocate nothing once the workspace has grown to the table's
+ * size. If fixed_ends is true, as for the depots of a Route, the first
+ * and last stops never move.
+ */
+class IndexTour {
+    private:
+        std::shared_ptr<const AddressList> table;
+        vector<int> order;
+        bool fixed_ends;
+        void check_provider(int provider_size) const;
+    public:
+        IndexTour(std::shared_ptr<const AddressList> table_in, bool fixed_ends_in = false);
+        IndexTour(std::shared_ptr<const AddressList> table_in, const vector<int> &order_in,
+                  bool fixed_ends_in = false);
+        const AddressList &get_table() const;
+        const vector<int> &indices() const;
+        int size() const;
+        bool has_fixed_ends() const;
+        const Address &get_address_at(int pos) const;
+        double euc_length() const;
+        double man_length() const;
+        template <class Metric>
+        double length(BasicDistanceProvider<Metric> &dists) const;
+        template <class Metric>
+        Opt2Result opt2_optimize(BasicDistanceProvider<Metric> &dists, Opt2Workspace &work,
+                                 Opt2Strategy strategy = OPT2_FIRST,
+                                 const SolveBudget *budget = nullptr);
+        template <class Metric>
+        int opt2_optimize(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                          Opt2Workspace &work, const SolveBudget *budget = nullptr,
+                          bool *converged = nullptr);
+        AddressList as_list() const;
+        Route as_route() const;
+};
+
+/**
+ * Returns the length of the tour under the metric of dists, which must
+ * have been built over the table's coordinates.
+ * Throws std::invalid_argument if dists is for a different size of table.
+ */
+template <class Metric>
+double IndexTour::length(BasicDistanceProvider<Metric> &dists) const {
+    check_provider(dists.size());
+    double sum_len = 0.0;
+    for (int p = 1; p < (int) order.size(); p++) {
+        sum_len += dists.dist(order[p-1], order[p]);
+    }
+    return sum_len;
+}
+
+/**
+ * Shortens the tour in place with exhaustive 2-opt, as
+ * AddressList::opt2_rearrange(dists, strategy, ...) does, using the
+ * buffers of work. dists must have been built over the table's
+ * coordinates. Returns what the search did, including the new length.
+ * Throws std::invalid_argument if dists is for a different size of table.
+ */
+template <class Metric>
+Opt2Result IndexTour::opt2_optimize(BasicDistanceProvider<Metric> &dists, Opt2Workspace &work,
+                                    Opt2Strategy strategy, const SolveBudget *budget) {
+    check_provider(dists.size());
+    return opt2_improve(dists, order, fixed_ends, strategy, nullptr, budget, &work);
+}
+
+/**
+ * Shortens the tour in place with 2-opt over the candidate neighbor
+ * lists nbrs, as AddressList::opt2_rearrange(dists, nbrs, ...) does,
+ * using the buffers of work. Returns the number of moves applied.
+ * Throws std::invalid_argument if dists or nbrs is for a different
+ * size of table.
+ */
+template <class Metric>
+int IndexTour::opt2_optimize(BasicDistanceProvider<Metric> &dists, const NeighborLists &nbrs,
+                             Opt2Workspace &work, const SolveBudget *budget, bool *converged) {
+    check_provider(dists.size());
+    if (nbrs.size() != table->size()) {
+        throw std::invalid_argument("neighbor lists do not match address table");
+    }
+    return opt2_neighbor_improve(dists, nbrs, order, fixed_ends, budget, converged, &work);
+}
+
+#endif
@@ -0,0 +1,69 @@
+// instance.hpp
+#include <limits>
+#include <string>
+#include <vector>
+#include "coords.hpp"
+using std::string;
+using std::vector;
+
+#ifndef INSTANCE_HPP
+#define INSTANCE_HPP
+
+// deadline of stops loaded from files that give none
+const int NO_DEADLINE = std::numeric_limits<int>::max();
+
+/**
+ * The stops of a problem instance read from a file: their coordinates,
+ * and one delivery deadline per stop.
+ */
+struct Instance {
+    string name;
+    CoordStore coords;
+    vector<int> deadlines;
+};
+
+// Binary instance files hold, in native byte order:
+//
+//     offset 0    char[8]   "ROUTEBIN"
+//     offset 8    uint64    n, the number of stops
+//     offset 16   uint64    flags; bit 0 set if deadlines follow
+//     offset 24   uint64    reserved, 0
+//     offset 32   double[n] x coordinates
+//             then double[n] y coordinates
+//             then int32[n] deadlines, if flagged
+//
+// so the coordinates are already laid out as a CoordStore wants them.
+
+const int BINARY_HEADER_BYTES = 32;
+
+Instance load_binary_instance(const string &path);
+void save_binary_instance(const string &path, const CoordStore &coords,
+                          const vector<int> &deadlines);
+Instance load_tsplib(const string &path);
+Instance load_csv(const string &path);
+
+/**
+ * A road network read from a file: the position of each node, and the
+ * roads between them as arcs from node from[k] to node to[k] of length
+ * length[k], with nodes numbered from 0.
+ */
+struct RoadGraph {
+    string name;
+    CoordStore nodes;
+    vector<int> from, to;
+    vector<double> length;
+};
+
+// Road files use the records of the DIMACS shortest-path challenge
+// (.co and .gr files, which may simply be concatenated):
+//
+//     c any comment
+//     p ...            problem lines, ignored
+//     v id x y         node id, numbered from 1, is at (x, y)
+//     a u v length     a road from node u to node v
+//
+// Blank lines are ignored.
+
+RoadGraph load_road_graph(const string &path);
+
+#endif
@@ -0,0 +1,55 @@
+// kdtree.hpp
+#include <utility>
+#include <vector>
+#include "coords.hpp"
+using std::vector;
+
+#ifndef KDTREE_HPP
+#define KDTREE_HPP
+
+/**
+ * Static 2-d tree over a range of points in a CoordStore, supporting
+ * nearest-neighbor queries under either norm and deletion of points.
+ * Deleted points are never returned, so repeatedly asking for the
+ * nearest point and removing it walks the set in nearest-unvisited
+ * order in about O(log n) per step.
+ *
+ * The tree is implicit: points are permuted into slots so that every
+ * subtree occupies a contiguous slot range whose middle slot is the
+ * splitting point. Each range keeps its bounding box and a count of
+ * points still alive, so emptied subtrees are skipped outright.
+ * Ties are broken towards the lowest original index, which matches
+ * a linear scan over the same points.
+ */
+class KdTree {
+    private:
+        vector<double> xs, ys;     // coordinates in slot order
+        vector<int> ids;           // original index of each slot
+        vector<int> slot_of;       // slot of each original index, or -1
+        vector<int> live;          // alive points in the range around each slot
+        vector<double> min_x, max_x, min_y, max_y;
+        vector<char> axis;         // split axis of the range around each slot
+        int first;
+        int num_alive;
+        void build(const double *src_x, const double *src_y, int lo, int hi);
+        template <class Metric>
+        double box_dist(const Metric &metric, int slot, double qx, double qy) const;
+        template <class Metric>
+        void search(const Metric &metric, int lo, int hi, double qx, double qy,
+                    double &best_len, int &best_ind) const;
+        template <class Metric>
+        void search_k(const Metric &metric, int lo, int hi, double qx, double qy, int k,
+                      vector<std::pair<double, int> > &heap) const;
+    public:
+        KdTree();
+        KdTree(const CoordStore &coords);
+        KdTree(const CoordStore &coords, int first_ind, int last_ind);
+        int size() const;
+        bool empty() const;
+        bool contains(int index) const;
+        void remove(int index);
+        int nearest(double qx, double qy, bool man_norm) const;
+        vector<int> k_nearest(double qx, double qy, int k, bool man_norm) const;
+};
+
+#endif
@@ -0,0 +1,126 @@
+// metrics.hpp
+#include <algorithm>
+#include <cmath>
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+// Metric policies. A metric is any copyable type with
+//
+//     double operator()(double x1, double y1, double x2, double y2) const;
+//     int kernel() const;
+//
+// Algorithms are templates over the metric, so its arithmetic is inlined
+// into their inner loops with no per-distance branching. kernel() names
+// the built-in norm whose ranking the metric shares, which lets nearest-
+// point searches use the k-d tree and SIMD scans; return KERNEL_CUSTOM
+// if there is none. New metrics only need these two members, e.g.
+//
+//     struct ChebyshevMetric { ... };
+//     BasicDistanceProvider<ChebyshevMetric> dists(list.get_coords());
+//     AddressList route = list.greedy_route(dists);
+
+const int KERNEL_CUSTOM = 0;
+const int KERNEL_EUCLIDEAN = 1;
+const int KERNEL_MANHATTAN = 2;
+
+// A metric as a plain function, for choosing one at run time.
+typedef double (*DistanceFn)(double x1, double y1, double x2, double y2);
+
+double euclidean_metric(double x1, double y1, double x2, double y2);
+double manhattan_metric(double x1, double y1, double x2, double y2);
+
+struct EuclideanMetric {
+    double operator()(double x1, double y1, double x2, double y2) const {
+        double dx = x1 - x2;
+        double dy = y1 - y2;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+    int kernel() const { return KERNEL_EUCLIDEAN; }
+};
+
+/**
+ * Squared Euclidean distance. Ranks points the same as the Euclidean
+ * norm without the square root, so it is meant for nearest-point
+ * comparisons; sums of it are not tour lengths.
+ */
+struct SqEuclideanMetric {
+    double operator()(double x1, double y1, double x2, double y2) const {
+        double dx = x1 - x2;
+        double dy = y1 - y2;
+        return dx * dx + dy * dy;
+    }
+    int kernel() const { return KERNEL_EUCLIDEAN; }
+};
+
+struct ManhattanMetric {
+    double operator()(double x1, double y1, double x2, double y2) const {
+        return std::abs(x1 - x2) + std::abs(y1 - y2);
+    }
+    int kernel() const { return KERNEL_MANHATTAN; }
+};
+
+/**
+ * Euclidean distance rounded to the nearest multiple of unit, as
+ * TSPLIB's EUC_2D rounds to the nearest integer, for coordinates on a
+ * fixed-point grid of that unit (see CoordPrecision). Lengths are then
+ * sums of whole units, which add up exactly. Rounding keeps the order
+ * of distances, if not every strict inequality, so the Euclidean
+ * search kernel still applies.
+ */
+struct RoundedEuclideanMetric {
+    double unit;
+    RoundedEuclideanMetric(double unit_in = 1.0) : unit(unit_in) { }
+    double operator()(double x1, double y1, double x2, double y2) const {
+        double dx = x1 - x2;
+        double dy = y1 - y2;
+        return unit * std::floor(std::sqrt(dx * dx + dy * dy) / unit + 0.5);
+    }
+    int kernel() const { return KERNEL_EUCLIDEAN; }
+};
+
+/**
+ * Maximum of the coordinate differences, e.g. for travel where both
+ * axes move at once. No built-in search shares its ranking.
+ */
+struct ChebyshevMetric {
+    double operator()(double x1, double y1, double x2, double y2) const {
+        return std::max(std::abs(x1 - x2), std::abs(y1 - y2));
+    }
+    int kernel() const { return KERNEL_CUSTOM; }
+};
+
+/**
+ * Another metric multiplied by a positive constant, e.g. distance
+ * turned into travel time at a fixed speed. Scaling keeps the ranking,
+ * so the base metric's search kernel still applies.
+ */
+template <class Base>
+struct ScaledMetric {
+    Base base;
+    double scale;
+    ScaledMetric(double scale_in = 1.0, Base base_in = Base())
+        : base(base_in), scale(scale_in) { }
+    double operator()(double x1, double y1, double x2, double y2) const {
+        return scale * base(x1, y1, x2, y2);
+    }
+    int kernel() const { return base.kernel(); }
+};
+
+/**
+ * Adapts a DistanceFn. Passing euclidean_metric or manhattan_metric
+ * keeps their search kernels; any other function is treated as custom.
+ * Every distance costs an indirect call, so prefer a policy type for
+ * metrics known at compile time.
+ */
+struct FunctionMetric {
+    DistanceFn fn;
+    int fn_kernel;
+    FunctionMetric(DistanceFn fn_in = euclidean_metric);
+    double operator()(double x1, double y1, double x2, double y2) const {
+        return fn(x1, y1, x2, y2);
+    }
+    int kernel() const { return fn_kernel; }
+};
+
+#endif
@@ -0,0 +1,158 @@
+// multistart.hpp
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "coords.hpp"
+#include "distances.hpp"
+#include "greedy.hpp"
+#include "neighbors.hpp"
+#include "oropt.hpp"
+#include "pool.hpp"
+using std::vector;
+
+#ifndef MULTISTART_HPP
+#define MULTISTART_HPP
+
+// local search rarely shortens a constructed tour by more than this
+// fraction, so a start whose construction is longer than the best tour
+// so far divided by (1 - MULTISTART_PRUNE) is not improved
+const double MULTISTART_PRUNE = 0.25;
+
+// candidate neighbors per point for the local search of each start
+const int MULTISTART_NEIGHBORS = 8;
+
+/**
+ * Length of the open path visiting tour in order.
+ */
+template <class Provider>
+double path_length(Provider &dists, const vector<int> &tour) {
+    double sum_len = 0.0;
+    for (int p = 1; p < (int) tour.size(); p++) {
+        sum_len += dists.dist(tour[p-1], tour[p]);
+    }
+    return sum_len;
+}
+
+/**
+ * Builds a nearest-neighbor tour over all points of dists. With
+ * start_city < 0 it is the plain greedy tour from point 0. Otherwise
+ * the nearest-neighbor sequence is grown from start_city; with
+ * fixed_ends it covers the interior points only and, viewed as a
+ * cycle, is cut and turned so that it joins the two ends most cheaply.
+ */
+template <class Provider>
+vector<int> multistart_construct(Provider &dists, bool fixed_ends, int start_city) {
+    int n = dists.size();
+    int last = fixed_ends ? n - 1 : n;
+    vector<int> tour;
+    tour.reserve(n);
+
+    if (start_city < 0) {
+        tour.push_back(0);
+        vector<int> order = nearest_neighbor_order(dists, 0, 1, last);
+        tour.insert(tour.end(), order.begin(), order.end());
+    } else if (!fixed_ends) {
+        tour = nearest_neighbor_order(dists, start_city, 0, n);
+    } else {
+        vector<int> seq = nearest_neighbor_order(dists, start_city, 1, last);
+        int m = seq.size();
+        int best_k = 0;
+        bool best_rev = false;
+        double best_cost = std::numeric_limits<double>::infinity();
+        for (int k = 0; k < m; k++) {
+            // cut the closing edge (a, b): the path runs b..a or a..b
+            int a = seq[(k + m - 1) % m], b = seq[k];
+            double closing = dists.dist(a, b);
+            double fwd = dists.dist(0, b) + dists.dist(a, n - 1) - closing;
+            double rev = dists.dist(0, a) + dists.dist(b, n - 1) - closing;
+            if (fwd < best_cost) {
+                best_cost = fwd;
+                best_k = k;
+                best_rev = false;
+            }
+            if (rev < best_cost) {
+                best_cost = rev;
+                best_k = k;
+                best_rev = true;
+            }
+        }
+        tour.push_back(0);
+        for (int step = 0; step < m; step++) {
+            int k = best_rev ? (best_k + m - 1 - step) % m : (best_k + step) % m;
+            tour.push_back(seq[k]);
+        }
+    }
+
+    if (fixed_ends) {
+        tour.push_back(n - 1);
+    }
+    return tour;
+}
+
+/**
+ * Runs starts independent construction + local search pipelines over
+ * coords on a WorkPool of num_threads threads (0 for one per hardware
+ * thread) and returns the shortest tour found as an open path. Start 0
+ * is the plain greedy tour; start s > 0 grows a nearest-neighbor tour
+ * from a city drawn by a generator seeded with seed + s. Each tour is
+ * then improved by OrOptSearch with shared neighbor lists.
+ *
+ * Workers share the best length found so far and skip the local search
+ * for constructions that are unlikely to beat it (see MULTISTART_PRUNE).
+ * Among equally short tours the lowest start wins, so the result only
+ * depends on timing if a pruned start would have won. If best_len is
+ * not null, the length of the returned tour is stored there.
+ */
+template <class Metric>
+vector<int> multistart_tour(const CoordStore &coords, const Metric &metric, bool fixed_ends,
+                            int starts, int num_threads, unsigned seed, double *best_len) {
+    int n = coords.size();
+    bool can_vary = fixed_ends ? n >= 4 : n >= 2;
+    starts = std::max(1, can_vary ? starts : 1);
+
+    NeighborLists nbrs(coords, MULTISTART_NEIGHBORS, metric.kernel() == KERNEL_MANHATTAN);
+    std::atomic<double> shared_len(std::numeric_limits<double>::infinity());
+    std::mutex best_lock;
+    vector<int> best_tour;
+    int best_start = -1;
+
+    WorkPool pool(num_threads);
+    for (int s = 0; s < starts; s++) {
+        pool.submit([&, s]() {
+            // providers are not shared, so each start makes its own
+            BasicDistanceProvider<Metric> dists(coords, metric, DIST_ON_THE_FLY);
+            int start_city = -1;
+            if (s > 0) {
+                std::mt19937 gen(seed + s);
+                std::uniform_int_distribution<int> pick(fixed_ends ? 1 : 0, fixed_ends ? n - 2 : n - 1);
+                start_city = pick(gen);
+            }
+
+            vector<int> tour = multistart_construct(dists, fixed_ends, start_city);
+            if (path_length(dists, tour) * (1.0 - MULTISTART_PRUNE) > shared_len.load()) {
+                return;
+            }
+            oropt_improve(dists, nbrs, tour, fixed_ends);
+            double len = path_length(dists, tour);
+
+            std::lock_guard<std::mutex> guard(best_lock);
+            double best = shared_len.load();
+            if (best_start < 0 || len < best || (len == best && s < best_start)) {
+                shared_len.store(len);
+                best_tour = tour;
+                best_start = s;
+            }
+        });
+    }
+    pool.wait();
+
+    if (best_len) {
+        *best_len = shared_len.load();
+    }
+    return best_tour;
+}
+
+#endif
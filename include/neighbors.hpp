@@ -0,0 +1,30 @@
+// neighbors.hpp
+#include <vector>
+#include "coords.hpp"
+using std::vector;
+
+#ifndef NEIGHBORS_HPP
+#define NEIGHBORS_HPP
+
+/**
+ * Candidate neighbor lists: for every point in a CoordStore, the
+ * indices of its k nearest other points, nearest first. Local search
+ * restricted to these candidates only considers moves that create a
+ * short edge, which is where nearly all improving moves are found.
+ *
+ * Lists are built once per instance with a k-d tree in O(n k log n)
+ * and stay valid as long as the coordinates are not reordered.
+ */
+class NeighborLists {
+    private:
+        int n, k;
+        vector<int> nbrs;   // n rows of k indices each
+    public:
+        NeighborLists();
+        NeighborLists(const CoordStore &coords, int k_in, bool man_norm);
+        int size() const;
+        int per_point() const;
+        const int *of(int index) const;
+};
+
+#endif
@@ -0,0 +1,472 @@
+// opt2.hpp
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "budget.hpp"
+#include "distances.hpp"
+#include "neighbors.hpp"
+#include "pool.hpp"
+#include "stats.hpp"
+using std::vector;
+
+#ifndef OPT2_HPP
+#define OPT2_HPP
+
+// Index-based 2-opt engines. A tour is an open path given as a vector
+// of point indices of a distance provider; the engines rearrange it in
+// place. If fixed_ends is true the first and last entries never move.
+// They are templates over the provider type, so each metric gets its
+// own copy of the inner loops with the distance arithmetic inlined.
+
+// moves must gain more than this, so rounding noise cannot cycle
+const double OPT2_MIN_GAIN = 1e-9;
+
+// How the exhaustive engine picks among improving moves.
+enum Opt2Strategy {
+    OPT2_FIRST,  // apply each improving move as soon as it is found
+    OPT2_BEST,   // apply only the best move of each full scan
+    OPT2_SWEEP   // apply the best move for each first position i in turn
+};
+
+/**
+ * Scratch space for the 2-opt engines. Handing the same workspace to
+ * repeated calls lets them reuse its buffers, so once it has grown to
+ * the size of the problem they allocate nothing.
+ */
+struct Opt2Workspace {
+    vector<double> edge, prev_row, curr_row;
+    vector<int> pos, queue;
+    vector<char> queued;
+};
+
+struct Opt2Result {
+    int moves;      // reversals applied
+    int passes;     // scans over all pairs of positions
+    double length;  // length of the final tour
+    bool converged; // false if the budget ran out first
+};
+
+/**
+ * Reverses tour[i..j] and updates the edge lengths to match. Returns
+ * the gain, i.e. how much shorter the tour became.
+ */
+template <class Provider>
+double opt2_apply(Provider &dists, vector<int> &tour, vector<double> &edge, int i, int j) {
+    int n = tour.size();
+    double gain = 0.0;
+    std::reverse(tour.begin() + i, tour.begin() + j + 1);
+    std::reverse(edge.begin() + i, edge.begin() + j);
+    if (i > 0) {
+        gain += edge[i-1];
+        edge[i-1] = dists.dist(tour[i-1], tour[i]);
+        gain -= edge[i-1];
+    }
+    if (j < n - 1) {
+        gain += edge[j];
+        edge[j] = dists.dist(tour[j], tour[j+1]);
+        gain -= edge[j];
+    }
+    return gain;
+}
+
+/**
+ * Exhaustive 2-opt. Every pair of positions (i, j) is tested for the
+ * change in length from reversing tour[i..j], and shortening reversals
+ * are applied according to strategy. Scanning continues after a move
+ * rather than starting over, and passes repeat until one applies no
+ * move. The tour length is kept up to date as moves are applied, so
+ * the result carries it without another walk over the tour.
+ * If stats is not null, each pass adds its counts to it and reports.
+ * If budget is not null, it is checked before each first position i
+ * and after each move, and the search stops as soon as it is spent or
+ * its target length is reached.
+ * If work is not null, its buffers are used instead of new ones.
+ */
+template <class Provider>
+Opt2Result opt2_improve(Provider &dists, vector<int> &tour, bool fixed_ends,
+                        Opt2Strategy strategy, SolveStats *stats = nullptr,
+                        const SolveBudget *budget = nullptr, Opt2Workspace *work = nullptr) {
+    int n = tour.size();
+    int lo_lim = fixed_ends ? 1 : 0;
+    int hi_lim = fixed_ends ? n - 2 : n - 1;
+    Opt2Result result = { 0, 0, 0.0, true };
+    STATS_ONLY(long evals_seen = dists.evaluations();)
+
+    // lengths of the current tour edges, edge[p] joining positions p and
+    // p+1. With these kept up to date, the only other lengths the inner
+    // loop needs are from tour[i-1] and tour[i], which stay fixed while
+    // j varies, so their rows are fetched once per i into local buffers.
+    Opt2Workspace local;
+    Opt2Workspace &ws = work ? *work : local;
+    vector<double> &edge = ws.edge;
+    edge.resize(n > 0 ? n - 1 : 0);
+    for (int p = 0; p + 1 < n; p++) {
+        edge[p] = dists.dist(tour[p], tour[p+1]);
+        result.length += edge[p];
+    }
+    vector<double> &prev_row = ws.prev_row, &curr_row = ws.curr_row;
+    prev_row.resize(dists.size());
+    curr_row.resize(dists.size());
+
+    bool changed = true, stopped = false;
+    while (changed && !stopped) {
+        changed = false;
+        result.passes++;
+        STATS_ONLY(int pass_moves = result.moves;)
+        int best_i = -1, best_j = -1;
+        double best_gain = OPT2_MIN_GAIN;
+
+        for (int i = lo_lim; i < hi_lim && !stopped; i++) {
+            if (budget && (budget->expired() || budget->target_reached(result.length))) {
+                stopped = true;
+                break;
+            }
+            if (i > 0) {
+                dists.copy_row(tour[i-1], prev_row.data());
+            }
+            dists.copy_row(tour[i], curr_row.data());
+            if (strategy == OPT2_SWEEP) {
+                best_j = -1;
+                best_gain = OPT2_MIN_GAIN;
+            }
+
+            for (int j = i + 1; j <= hi_lim; j++) {
+                // change in length from swapping the edges at either end
+                // of tour[i..j]; an end of the path has no edge to swap.
+                // reversing the entire path gains nothing and is skipped.
+                double gain = 0.0;
+                if (i > 0) {
+                    gain += edge[i-1] - prev_row[tour[j]];
+                }
+                if (j < n - 1) {
+                    gain += edge[j] - curr_row[tour[j+1]];
+                }
+                if (gain <= best_gain) continue;
+
+                if (strategy == OPT2_FIRST) {
+                    // tour[i] is now the old tour[j], so refresh its row
+                    result.length -= opt2_apply(dists, tour, edge, i, j);
+                    result.moves++;
+                    changed = true;
+                    if (budget && (budget->moves_spent(result.moves) ||
+                                   budget->target_reached(result.length))) {
+                        stopped = true;
+                        break;
+                    }
+                    dists.copy_row(tour[i], curr_row.data());
+                } else {
+                    best_gain = gain;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+            STATS_ADD(stats, moves_tried, hi_lim - i);
+
+            if (strategy == OPT2_SWEEP && best_j >= 0) {
+                result.length -= opt2_apply(dists, tour, edge, i, best_j);
+                result.moves++;
+                changed = true;
+                stopped = budget && (budget->moves_spent(result.moves) ||
+                                     budget->target_reached(result.length));
+            }
+        }
+
+        // a scan cut short may have missed the best move, so skip it
+        if (strategy == OPT2_BEST && best_i >= 0 && !stopped) {
+            result.length -= opt2_apply(dists, tour, edge, best_i, best_j);
+            result.moves++;
+            changed = true;
+            stopped = budget && (budget->moves_spent(result.moves) ||
+                                 budget->target_reached(result.length));
+        }
+
+        STATS_ADD(stats, moves_applied, result.moves - pass_moves);
+        STATS_ADD(stats, passes, 1);
+        STATS_ADD(stats, dist_evals, dists.evaluations() - evals_seen);
+        STATS_SET(stats, length, result.length);
+        STATS_REPORT(stats, PHASE_IMPROVE);
+        STATS_ONLY(evals_seen = dists.evaluations();)
+    }
+
+    result.converged = !changed && !stopped;
+    return result;
+}
+
+// an improving reversal of tour[i..j] found by a parallel scan
+struct Opt2Move {
+    double gain;
+    int i, j;
+    bool operator<(const Opt2Move &other) const {
+        return gain > other.gain || (gain == other.gain && i < other.i);
+    }
+};
+
+/**
+ * Scans first positions i = lo_lim + stripe, lo_lim + stripe + stride,
+ * ... and records the best improving reversal starting at each. Rows
+ * are dealt out in turn, so the long early rows are spread evenly over
+ * the stripes. Only const members of dists are used.
+ */
+template <class Provider>
+void opt2_scan_stripe(const Provider &dists, const vector<int> &tour, const vector<double> &edge,
+                      bool fixed_ends, int stripe, int stride, vector<Opt2Move> &found) {
+    int n = tour.size();
+    int lo_lim = fixed_ends ? 1 : 0;
+    int hi_lim = fixed_ends ? n - 2 : n - 1;
+    vector<double> prev_row(dists.size()), curr_row(dists.size());
+    found.clear();
+
+    for (int i = lo_lim + stripe; i < hi_lim; i += stride) {
+        if (i > 0) {
+            dists.read_row(tour[i-1], prev_row.data());
+        }
+        dists.read_row(tour[i], curr_row.data());
+
+        Opt2Move best = { OPT2_MIN_GAIN, i, -1 };
+        for (int j = i + 1; j <= hi_lim; j++) {
+            double gain = 0.0;
+            if (i > 0) {
+                gain += edge[i-1] - prev_row[tour[j]];
+            }
+            if (j < n - 1) {
+                gain += edge[j] - curr_row[tour[j+1]];
+            }
+            if (gain > best.gain) {
+                best.gain = gain;
+                best.j = j;
+            }
+        }
+        if (best.j >= 0) {
+            found.push_back(best);
+        }
+    }
+}
+
+/**
+ * Exhaustive 2-opt with the scan split over a WorkPool of num_threads
+ * threads (0 for one per hardware thread), kept for the whole search.
+ * Each round, every thread finds the best reversal for each of its
+ * first positions; then, best gain first, every move whose gain cannot
+ * be changed by the moves already taken joins the batch, and the batch
+ * is applied together.
+ * Rounds repeat until none finds an improving move.
+ *
+ * The moves found and the order they are applied in depend only on the
+ * tour, never on thread timing or count, so the result is deterministic.
+ * dists is shared read-only during the scans (see read_row()).
+ * If budget is not null, it is checked before each round and after
+ * each move, as is its target length; a round's scan always runs to the
+ * end.
+ */
+template <class Provider>
+Opt2Result opt2_parallel_improve(Provider &dists, vector<int> &tour, bool fixed_ends,
+                                 int num_threads, const SolveBudget *budget = nullptr) {
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    int n = tour.size();
+    Opt2Result result = { 0, 0, 0.0, true };
+
+    vector<double> edge(n > 0 ? n - 1 : 0);
+    for (int p = 0; p + 1 < n; p++) {
+        edge[p] = dists.dist(tour[p], tour[p+1]);
+        result.length += edge[p];
+    }
+
+    vector<vector<Opt2Move> > found(num_threads);
+    WorkPool pool(num_threads);
+    while (result.converged) {
+        if (budget && (budget->expired() || budget->target_reached(result.length))) {
+            result.converged = false;
+            break;
+        }
+        result.passes++;
+        const Provider &shared = dists;
+        for (int t = 0; t < num_threads; t++) {
+            pool.submit([&, t]() {
+                opt2_scan_stripe(shared, tour, edge, fixed_ends, t, num_threads, found[t]);
+            });
+        }
+        pool.wait();
+
+        vector<Opt2Move> moves;
+        for (int t = 0; t < num_threads; t++) {
+            moves.insert(moves.end(), found[t].begin(), found[t].end());
+        }
+        if (moves.empty()) break;
+        std::sort(moves.begin(), moves.end());
+
+        // edges [i-1, j] span each chosen move. Two moves' gains do not
+        // interact if the spans are disjoint, or if one lies strictly
+        // inside the other, as the inner reversal then leaves the outer
+        // one's end cities in place. Applying the chosen moves innermost
+        // first keeps every position valid when its turn comes.
+        vector<Opt2Move> chosen;
+        for (const Opt2Move &move : moves) {
+            bool fits = true;
+            for (int c = 0; c < (int) chosen.size() && fits; c++) {
+                int lo = chosen[c].i - 1, hi = chosen[c].j;
+                bool apart = move.j < lo || hi < move.i - 1;
+                bool inside = lo < move.i - 1 && move.j < hi;
+                bool around = move.i - 1 < lo && hi < move.j;
+                fits = apart || inside || around;
+            }
+            if (fits) {
+                chosen.push_back(move);
+            }
+        }
+        std::sort(chosen.begin(), chosen.end(), [](const Opt2Move &a, const Opt2Move &b) {
+            return a.j - a.i < b.j - b.i || (a.j - a.i == b.j - b.i && a.i < b.i);
+        });
+        for (const Opt2Move &move : chosen) {
+            // the batch's moves are independent, so any prefix of it can be taken
+            if (budget && (budget->moves_spent(result.moves) ||
+                           budget->target_reached(result.length))) {
+                result.converged = false;
+                break;
+            }
+            result.length -= opt2_apply(dists, tour, edge, move.i, move.j);
+            result.moves++;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * 2-opt restricted to candidate neighbor lists, driven by don't-look
+ * bits. Only moves that create an edge from a city to one of its
+ * listed neighbors, shorter than the tour edge it replaces, are tried.
+ * Cities whose neighborhood yielded nothing are dropped from the work
+ * queue (their don't-look bit is set) until a move touches one of
+ * their tour edges again. The search ends when the queue is empty,
+ * which takes roughly O(n k) work per sweep instead of O(n^2).
+ *
+ * nbrs must have been built over the points of dists, preferably
+ * with the same metric. Returns the number of moves applied. If budget
+ * is not null, the search stops once it is spent or its target length
+ * is reached, and if converged is not null, whether the queue was
+ * emptied is stored there. If work is
+ * not null, its buffers are used instead of new ones.
+ */
+template <class Provider>
+int opt2_neighbor_improve(Provider &dists, const NeighborLists &nbrs,
+                          vector<int> &tour, bool fixed_ends,
+                          const SolveBudget *budget = nullptr, bool *converged = nullptr,
+                          Opt2Workspace *work = nullptr) {
+    int n = tour.size();
+    int moves = 0;
+    if (converged) {
+        *converged = true;
+    }
+    if (n < 4) return moves;
+
+    // reversible positions are [lo_lim, hi_lim]
+    int lo_lim = fixed_ends ? 1 : 0;
+    int hi_lim = fixed_ends ? n - 2 : n - 1;
+
+    Opt2Workspace local;
+    Opt2Workspace &ws = work ? *work : local;
+    vector<int> &pos = ws.pos;
+    pos.resize(dists.size());
+    for (int p = 0; p < n; p++) {
+        pos[tour[p]] = p;
+    }
+
+    // a city is active while queued; its don't-look bit is !queued.
+    // no city is queued twice, so a ring of n slots holds the queue
+    vector<int> &queue = ws.queue;
+    queue.assign(tour.begin(), tour.end());
+    int head = 0, queue_len = n;
+    vector<char> &queued = ws.queued;
+    queued.assign(dists.size(), 0);
+    for (int p = 0; p < n; p++) {
+        queued[tour[p]] = 1;
+    }
+
+    // the length is only followed when there is a target to compare it to
+    double length = 0.0;
+    bool targeted = budget && budget->has_target();
+    for (int p = 0; targeted && p + 1 < n; p++) {
+        length += dists.dist(tour[p], tour[p+1]);
+    }
+
+    long popped = 0;
+    while (queue_len > 0) {
+        if (budget && (budget->moves_spent(moves) || (targeted && budget->target_reached(length)) ||
+                       (popped++ % BUDGET_CHECK_INTERVAL == 0 && budget->expired()))) {
+            if (converged) {
+                *converged = false;
+            }
+            break;
+        }
+        int a = queue[head];
+        head = (head + 1 == n) ? 0 : head + 1;
+        queue_len--;
+        queued[a] = 0;
+
+        bool improved = false;
+        // dir 0 replaces the edge to a's successor, dir 1 to its predecessor
+        for (int dir = 0; dir < 2 && !improved; dir++) {
+            int p = pos[a];
+            int adj = (dir == 0) ? p + 1 : p - 1;
+            if (adj < 0 || adj >= n) continue;
+
+            double adj_len = dists.dist(a, tour[adj]);
+            const int *cand = nbrs.of(a);
+
+            for (int m = 0; m < nbrs.per_point(); m++) {
+                int c = cand[m];
+                // lists are sorted, so no later candidate can gain either
+                if (adj_len - dists.dist(a, c) <= 0) break;
+
+                // pick the reversal [i, j] that makes a and c adjacent
+                int q = pos[c];
+                int i, j;
+                if (dir == 0) {
+                    i = (q > p) ? p + 1 : q + 1;
+                    j = (q > p) ? q : p;
+                } else {
+                    i = (q < p) ? q : p;
+                    j = (q < p) ? p - 1 : q - 1;
+                }
+                if (i >= j || i < lo_lim || j > hi_lim) continue;
+
+                double gain = 0.0;
+                if (i > 0) {
+                    gain += dists.dist(tour[i-1], tour[i]) - dists.dist(tour[i-1], tour[j]);
+                }
+                if (j < n - 1) {
+                    gain += dists.dist(tour[j], tour[j+1]) - dists.dist(tour[i], tour[j+1]);
+                }
+                if (gain <= OPT2_MIN_GAIN) continue;
+
+                std::reverse(tour.begin() + i, tour.begin() + j + 1);
+                for (int r = i; r <= j; r++) {
+                    pos[tour[r]] = r;
+                }
+                moves++;
+                length -= gain;
+                improved = true;
+
+                // wake the endpoints of every edge that changed (a among them)
+                int touched[4] = { i > 0 ? tour[i-1] : -1, tour[i], tour[j],
+                                   j < n - 1 ? tour[j+1] : -1 };
+                for (int t = 0; t < 4; t++) {
+                    if (touched[t] >= 0 && !queued[touched[t]]) {
+                        queued[touched[t]] = 1;
+                        int tail = head + queue_len;
+                        queue[tail >= n ? tail - n : tail] = touched[t];
+                        queue_len++;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    return moves;
+}
+
+#endif
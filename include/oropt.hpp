@@ -0,0 +1,260 @@
+// oropt.hpp
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "budget.hpp"
+#include "neighbors.hpp"
+#include "opt2.hpp"
+#include "tour.hpp"
+using std::vector;
+
+#ifndef OROPT_HPP
+#define OROPT_HPP
+
+// longest run of consecutive stops moved by one segment insertion
+const int OROPT_MAX_SEGMENT = 3;
+
+/**
+ * Neighbor-list local search mixing 2-opt moves with Or-opt moves, which
+ * cut a segment of 1 to OROPT_MAX_SEGMENT stops out of the tour and
+ * reinsert it, in either orientation, between two adjacent stops
+ * elsewhere. It runs on a CyclicTour: each move is evaluated in O(1)
+ * from the few edges it changes, and applied as two-edge exchanges that
+ * never reverse more than half the tour.
+ *
+ * The open path is closed into a cycle through a phantom city joined to
+ * both ends. Edges to it cost nothing, so breaking one moves an end of
+ * the path; with fixed_ends they are never broken.
+ */
+template <class Provider>
+class OrOptSearch {
+    private:
+        Provider &dists;
+        const NeighborLists &nbrs;
+        bool fixed_ends;
+        int phantom;
+        int first_city;        // where the path began, or -1 if empty
+        CyclicTour cyc;
+        std::deque<int> queue;
+        vector<char> queued;   // a city is active while queued
+        double length;         // of the path, followed while a budget has a target
+
+        double len(int a, int b) {
+            return (a == phantom || b == phantom) ? 0.0 : dists.dist(a, b);
+        }
+        bool breakable(int a, int b) const {
+            return !fixed_ends || (a != phantom && b != phantom);
+        }
+        void wake(int city);
+        bool try_2opt(int a);
+        bool try_segment(int a);
+    public:
+        OrOptSearch(Provider &dists_in, const NeighborLists &nbrs_in,
+                    const vector<int> &tour, bool fixed_ends_in);
+        int run(const SolveBudget *budget = nullptr, bool *converged = nullptr);
+        vector<int> path() const;
+};
+
+template <class Provider>
+OrOptSearch<Provider>::OrOptSearch(Provider &dists_in, const NeighborLists &nbrs_in,
+                                   const vector<int> &tour, bool fixed_ends_in)
+    : dists(dists_in), nbrs(nbrs_in), fixed_ends(fixed_ends_in),
+      phantom(dists_in.size()), first_city(tour.empty() ? -1 : tour[0]),
+      queued(dists_in.size() + 1, 0), length(0.0) {
+    vector<int> cities(tour);
+    cities.push_back(phantom);
+    cyc = CyclicTour(cities, phantom + 1);
+    for (int city : tour) {
+        wake(city);
+    }
+}
+
+template <class Provider>
+void OrOptSearch<Provider>::wake(int city) {
+    if (city != phantom && !queued[city]) {
+        queued[city] = 1;
+        queue.push_back(city);
+    }
+}
+
+/**
+ * Tries to replace a tour edge at a by an edge from a to one of its
+ * listed neighbors, as in opt2_neighbor_improve().
+ */
+template <class Provider>
+bool OrOptSearch<Provider>::try_2opt(int a) {
+    for (int dir = 0; dir < 2; dir++) {
+        int b = (dir == 0) ? cyc.next(a) : cyc.prev(a);
+        if (!breakable(a, b)) continue;
+        double ab = len(a, b);
+        const int *cand = nbrs.of(a);
+
+        for (int m = 0; m < nbrs.per_point(); m++) {
+            int c = cand[m];
+            double ac = dists.dist(a, c);
+            // lists are sorted, so no later candidate can gain either
+            if (ab - ac <= 0) break;
+
+            int d = (dir == 0) ? cyc.next(c) : cyc.prev(c);
+            if (c == b || d == a || !breakable(c, d)) continue;
+
+            double gain = ab + len(c, d) - ac - len(b, d);
+            if (gain > OPT2_MIN_GAIN) {
+                cyc.exchange(a, b, c, d);
+                length -= gain;
+                wake(a);
+                wake(b);
+                wake(c);
+                wake(d);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Tries to move a segment with a at one end next to one of a's listed
+ * neighbors. In tour order the segment runs s1..s2, between p and nx,
+ * and is reinserted between u and v = next(u).
+ */
+template <class Provider>
+bool OrOptSearch<Provider>::try_segment(int a) {
+    for (int seg_len = 1; seg_len <= OROPT_MAX_SEGMENT; seg_len++) {
+        for (int dir = 0; dir < 2; dir++) {
+            if (seg_len == 1 && dir == 1) break;
+
+            int seg[OROPT_MAX_SEGMENT];
+            seg[0] = a;
+            bool valid = true;
+            for (int k = 1; k < seg_len && valid; k++) {
+                seg[k] = (dir == 0) ? cyc.next(seg[k-1]) : cyc.prev(seg[k-1]);
+                valid = seg[k] != phantom;
+            }
+            if (!valid) continue;
+
+            int s1 = (dir == 0) ? a : seg[seg_len - 1];
+            int s2 = (dir == 0) ? seg[seg_len - 1] : a;
+            int p = cyc.prev(s1);
+            int nx = cyc.next(s2);
+            if (!breakable(p, s1) || !breakable(s2, nx)) continue;
+
+            double cut_gain = len(p, s1) + len(s2, nx) - len(p, nx);
+            const int *cand = nbrs.of(a);
+
+            for (int m = 0; m < nbrs.per_point(); m++) {
+                int c = cand[m];
+                double ac = dists.dist(a, c);
+                if (cut_gain - ac <= OPT2_MIN_GAIN) break;
+
+                bool in_seg = false;
+                for (int k = 0; k < seg_len; k++) {
+                    in_seg = in_seg || seg[k] == c;
+                }
+                if (in_seg) continue;
+
+                // insert on either side of c, turned so that a touches c
+                for (int side = 0; side < 2; side++) {
+                    int u = (side == 0) ? c : cyc.prev(c);
+                    int v = (side == 0) ? cyc.next(c) : c;
+                    if (u == p || u == s2 || !breakable(u, v)) continue;
+
+                    bool flipped = (a == s1) == (u != c);
+                    int first = flipped ? s2 : s1;
+                    int last = flipped ? s1 : s2;
+                    double gain = cut_gain - (len(u, first) + len(last, v) - len(u, v));
+                    if (gain <= OPT2_MIN_GAIN) continue;
+
+                    // the first two exchanges insert the segment reversed,
+                    // the third turns it back if needed
+                    cyc.exchange(p, s1, u, v);
+                    cyc.exchange(p, u, nx, s2);
+                    if (!flipped && s1 != s2) {
+                        cyc.exchange(u, s2, s1, v);
+                    }
+                    length -= gain;
+                    int touched[6] = { p, nx, s1, s2, u, v };
+                    for (int t = 0; t < 6; t++) {
+                        wake(touched[t]);
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Applies improving moves until every city's neighborhood is exhausted,
+ * or budget, if not null, is spent or its target length is reached.
+ * Returns the number of moves applied.
+ * If converged is not null, whether the search ran to the end is stored
+ * there.
+ */
+template <class Provider>
+int OrOptSearch<Provider>::run(const SolveBudget *budget, bool *converged) {
+    int moves = 0;
+    if (converged) {
+        *converged = true;
+    }
+    if (cyc.size() < 5) return moves;
+
+    bool targeted = budget && budget->has_target();
+    if (targeted) {
+        length = 0.0;
+        for (int city = cyc.next(phantom); cyc.next(city) != phantom; city = cyc.next(city)) {
+            length += len(city, cyc.next(city));
+        }
+    }
+
+    long popped = 0;
+    while (!queue.empty()) {
+        if (budget && (budget->moves_spent(moves) || (targeted && budget->target_reached(length)) ||
+                       (popped++ % BUDGET_CHECK_INTERVAL == 0 && budget->expired()))) {
+            if (converged) {
+                *converged = false;
+            }
+            break;
+        }
+        int a = queue.front();
+        queue.pop_front();
+        queued[a] = 0;
+
+        if (try_2opt(a) || try_segment(a)) {
+            moves++;
+        }
+    }
+    return moves;
+}
+
+/**
+ * Returns the tour as an open path. With fixed_ends the path begins
+ * where the original one did.
+ */
+template <class Provider>
+vector<int> OrOptSearch<Provider>::path() const {
+    vector<int> cities = cyc.walk_from(phantom);
+    cities.erase(cities.begin());
+    if (fixed_ends && !cities.empty() && cities.front() != first_city) {
+        std::reverse(cities.begin(), cities.end());
+    }
+    return cities;
+}
+
+/**
+ * Runs OrOptSearch on tour in place. nbrs must have been built over
+ * the points of dists. Returns the number of moves applied; budget and
+ * converged are as for OrOptSearch::run().
+ */
+template <class Provider>
+int oropt_improve(Provider &dists, const NeighborLists &nbrs, vector<int> &tour,
+                  bool fixed_ends, const SolveBudget *budget = nullptr,
+                  bool *converged = nullptr) {
+    OrOptSearch<Provider> search(dists, nbrs, tour, fixed_ends);
+    int moves = search.run(budget, converged);
+    tour = search.path();
+    return moves;
+}
+
+#endif
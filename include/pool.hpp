@@ -0,0 +1,45 @@
+// pool.hpp
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+/**
+ * Fixed set of worker threads running submitted tasks. Each worker has
+ * its own queue: it takes its newest task first, and when its queue is
+ * empty it steals the oldest task from another worker's queue, so load
+ * evens out when tasks take very different times. Tasks must not throw.
+ */
+class WorkPool {
+    private:
+        struct TaskQueue {
+            std::mutex lock;
+            std::deque<std::function<void()> > tasks;
+        };
+        vector<std::unique_ptr<TaskQueue> > queues;   // one per worker
+        vector<std::thread> workers;
+        std::mutex state_lock;
+        std::condition_variable wake_cv;   // a task was queued, or stopping
+        std::condition_variable idle_cv;   // pending dropped to zero
+        int queued;                        // tasks in queues, not yet taken
+        int pending;                       // tasks submitted, not yet finished
+        int next_queue;
+        bool stopping;
+        bool take(int self, std::function<void()> &task);
+        void work(int self);
+    public:
+        explicit WorkPool(int num_threads = 0);
+        ~WorkPool();
+        int size() const;
+        void submit(std::function<void()> task);
+        void wait();
+};
+
+#endif
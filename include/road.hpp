@@ -0,0 +1,129 @@
+// road.hpp
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "coords.hpp"
+#include "instance.hpp"
+#include "kdtree.hpp"
+#include "metrics.hpp"
+using std::vector;
+
+#ifndef ROAD_HPP
+#define ROAD_HPP
+
+// nodes each witness search may settle while the hierarchy is built;
+// more finds more witnesses, so fewer shortcuts, but builds slower
+const int ROAD_WITNESS_SETTLE = 64;
+
+/**
+ * Shortest road distances over a road network, for trucks that drive
+ * on roads rather than in straight lines. Roads are taken as two-way,
+ * the shorter length winning where a file gives both directions, since
+ * the route heuristics expect symmetric distances.
+ *
+ * The network is preprocessed into a contraction hierarchy: nodes are
+ * ranked, least important first, and each is contracted in turn by
+ * adding shortcut edges between its remaining neighbors wherever the
+ * shortest path between them ran through it. Every shortest path then
+ * climbs to a highest node and descends again, so a query only
+ * searches upward from both ends, which settles a few hundred nodes
+ * even on a large network where Dijkstra's algorithm would settle most
+ * of them.
+ *
+ * Addresses are snapped to the nearest node of the largest connected
+ * part of the network, so every two of them are joined by roads.
+ * Queries are const and may be made from several threads at once.
+ */
+class RoadNetwork {
+    private:
+        struct Arc {
+            int to;
+            double len;
+        };
+        int n;
+        CoordStore nodes;
+        vector<int> rank;
+        // upward edges of each node, to higher ranked nodes, as ranges
+        // [up_first[v], up_first[v + 1]) of up_arcs
+        vector<int> up_first;
+        vector<Arc> up_arcs;
+        long num_shortcuts;
+        KdTree snap_tree;
+        vector<int> snap_node;   // node of each point of snap_tree
+        void build(vector<vector<Arc> > &adj);
+    public:
+        RoadNetwork(const RoadGraph &graph);
+        int size() const;
+        long shortcuts() const;
+        const CoordStore &get_nodes() const;
+        int snap(double x, double y) const;
+        void upward_search(int source, vector<std::pair<int, double> > &settled) const;
+        double node_distance(int s, int t) const;
+        vector<double> node_table(const vector<int> &sources, const vector<int> &targets) const;
+};
+
+/**
+ * Many one-to-many queries towards a fixed set of target nodes, with
+ * the bucket method: an upward search from each target leaves its
+ * distance in a bucket at every node it settles, and then one upward
+ * search from a source, reading the buckets of the nodes it settles,
+ * finds the distances to all targets.
+ */
+class RoadBuckets {
+    private:
+        const RoadNetwork *network;
+        int num_targets;
+        // (target, distance) entries of each node, as ranges
+        // [first[v], first[v + 1]) of entries
+        vector<int> first;
+        vector<std::pair<int, double> > entries;
+    public:
+        RoadBuckets(const RoadNetwork &network_in, const vector<int> &targets);
+        void distances_from(int source, double *out) const;
+};
+
+/**
+ * Distance over a road network, as a metric policy (see metrics.hpp),
+ * so every heuristic taking a distance provider can route on roads:
+ *
+ *     RoadMetric roads(std::make_shared<RoadNetwork>(load_road_graph(path)));
+ *     BasicDistanceProvider<RoadMetric> dists(list.get_coords(), roads);
+ *     AddressList route = list.greedy_route(dists).opt2_rearrange(dists);
+ *
+ * Each point is snapped to its nearest node, and the stretch between
+ * the point and its node is covered in a straight line. A single
+ * distance costs two upward searches. Providers filling a dense table,
+ * or rows of their row cache, get whole rows at once from RoadBuckets
+ * through metric_fill_rows(), which keeps the buckets for the points
+ * of the last CoordStore it was asked about; copies of a metric share
+ * them. No built-in search shares its ranking.
+ */
+struct RoadMetric {
+    struct RowState;
+    std::shared_ptr<const RoadNetwork> network;
+    std::shared_ptr<RowState> rows;
+    RoadMetric(std::shared_ptr<const RoadNetwork> network_in);
+    double operator()(double x1, double y1, double x2, double y2) const;
+    int kernel() const { return KERNEL_CUSTOM; }
+};
+
+/**
+ * The buckets a RoadMetric keeps for the points of one CoordStore,
+ * recognized by a copy of their coordinates.
+ */
+struct RoadMetric::RowState {
+    struct Points {
+        vector<double> xs, ys;
+        vector<int> node;
+        vector<double> leg;     // from each point to its node
+        std::unique_ptr<RoadBuckets> buckets;
+    };
+    std::mutex lock;
+    std::shared_ptr<const Points> last;
+};
+
+bool metric_fill_rows(const RoadMetric &metric, const CoordStore &coords, const int *rows,
+                      int count, double *out);
+
+#endif
@@ -0,0 +1,61 @@
+// simulation.hpp
+#include <random>
+#include <vector>
+#include "addresses.hpp"
+using std::vector;
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+// Day-by-day delivery simulation. Orders arrive every day with a
+// deadline some days ahead. Each truck serves one slice of the angle
+// around a central depot and keeps a standing Route through every
+// order it holds. Each day a truck delivers the orders that are due,
+// most overdue first, up to its capacity, driving them in the order of
+// its standing route. Whatever it cannot fit is carried over to the
+// next day, and orders not yet due stay on the standing route.
+
+struct SimulationConfig {
+    int num_trucks;
+    int orders_per_day;
+    int stops_per_day;      // most deliveries a truck makes in a day
+    int max_lead_days;      // deadlines fall 0 to this many days ahead
+    double side;            // orders fall in a square of this side
+    bool man_norm;
+    bool rebuild;           // re-solve routes from scratch every day
+    unsigned seed;
+
+    SimulationConfig()
+        : num_trucks(8), orders_per_day(1000), stops_per_day(150), max_lead_days(7),
+          side(1000.0), man_norm(true), rebuild(false), seed(1) { }
+};
+
+struct DayReport {
+    int day;
+    int released;     // orders that arrived
+    int delivered;
+    int late;         // deliveries made after their deadline day
+    int carried;      // orders due by today left for tomorrow
+    int backlog;      // orders held at the end of the day
+    double distance;  // driven by all trucks
+    double seconds;   // spent planning
+};
+
+class Simulation {
+    private:
+        SimulationConfig config;
+        Address depot;
+        vector<Route> plans;
+        std::mt19937 gen;
+        int day;
+        int truck_for(const Address &addr) const;
+        double length(const AddressList &route) const;
+    public:
+        Simulation(const SimulationConfig &config_in);
+        DayReport step();
+        int get_day() const;
+        int backlog() const;
+        const Route &get_plan(int truck) const;
+};
+
+#endif
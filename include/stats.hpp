@@ -0,0 +1,98 @@
+// stats.hpp
+#include <chrono>
+#include <functional>
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// Solver instrumentation. Entry points that take a SolveStats pointer
+// add their counts and phase times to it, and call its on_progress hook
+// after each phase and each improvement pass. Everything is compiled
+// only with -DROUTE_STATS (set STATS in the Makefile); otherwise the
+// recording macros below expand to nothing and a SolveStats passed in
+// is left untouched. Statements that only feed the recording, such as
+// counters taken before a phase, go in STATS_ONLY(...).
+
+enum SolvePhase {
+    PHASE_SETUP,       // building distance tables
+    PHASE_CONSTRUCT,   // building a first route
+    PHASE_IMPROVE,     // local search
+    NUM_PHASES
+};
+
+struct SolveStats {
+    long dist_evals;      // distances computed from coordinates
+    long moves_tried;     // candidate moves evaluated
+    long moves_applied;
+    long passes;          // improvement passes over the route
+    double length;        // of the route when last reported
+    double phase_seconds[NUM_PHASES];
+    std::function<void(const SolveStats &stats, SolvePhase phase)> on_progress;
+
+    SolveStats() {
+        reset();
+    }
+    void reset() {
+        dist_evals = moves_tried = moves_applied = passes = 0;
+        length = 0.0;
+        for (int p = 0; p < NUM_PHASES; p++) {
+            phase_seconds[p] = 0.0;
+        }
+    }
+};
+
+#ifdef ROUTE_STATS
+
+#define STATS_ADD(stats, field, amount) \
+    do { if (stats) (stats)->field += (amount); } while (0)
+#define STATS_SET(stats, field, value) \
+    do { if (stats) (stats)->field = (value); } while (0)
+#define STATS_REPORT(stats, phase) \
+    do { if ((stats) && (stats)->on_progress) (stats)->on_progress(*(stats), (phase)); } while (0)
+#define STATS_ONLY(...) __VA_ARGS__
+
+/**
+ * Adds the time from its construction to stop(), or else to its
+ * destruction, to one phase of stats, if stats is not null, and then
+ * reports that phase.
+ */
+class PhaseTimer {
+    private:
+        SolveStats *stats;
+        SolvePhase phase;
+        std::chrono::steady_clock::time_point start;
+    public:
+        PhaseTimer(SolveStats *stats_in, SolvePhase phase_in)
+            : stats(stats_in), phase(phase_in), start(std::chrono::steady_clock::now()) { }
+        ~PhaseTimer() {
+            stop();
+        }
+        void stop() {
+            if (stats) {
+                std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+                stats->phase_seconds[phase] += spent.count();
+                STATS_REPORT(stats, phase);
+                stats = nullptr;
+            }
+        }
+        PhaseTimer(const PhaseTimer &) = delete;
+        PhaseTimer &operator=(const PhaseTimer &) = delete;
+};
+
+#else
+
+// the stats pointer is still named, so it never goes unused
+#define STATS_ADD(stats, field, amount) do { (void) (stats); } while (0)
+#define STATS_SET(stats, field, value) do { (void) (stats); } while (0)
+#define STATS_REPORT(stats, phase) do { (void) (stats); } while (0)
+#define STATS_ONLY(...)
+
+class PhaseTimer {
+    public:
+        PhaseTimer(SolveStats *, SolvePhase) { }
+        void stop() { }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+// tour.hpp
+#include <vector>
+using std::vector;
+
+#ifndef TOUR_HPP
+#define TOUR_HPP
+
+/**
+ * A cyclic tour over integer city ids, stored as an array of cities in
+ * tour order plus the position of each city in that array. Successor
+ * and predecessor lookups are O(1). A reversal flips whichever side of
+ * the cycle is shorter, so it never touches more than half the cities;
+ * which side was flipped is not observable, since only adjacency
+ * matters in a cycle, but the direction next() walks in may change.
+ */
+class CyclicTour {
+    private:
+        vector<int> order;   // cities in tour order
+        vector<int> pos;     // position of each city in order, or -1
+    public:
+        CyclicTour();
+        CyclicTour(const vector<int> &cities, int num_ids);
+        int size() const { return order.size(); }
+        bool contains(int city) const;
+        int next(int city) const {
+            int p = pos[city] + 1;
+            return order[p == (int) order.size() ? 0 : p];
+        }
+        int prev(int city) const {
+            int p = pos[city];
+            return order[p == 0 ? order.size() - 1 : p - 1];
+        }
+        void reverse(int from, int to);
+        void exchange(int a, int b, int c, int d);
+        vector<int> walk_from(int start) const;
+};
+
+#endif
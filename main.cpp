@@ -1,10 +1,79 @@
 // main.cpp
+//
+// Simulates deliveries day by day (see simulation.hpp) and prints a
+// line per day and a summary:
+//
+//     ./main.out [--days N] [--trucks N] [--orders N] [--capacity N]
+//                [--lead N] [--seed N] [--rebuild]
+//
+// --orders is the number of orders arriving per day, --capacity the
+// most stops a truck makes in a day and --lead the most days ahead an
+// order is due. --rebuild re-solves every route from scratch each day
+// instead of repairing it, for comparison.
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <string>
+#include "include/simulation.hpp"
 
 using std::cout;
+using std::string;
 
-int main() {
-    cout << "Hello world!\n";
-    // file empty for now, check tester.cpp for implementation
+int main(int argc, char **argv) {
+    SimulationConfig config;
+    int days = 30;
+    for (int a = 1; a < argc; a++) {
+        string flag = argv[a];
+        if (flag == "--rebuild") {
+            config.rebuild = true;
+            continue;
+        }
+        if (a + 1 >= argc) {
+            std::cerr << "missing value for " << flag << "\n";
+            return 1;
+        }
+        int value = std::atoi(argv[++a]);
+        if (flag == "--days") {
+            days = value;
+        } else if (flag == "--trucks") {
+            config.num_trucks = value;
+        } else if (flag == "--orders") {
+            config.orders_per_day = value;
+        } else if (flag == "--capacity") {
+            config.stops_per_day = value;
+        } else if (flag == "--lead") {
+            config.max_lead_days = value;
+        } else if (flag == "--seed") {
+            config.seed = value;
+        } else {
+            std::cerr << "unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    Simulation sim(config);
+    long delivered = 0, late = 0;
+    double distance = 0.0, seconds = 0.0;
+    cout << std::left << std::setw(6) << "day" << std::right
+         << std::setw(10) << "released" << std::setw(11) << "delivered"
+         << std::setw(7) << "late" << std::setw(9) << "carried"
+         << std::setw(9) << "backlog" << std::setw(13) << "distance"
+         << std::setw(12) << "plan (s)" << "\n";
+    for (int d = 0; d < days; d++) {
+        DayReport report = sim.step();
+        delivered += report.delivered;
+        late += report.late;
+        distance += report.distance;
+        seconds += report.seconds;
+        cout << std::left << std::setw(6) << report.day << std::right
+             << std::setw(10) << report.released << std::setw(11) << report.delivered
+             << std::setw(7) << report.late << std::setw(9) << report.carried
+             << std::setw(9) << report.backlog
+             << std::setw(13) << std::fixed << std::setprecision(1) << report.distance
+             << std::setw(12) << std::setprecision(4) << report.seconds << "\n";
+    }
+    cout << "\n" << days << " days: " << delivered << " delivered, " << late << " late, "
+         << std::setprecision(1) << distance << " driven, "
+         << std::setprecision(3) << seconds << " s planning\n";
     return 0;
 }
@@ -1,9 +1,21 @@
 // addresses.cpp
 #include <cmath>
+#include <functional>
+#include <limits>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
 #include "../include/addresses.hpp"
+#include "../include/coords.hpp"
+#include "../include/distances.hpp"
+#include "../include/kdtree.hpp"
+#include "../include/metrics.hpp"
+#include "../include/neighbors.hpp"
+#include "../include/stats.hpp"
 
 using std::abs;
 using std::pow;
@@ -53,23 +65,237 @@ string Address::as_string() const {
     return ("(" + std::to_string(x) + "," + std::to_string(y) + ")");
 }
 
+size_t CoordHash::operator()(const std::pair<double, double> &key) const {
+    // adding 0.0 turns -0.0 into 0.0, which compares equal to it
+    size_t hx = std::hash<double>()(key.first + 0.0);
+    size_t hy = std::hash<double>()(key.second + 0.0);
+    return hx ^ (hy + 0x9e3779b9 + (hx << 6) + (hx >> 2));
+}
+
+static std::pair<double, double> coord_key(const Address &addr) {
+    return std::make_pair(addr.get_x(), addr.get_y());
+}
+
+/**
+ * Returns addr with its coordinates rounded as coords stores them.
+ */
+static Address rounded(const CoordStore &coords, const Address &addr) {
+    if (coords.get_precision() == COORD_DOUBLE) return addr;
+    return Address(coords.round(addr.get_x()), coords.round(addr.get_y()),
+                   addr.get_delivery_deadline());
+}
+
 // AddressList class
 
-AddressList::AddressList() { };
+AddressList::AddressList() : indexed(false) { };
+
+/**
+ * Gives ids to the count addresses just inserted before the given
+ * index, moves the positions of those after them up, and records each
+ * new address as the first of its kind unless an equal one comes
+ * before it.
+ */
+void AddressList::index_inserted(int index, int count) {
+    first_id.reserve(addrs.size());
+    vector<int> new_ids(count);
+    for (int k = 0; k < count; k++) {
+        new_ids[k] = pos_of.size();
+        pos_of.push_back(index + k);
+    }
+    id_at.insert(id_at.begin() + index, new_ids.begin(), new_ids.end());
+    for (int p = index + count; p < (int) id_at.size(); p++) {
+        pos_of[id_at[p]] = p;
+    }
+
+    for (int p = index; p < index + count; p++) {
+        auto res = first_id.insert(std::make_pair(coord_key(addrs[p]), id_at[p]));
+        if (!res.second && pos_of[res.first->second] > p) {
+            res.first->second = id_at[p];
+        }
+    }
+}
+
+/**
+ * Inserts an address before the given index, keeping the
+ * coordinate store in step with the address vector.
+ * All insertions into addrs should go through here.
+ */
+void AddressList::insert_address(int index, const Address &addr_in) {
+    Address addr = rounded(coords, addr_in);
+    indexed = false;
+    if (index == (int) addrs.size()) {
+        addrs.push_back(addr);
+        coords.push_back(addr.get_x(), addr.get_y());
+    } else {
+        addrs.insert(addrs.begin() + index, addr);
+        coords.insert(index, addr.get_x(), addr.get_y());
+    }
+    index_inserted(index, 1);
+}
+
+/**
+ * Inserts a run of addresses before the given index, preserving
+ * their order. Same bookkeeping as insert_address().
+ */
+void AddressList::insert_addresses(int index, const vector<Address> &more_addrs) {
+    indexed = false;
+    vector<double> more_xs, more_ys;
+    more_xs.reserve(more_addrs.size());
+    more_ys.reserve(more_addrs.size());
+    for (const Address &addr : more_addrs) {
+        more_xs.push_back(addr.get_x());
+        more_ys.push_back(addr.get_y());
+    }
+    coords.insert(index, more_xs, more_ys);
+    addrs.insert(addrs.begin() + index, more_addrs.begin(), more_addrs.end());
+    if (coords.get_precision() != COORD_DOUBLE) {
+        for (int p = index; p < index + (int) more_addrs.size(); p++) {
+            addrs[p] = Address(coords.x_at(p), coords.y_at(p), addrs[p].get_delivery_deadline());
+        }
+    }
+    index_inserted(index, more_addrs.size());
+}
+
+/**
+ * Inserts the stops of inst before the given index, building their
+ * addresses in place. Same bookkeeping as insert_address().
+ */
+void AddressList::insert_instance(int index, const Instance &inst) {
+    indexed = false;
+    const CoordStore &more = inst.coords;
+    int count = more.size();
+    if (addrs.empty()) {
+        CoordPrecision precision = coords.get_precision();
+        double unit = coords.get_unit();
+        coords = more;
+        coords.set_precision(precision, unit);
+    } else {
+        coords.insert(index, vector<double>(more.x_data(), more.x_data() + count),
+                      vector<double>(more.y_data(), more.y_data() + count));
+    }
+    addrs.insert(addrs.begin() + index, count, Address(0, 0, 0));
+    for (int k = 0; k < count; k++) {
+        addrs[index + k] = Address(coords.x_at(index + k), coords.y_at(index + k),
+                                   inst.deadlines[k]);
+    }
+    index_inserted(index, count);
+}
+
+/**
+ * Removes the addresses at the given indices, which must be sorted and
+ * valid, in one pass. The others keep their ids, and an address equal
+ * to a removed one that was the first of its kind takes over as first.
+ * All removals from addrs should go through here.
+ */
+void AddressList::erase_addresses(const vector<int> &positions) {
+    indexed = false;
+    std::unordered_set<std::pair<double, double>, CoordHash> lost_first;
+    CoordStore kept_coords;
+    kept_coords.set_precision(coords.get_precision(), coords.get_unit());
+    kept_coords.reserve(addrs.size() - positions.size());
+    int kept = 0, next_gone = 0;
+    for (int p = 0; p < (int) addrs.size(); p++) {
+        if (next_gone < (int) positions.size() && positions[next_gone] == p) {
+            next_gone++;
+            pos_of[id_at[p]] = -1;
+            auto it = first_id.find(coord_key(addrs[p]));
+            if (it->second == id_at[p]) {
+                lost_first.insert(it->first);
+                first_id.erase(it);
+            }
+            continue;
+        }
+        addrs[kept] = addrs[p];
+        id_at[kept] = id_at[p];
+        pos_of[id_at[kept]] = kept;
+        kept_coords.push_back(addrs[kept].get_x(), addrs[kept].get_y());
+        kept++;
+    }
+    addrs.erase(addrs.begin() + kept, addrs.end());
+    id_at.resize(kept);
+    coords = kept_coords;
+
+    for (int p = 0; p < kept && !lost_first.empty(); p++) {
+        if (lost_first.erase(coord_key(addrs[p]))) {
+            first_id[coord_key(addrs[p])] = id_at[p];
+        }
+    }
+}
+
+/**
+ * Rearranges the addresses from index first on, so that the address
+ * k places after first is the one that was order[k] places after it.
+ */
+void AddressList::reorder_addresses(int first, const vector<int> &order) {
+    indexed = false;
+    int last = first + order.size();
+    vector<Address> moved;
+    moved.reserve(order.size());
+    for (int ind : order) {
+        moved.push_back(addrs[first + ind]);
+    }
+    for (int p = first; p < last; p++) {
+        addrs[p] = moved[p - first];
+        coords.set(p, moved[p - first].get_x(), moved[p - first].get_y());
+    }
+
+    vector<int> moved_ids;
+    moved_ids.reserve(order.size());
+    for (int ind : order) {
+        moved_ids.push_back(id_at[first + ind]);
+    }
+    for (int p = first; p < last; p++) {
+        id_at[p] = moved_ids[p - first];
+        pos_of[id_at[p]] = p;
+    }
+
+    // the first of equal addresses may have changed within the range
+    for (int p = first; p < last; p++) {
+        int &first_of = first_id.find(coord_key(addrs[p]))->second;
+        if (pos_of[first_of] >= p) {
+            first_of = id_at[p];
+        }
+    }
+}
+
+/**
+ * Returns a new list of the addresses at the indices in tour, in that
+ * order, gathered with one bulk insert.
+ */
+AddressList AddressList::permuted(const vector<int> &tour) const {
+    vector<Address> ordered;
+    ordered.reserve(tour.size());
+    for (int ind : tour) {
+        ordered.push_back(addrs[ind]);
+    }
+    AddressList path;
+    path.set_precision(coords.get_precision(), coords.get_unit());
+    path.insert_addresses(0, ordered);
+    return path;
+}
 
 /**
  * Appends a vector of addresses to the current AddressList,
  * preserving order.
  */
-void AddressList::bulk_add_addresses(vector<Address> more_addrs) {
-    addrs.insert(addrs.end(), more_addrs.begin(), more_addrs.end());
+void AddressList::bulk_add_addresses(const vector<Address> &more_addrs) {
+    insert_addresses(addrs.size(), more_addrs);
+}
+
+/**
+ * Appends the stops of a loaded instance. If the list is empty, it
+ * takes over the instance's coordinate store as it is, so the
+ * coordinates of a memory-mapped file are not copied.
+ */
+void AddressList::add_instance(const Instance &inst) {
+    insert_instance(addrs.size(), inst);
 }
 
 /**
  * Adds an address to the end of the list.
  */
 void AddressList::add_address(Address addr) {
-    addrs.push_back(addr);
+    insert_address(addrs.size(), addr);
 };
 
 /**
@@ -88,6 +314,50 @@ const Address &AddressList::get_final_addr() const {
     return addrs.back();
 }
 
+/**
+ * Returns the index of the first address equal to addr, or -1 if
+ * there is none, in expected O(1) time from a hash of coordinates.
+ */
+int AddressList::index_of(const Address &addr) const {
+    if (coords.get_precision() == COORD_FIXED) {
+        // an address off the grid cannot be in the list
+        double limit = (FIXED_COORD_LIMIT + 0.5) * coords.get_unit();
+        if ((std::isfinite(addr.get_x()) && std::abs(addr.get_x()) >= limit) ||
+            (std::isfinite(addr.get_y()) && std::abs(addr.get_y()) >= limit)) {
+            return -1;
+        }
+    }
+    auto it = first_id.find(coord_key(rounded(coords, addr)));
+    return (it == first_id.end()) ? -1 : pos_of[it->second];
+}
+
+/**
+ * Sets the precision with which the list keeps coordinates (see
+ * CoordPrecision), rounding the addresses already in it and every one
+ * added later, so lengths and nearest-address searches use the rounded
+ * coordinates. Addresses that round to the same point become equal.
+ * Routes built from the list keep its precision.
+ * Throws std::invalid_argument as CoordStore::set_precision() does,
+ * leaving the list unchanged.
+ */
+void AddressList::set_precision(CoordPrecision precision, double unit) {
+    coords.set_precision(precision, unit);
+    indexed = false;
+    first_id.clear();
+    for (int p = 0; p < (int) addrs.size(); p++) {
+        addrs[p] = Address(coords.x_at(p), coords.y_at(p), addrs[p].get_delivery_deadline());
+        first_id.insert(std::make_pair(coord_key(addrs[p]), id_at[p]));
+    }
+}
+
+/**
+ * Returns the structure-of-arrays view of the address coordinates,
+ * in the same order as the addresses themselves.
+ */
+const CoordStore &AddressList::get_coords() const {
+    return coords;
+}
+
 bool AddressList::empty() const {
     return addrs.empty();
 }
@@ -96,58 +366,61 @@ int AddressList::size() const {
     return addrs.size();
 }
 
-double AddressList::vectorial_length(vector<Address> path, bool man_norm) const {
-    double sum_len = 0.0;
+double AddressList::euc_length() const {
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return vectorial_length(dists);
+}
 
-    if (man_norm) {
-        for (int i = 1; i < path.size(); i++) {
-            sum_len += path.at(i).manhattan_dist(path.at(i-1));
-        }
-    } else {
-        for (int i = 1; i < path.size(); i++) {
-            sum_len += path.at(i).euclidean_dist(path.at(i-1));
-        }
-    }
+double AddressList::man_length() const {
+    BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+    return vectorial_length(dists);
+}
 
-    return sum_len;
+/**
+ * Throws std::invalid_argument unless a provider of the given size
+ * covers exactly the addresses of this list.
+ */
+void AddressList::check_provider(int provider_size) const {
+    if (provider_size != (int) addrs.size()) {
+        throw std::invalid_argument("distance provider does not match address list");
+    }
 }
 
-double AddressList::euc_length() const {
-    return vectorial_length(addrs, false);
+/**
+ * Returns the delivery deadline of each address, in order, as used by
+ * the deadline-aware members.
+ */
+vector<double> AddressList::deadline_times() const {
+    vector<double> due(addrs.size());
+    for (int i = 0; i < (int) addrs.size(); i++) {
+        due[i] = addrs[i].get_delivery_deadline();
+    }
+    return due;
 }
 
-double AddressList::man_length() const {
-    return vectorial_length(addrs, true);
+/**
+ * Builds a k-d tree over the current addresses. Until the list is next
+ * modified, euc_index_closest_to() and man_index_closest_to() answer
+ * from the tree in about O(log n) instead of scanning every address,
+ * which pays off when many queries are made against the same list.
+ */
+void AddressList::build_spatial_index() {
+    index = KdTree(coords);
+    indexed = true;
 }
 
 int AddressList::euc_index_closest_to(Address addr) const {
-    int best_ind = -1;
-    double best_len = std::numeric_limits<double>::max();
-
-    for (int i = 0; i < addrs.size(); i++) {
-        double test_len = addr.euclidean_dist(addrs.at(i));
-        if (test_len < best_len) {
-            best_len = test_len;
-            best_ind = i;
-        }
+    if (indexed) {
+        return index.nearest(addr.get_x(), addr.get_y(), false);
     }
-
-    return best_ind;
+    return coords.nearest(addr.get_x(), addr.get_y(), false);
 }
 
 int AddressList::man_index_closest_to(Address addr) const {
-    int best_ind = -1;
-    double best_len = std::numeric_limits<double>::max();
-
-    for (int i = 0; i < addrs.size(); i++) {
-        double test_len = addr.manhattan_dist(addrs.at(i));
-        if (test_len < best_len) {
-            best_len = test_len;
-            best_ind = i;
-        }
+    if (indexed) {
+        return index.nearest(addr.get_x(), addr.get_y(), true);
     }
-
-    return best_ind;
+    return coords.nearest(addr.get_x(), addr.get_y(), true);
 }
 
 /**
@@ -156,65 +429,56 @@ int AddressList::man_index_closest_to(Address addr) const {
  * next address is the nearest unvisited one. Distance is calculated
  * with the Manhattan norm if man_norm is true, or the Euclidean
  * norm otherwise. The route is returned as a new AddressList,
- * keeping the original constant.
+ * keeping the original constant. If stats is not null, the work
+ * done is added to it (see stats.hpp).
  */
-AddressList AddressList::greedy_route(bool man_norm) const {
-    // construct route starting with first address in list,
-    // using locally closest address at each step
-    // time complexity O(n^2)
-    AddressList path;
-    
-    if (addrs.size() <= 2) {
-        for (Address elem : addrs) {
-            path.add_address(elem);
-        }
-        return path;
-    }
-
-    path.add_address(addrs.at(0));
-
-    // mark address 0 as "already included"
-    vector<bool> includedAddrs(addrs.size());
-    includedAddrs[0] = true;
-    int addrsRem = addrs.size() - 1;
-
-    // why do it this way? because alternatives are not very good
-    // 1. modify original array - avoid
-    // 2. make copy and modify - how would you modify?
-    //   a. delete elements - way too much copying
-    //   b. insert nullptr or something - ok but you still made a copy
-    //   and now we have to switch to pointers vs objects
-    // 3. (our choice) make bool vector showing unaccessed addresses
-    // efficient and saves space compared to copying objects
-
-    while (addrsRem > 0) {
-        Address curr = path.get_final_addr();
-        // find index of nearest address
-        int nearestInd = -1;
-        int nearestDist = std::numeric_limits<int>::max();
-        
-        for (int i = 0; i < addrs.size(); i++) {
-            if (!includedAddrs[i]) {
-                int dist;
-                if (man_norm) {
-                    dist = curr.manhattan_dist(addrs.at(i));
-                } else {
-                    dist = curr.euclidean_dist(addrs.at(i));
-                }
-                if (dist < nearestDist) {
-                    nearestDist = dist;
-                    nearestInd = i;
-                }
-            }
-        }
-
-        // add it to the path
-        path.add_address(addrs.at(nearestInd));
-        includedAddrs[nearestInd] = true;
-        addrsRem--;
+AddressList AddressList::greedy_route(bool man_norm, SolveStats *stats) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return greedy_route(dists, stats);
     }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return greedy_route(dists, stats);
+}
 
-    return path;
+/**
+ * Returns a route starting at the first address in the AddressList
+ * that visits the others in the order of a Hilbert curve laid over
+ * them, run in the direction that starts closer to the first address.
+ * It takes O(n log n) time, like greedy_route() but a few times
+ * faster, and is typically about a tenth longer, so it suits very
+ * large lists, as a start for local search. Distance is calculated
+ * with the Manhattan norm if man_norm is true, or the Euclidean norm
+ * otherwise. The route is returned as a new AddressList, keeping the
+ * original constant.
+ */
+AddressList AddressList::hilbert_route(bool man_norm) const {
+    return permuted(hilbert_path(coords, false, man_norm));
+}
+
+/**
+ * Reorders this list in place as hilbert_route() would, without making
+ * a copy. Since the addresses are stored in list order, this also puts
+ * them in memory in a spatially coherent order, so that the local
+ * searches, neighbor lists and distance providers built over the list
+ * afterwards mostly touch nearby memory.
+ */
+void AddressList::hilbert_reorder(bool man_norm) {
+    reorder_addresses(0, hilbert_path(coords, false, man_norm));
+}
+
+/**
+ * Returns a route starting at the first address in the AddressList,
+ * built by joining the shortest candidate edges between neighboring
+ * addresses into paths, and then joining the paths (see
+ * greedy_edge_path()). It avoids most of the long edges back across
+ * the map that greedy_route() leaves, which makes it the better start
+ * for local search. Distance is calculated with the Manhattan norm if
+ * man_norm is true, or the Euclidean norm otherwise. The route is
+ * returned as a new AddressList, keeping the original constant.
+ */
+AddressList AddressList::greedy_edge_route(bool man_norm) const {
+    return permuted(greedy_edge_path(coords, false, man_norm));
 }
 
 /**
@@ -226,69 +490,221 @@ AddressList AddressList::greedy_route(bool man_norm) const {
  * norm if man_norm is true, or the Euclidean norm otherwise.
  */
 AddressList AddressList::opt2_rearrange(bool man_norm) const {
-    if (addrs.size() <= 2) {
-        AddressList path;
-        path.bulk_add_addresses(addrs);
-        return path;
-    }
-
-    vector<Address> newAddrs = addrs;
-
-    //double best_dist = vectorial_length(newAddrs, man_norm);
-    bool changed;
-
-    do {
-        changed = false;
-        for (int i = 0; i < addrs.size() - 1; i++) {
-            for (int j = i + 1; j < addrs.size(); j++) {
-                // test change that would be incurred in length by
-                // swapping addresses i and j
-                double old_len, new_len;
-                if ((i != 0) && (j != addrs.size() - 1)) {
-                    if (man_norm) {
-                        old_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(i)) + newAddrs.at(j).manhattan_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(j)) + newAddrs.at(i).manhattan_dist(newAddrs.at(j+1));
-                    } else {
-                        old_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(i)) + newAddrs.at(j).euclidean_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(j)) + newAddrs.at(i).euclidean_dist(newAddrs.at(j+1));
-                    }
-                } else if ((i == 0) && (j == addrs.size() - 1)) {
-                    // dummy values to skip this case
-                    // this just reverses the entire list, there is no point
-                    old_len = 0.0;
-                    new_len = 1.0;
-                } else if (i == 0) { // j != size - 1
-                    if (man_norm) {
-                        old_len = newAddrs.at(j).manhattan_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i).manhattan_dist(newAddrs.at(j+1));
-                    } else {
-                        old_len = newAddrs.at(j).euclidean_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i).euclidean_dist(newAddrs.at(j+1));
-                    }
-                } else { // j == size - 1 and i != 0
-                    if (man_norm) {
-                        old_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(i));
-                        new_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(j));
-                    } else {
-                        old_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(i));
-                        new_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(j));
-                    }
-                }
-                if (old_len - new_len > 0) { // path shortens, so do the swap
-                    std::reverse(newAddrs.begin()+i, newAddrs.begin()+j+1);
-                    //best_dist -= (old_len - new_len);
-                    changed = true;
-                    goto quadbreak; // i'm so sorry
-                }
-            }
-        }
-        quadbreak:
-        ; // prevent the compiler from whining (i'm really seriously sorry)
-    } while (changed);
+    return opt2_rearrange(man_norm, OPT2_FIRST);
+}
 
-    AddressList path;
-    path.bulk_add_addresses(newAddrs);
-    return path;
+/**
+ * As opt2_rearrange(bool), choosing how improving moves are applied:
+ * OPT2_FIRST takes each one as soon as it is found, OPT2_BEST only the
+ * best of each full scan, and OPT2_SWEEP the best for each position in
+ * turn. If final_len is not null, the length of the returned route is
+ * stored there; it is tracked during the search, so no extra walk over
+ * the route is needed. If stats is not null, the work done is added to
+ * it and reported after every pass (see stats.hpp).
+ * If budget is not null, the search stops once it is spent (see
+ * budget.hpp) and returns the shortest route it has reached; if
+ * converged is not null, whether the search instead ran until no
+ * improving move was left is stored there.
+ */
+AddressList AddressList::opt2_rearrange(bool man_norm, Opt2Strategy strategy,
+                                        double *final_len, SolveStats *stats,
+                                        const SolveBudget *budget, bool *converged) const {
+    // each pass reads O(n^2) distances, so a table usually pays for itself
+    PhaseTimer setup(stats, PHASE_SETUP);
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        setup.stop();
+        STATS_ADD(stats, dist_evals, dists.evaluations());
+        return opt2_rearrange(dists, strategy, final_len, stats, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    setup.stop();
+    STATS_ADD(stats, dist_evals, dists.evaluations());
+    return opt2_rearrange(dists, strategy, final_len, stats, budget, converged);
+}
+
+/**
+ * As opt2_rearrange(bool), with the search for improving moves split
+ * over num_threads threads, or one per hardware thread if num_threads
+ * is 0. Each round applies a batch of the best non-overlapping moves.
+ * The route returned depends only on this list, not on the number of
+ * threads or their timing. If final_len is not null, the length of the
+ * returned route is stored there. budget and converged are as for
+ * opt2_rearrange(bool, strategy, ...), except that the budget is only
+ * checked between rounds and moves.
+ */
+AddressList AddressList::opt2_rearrange_parallel(bool man_norm, int num_threads,
+                                                 double *final_len, const SolveBudget *budget,
+                                                 bool *converged) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return opt2_rearrange_parallel(dists, num_threads, final_len, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return opt2_rearrange_parallel(dists, num_threads, final_len, budget, converged);
+}
+
+/**
+ * Attempts to shorten a route with 2-opt restricted to the candidate
+ * neighbor lists nbrs, which must have been built from this list's
+ * coordinates (see get_coords()) and can be reused across calls.
+ * Instead of trying every pair of positions, only moves that link an
+ * address to one of its listed neighbors are tried, and addresses
+ * whose neighborhood has nothing to offer are skipped until a nearby
+ * move changes their edges (don't-look bits). This is far faster than
+ * opt2_rearrange(bool) on large lists, at a small cost in quality.
+ * Otherwise follows the specification of opt2_rearrange(bool), with
+ * budget and converged as for opt2_rearrange(bool, strategy, ...).
+ * Throws std::invalid_argument if nbrs is for a different size of list.
+ */
+AddressList AddressList::opt2_rearrange(bool man_norm, const NeighborLists &nbrs,
+                                        const SolveBudget *budget, bool *converged) const {
+    // the moves tried are scattered, so tables would mostly go unused
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return opt2_rearrange(dists, nbrs, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return opt2_rearrange(dists, nbrs, budget, converged);
+}
+
+/**
+ * Attempts to shorten a route with a local search over the candidate
+ * neighbor lists nbrs that, besides 2-opt moves, moves runs of up to
+ * three consecutive addresses to a better place in the route, in
+ * either direction (Or-opt). This finds improvements that 2-opt alone
+ * cannot, typically a few percent of the route length, and its moves
+ * cost at most half the route to apply, so it scales to very large
+ * lists. nbrs must have been built from this list's coordinates.
+ * Otherwise follows the specification of opt2_rearrange(bool, nbrs,
+ * budget, converged).
+ */
+AddressList AddressList::oropt_rearrange(bool man_norm, const NeighborLists &nbrs,
+                                         const SolveBudget *budget, bool *converged) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return oropt_rearrange(dists, nbrs, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return oropt_rearrange(dists, nbrs, budget, converged);
+}
+
+/**
+ * Builds routes from starts different starting points in parallel and
+ * returns the shortest. Each start builds a greedy route, from the
+ * first address for start 0 and from a randomly chosen address
+ * otherwise, then improves it as oropt_rearrange() does. The starts
+ * run on num_threads threads, or one per hardware thread if it is 0,
+ * and skip improving routes that are clearly worse than the best so
+ * far. The same seed gives the same random starting points. Distance
+ * is calculated with the Manhattan norm if man_norm is true, or the
+ * Euclidean norm otherwise.
+ */
+AddressList AddressList::multistart_route(bool man_norm, int starts, int num_threads,
+                                          unsigned seed) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return multistart_route(dists, starts, num_threads, seed);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return multistart_route(dists, starts, num_threads, seed);
+}
+
+/**
+ * Searches beyond the first local optimum with simulated annealing:
+ * starting from the greedy route, shortened as oropt_rearrange() does,
+ * replicas copies of the route take random 2-opt and relocate moves,
+ * accepting some that make it longer, each at its own temperature and
+ * on its own thread (num_threads, or one per hardware thread if 0).
+ * Copies at neighboring temperatures periodically trade places
+ * (parallel tempering), and all of them cool over sweeps rounds of one
+ * proposed move per address. Returns the shortest route seen. The same
+ * seed gives the same route, whatever the number of threads. If budget
+ * is not null, the search stops early once it is spent (see budget.hpp).
+ * Distance is calculated with the Manhattan norm if man_norm is true,
+ * or the Euclidean norm otherwise.
+ */
+AddressList AddressList::anneal_route(bool man_norm, int replicas, int sweeps, unsigned seed,
+                                      int num_threads, const SolveBudget *budget) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return anneal_route(dists, replicas, sweeps, seed, num_threads, budget);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return anneal_route(dists, replicas, sweeps, seed, num_threads, budget);
+}
+
+/**
+ * Returns the total lateness of the list driven in order: the truck
+ * leaves the first address at time 0, takes as long to reach each
+ * address as the distance to it, and every address reached after its
+ * delivery deadline adds how late it is. If late_count is not null,
+ * the number of late addresses is stored there. Distance is calculated
+ * with the Manhattan norm if man_norm is true, or the Euclidean norm
+ * otherwise.
+ */
+double AddressList::lateness(bool man_norm, int *late_count) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return lateness(dists, late_count);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return lateness(dists, late_count);
+}
+
+/**
+ * Returns a route starting at the first address that visits the others
+ * earliest deadline first, nearest first among equal deadlines, and is
+ * then shortened as deadline_rearrange() does. Lateness is measured as
+ * for lateness(). Distance is calculated with the Manhattan norm if
+ * man_norm is true, or the Euclidean norm otherwise.
+ */
+AddressList AddressList::deadline_route(bool man_norm) const {
+    // each pass reads O(n^2) distances, so a table usually pays for itself
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return deadline_route(dists);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return deadline_route(dists);
+}
+
+/**
+ * Shortens the route with 2-opt and single-address moves that respect
+ * delivery deadlines: no address on time becomes late and no late
+ * address becomes later, so lateness() never grows. The first address
+ * keeps its place. Each move is checked against the deadlines in
+ * constant time. Distance is calculated with the Manhattan norm if
+ * man_norm is true, or the Euclidean norm otherwise.
+ */
+AddressList AddressList::deadline_rearrange(bool man_norm) const {
+    // each pass reads O(n^2) distances, so a table usually pays for itself
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return deadline_rearrange(dists);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return deadline_rearrange(dists);
+}
+
+/**
+ * Returns a lower bound on the length of any route through the list's
+ * addresses, starting and ending anywhere, from Held-Karp subgradient
+ * ascent (see held_karp_bound() in bound.hpp). The list's own length is
+ * the known route the ascent aims at, so it stops once the bound is
+ * within target_gap of it, after max_iters steps, or once budget, if
+ * not null, is spent. LowerBound::gap() then tells how far the list
+ * may be from the shortest route. Distance is calculated with the
+ * Manhattan norm if man_norm is true, or the Euclidean norm otherwise.
+ */
+LowerBound AddressList::lower_bound(bool man_norm, double target_gap, int max_iters,
+                                    const SolveBudget *budget) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return lower_bound(dists, target_gap, max_iters, budget);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return lower_bound(dists, target_gap, max_iters, budget);
 }
 
 string AddressList::as_string() const {
@@ -312,15 +728,28 @@ string AddressList::as_string() const {
  * start and end depot.
  */
 Route::Route(int depot_delivery_date) {
-    addrs.push_back(Address(0, 0, depot_delivery_date));
-    addrs.push_back(Address(0, 0, depot_delivery_date));
+    insert_address(0, Address(0, 0, depot_delivery_date));
+    insert_address(1, Address(0, 0, depot_delivery_date));
 };
 
 Route::Route(Address startDepot, Address endDepot)  {
-    addrs.push_back(startDepot);
-    addrs.push_back(endDepot);
+    insert_address(0, startDepot);
+    insert_address(1, endDepot);
 };
 
+/**
+ * As AddressList::deadline_times(), except that the depots are not
+ * deliveries and so have no deadline.
+ */
+vector<double> Route::deadline_times() const {
+    vector<double> due = AddressList::deadline_times();
+    if (!due.empty()) {
+        due.front() = std::numeric_limits<double>::infinity();
+        due.back() = std::numeric_limits<double>::infinity();
+    }
+    return due;
+}
+
 /**
  * Adds the address right before the end depot.
  * If there are less than 2 addresses, appends to the
@@ -328,9 +757,9 @@ Route::Route(Address startDepot, Address endDepot)  {
  */
 void Route::add_address(Address addr) {
     if (addrs.size() < 2) {
-        addrs.push_back(addr);
+        insert_address(addrs.size(), addr);
     } else {
-        addrs.insert(addrs.end()-1, addr);
+        insert_address(addrs.size() - 1, addr);
     }
 }
 
@@ -339,11 +768,24 @@ void Route::add_address(Address addr) {
  * preserving order. If there are less than 2 addresses,
  * appends to the end of the list instead.
  */
-void Route::bulk_add_addresses(vector<Address> more_addrs) {
+void Route::bulk_add_addresses(const vector<Address> &more_addrs) {
+    if (addrs.size() < 2) {
+        insert_addresses(addrs.size(), more_addrs);
+    } else {
+        insert_addresses(addrs.size() - 1, more_addrs);
+    }
+}
+
+/**
+ * Inserts the stops of a loaded instance right before the end depot,
+ * preserving order. If there are less than 2 addresses, appends to
+ * the end of the list instead.
+ */
+void Route::add_instance(const Instance &inst) {
     if (addrs.size() < 2) {
-        addrs.insert(addrs.end(), more_addrs.begin(), more_addrs.end());
+        insert_instance(addrs.size(), inst);
     } else {
-        addrs.insert(addrs.end() - 1, more_addrs.begin(), more_addrs.end());
+        insert_instance(addrs.size() - 1, inst);
     }
 }
 
@@ -355,21 +797,206 @@ void Route::bulk_add_addresses(vector<Address> more_addrs) {
  */
 void Route::add_unique_address(Address addr) {
     // check if address is already being delivered to
-    vector<Address>::iterator it = std::find(addrs.begin(), addrs.end(), addr);
+    int found = index_of(addr);
 
-    if (it == addrs.end()) { // if not, add it
+    if (found < 0) { // if not, add it
         if (addrs.size() < 2) {
-            addrs.push_back(addr);
+            insert_address(addrs.size(), addr);
         } else {
-            addrs.insert(addrs.end()-1, addr);
+            insert_address(addrs.size() - 1, addr);
         }
     } else { // if so, update the delivery time if needed
-        if (addrs.at(it - addrs.begin()).get_delivery_deadline() > addr.get_delivery_deadline()) {
-            addrs.at(it - addrs.begin()).set_delivery_deadline(addr.get_delivery_deadline());
+        if (addrs.at(found).get_delivery_deadline() > addr.get_delivery_deadline()) {
+            addrs.at(found).set_delivery_deadline(addr.get_delivery_deadline());
         }
     }
 }
 
+/**
+ * Adds a stop to an already optimized route without reoptimizing all
+ * of it. If an equal address is on the route, only its delivery time
+ * is updated, as in add_unique_address(). Otherwise the stop is put
+ * where it lengthens the route least among the edges next to its
+ * INSERT_NEIGHBORS nearest stops, and the INSERT_REPAIR_RADIUS stops
+ * on either side are then reordered with 2-opt. The depots keep their
+ * places. Distance is calculated with the Manhattan norm if man_norm
+ * is true, or the Euclidean norm otherwise.
+ */
+void Route::insert_cheapest(Address addr, bool man_norm) {
+    addr = rounded(coords, addr);
+    int found = index_of(addr);
+    if (found >= 0 || addrs.size() < 2) {
+        add_unique_address(addr);
+        return;
+    }
+
+    auto dist = [man_norm](const Address &a, const Address &b) {
+        return man_norm ? a.manhattan_dist(b) : a.euclidean_dist(b);
+    };
+    auto added_len = [&](int e) {
+        return dist(addrs[e], addr) + dist(addr, addrs[e+1]) - dist(addrs[e], addrs[e+1]);
+    };
+
+    // the edge into the end depot is always a fallback
+    int best_edge = addrs.size() - 2;
+    double best_len = added_len(best_edge);
+    for (int near : insert_candidates(addr, man_norm)) {
+        for (int e = near - 1; e <= near; e++) {
+            if (e < 0 || e > (int) addrs.size() - 2) continue;
+            double len = added_len(e);
+            if (len < best_len) {
+                best_len = len;
+                best_edge = e;
+            }
+        }
+    }
+
+    insert_address(best_edge + 1, addr);
+    pending_coords.push_back(addr.get_x(), addr.get_y());
+    repair_around(best_edge + 1, man_norm);
+}
+
+/**
+ * Removes stops from an already optimized route without reoptimizing
+ * all of it: the INSERT_REPAIR_RADIUS stops on either side of each gap
+ * left behind are reordered with 2-opt, as after insert_cheapest().
+ * positions may come in any order, and repeats are ignored. Distance
+ * is calculated with the Manhattan norm if man_norm is true, or the
+ * Euclidean norm otherwise.
+ * Throws std::invalid_argument if a position is not that of a stop
+ * between the depots.
+ */
+void Route::remove_stops(const vector<int> &positions, bool man_norm) {
+    vector<int> gone(positions);
+    std::sort(gone.begin(), gone.end());
+    gone.erase(std::unique(gone.begin(), gone.end()), gone.end());
+    for (int p : gone) {
+        if (p < 1 || p > (int) addrs.size() - 2) {
+            throw std::invalid_argument("only stops between the depots can be removed");
+        }
+    }
+    if (gone.empty()) return;
+
+    erase_addresses(gone);
+    // the insertion tree may hold removed stops; have it rebuilt
+    tree_coords.clear();
+    pending_coords.clear();
+    // the stop that followed the k-th removed one is now at gone[k] - k
+    int last_gap = -1;
+    for (int k = 0; k < (int) gone.size(); k++) {
+        int gap = gone[k] - k;
+        if (gap != last_gap) {
+            repair_around(gap, man_norm);
+            last_gap = gap;
+        }
+    }
+}
+
+/**
+ * Returns the indices of the (up to) INSERT_NEIGHBORS stops nearest
+ * to addr, nearest first. Stops are found in a k-d tree plus a short
+ * list of those added since it was built; the tree is rebuilt when
+ * that list outgrows twice the square root of its size, or when stops
+ * were added other than by insert_cheapest().
+ */
+vector<int> Route::insert_candidates(const Address &addr, bool man_norm) {
+    int tree_size = tree_coords.size();
+    int num_pending = pending_coords.size();
+    if (tree_size + num_pending != (int) addrs.size() || num_pending * num_pending > 4 * tree_size) {
+        tree_coords = coords;
+        pending_coords.clear();
+        insert_tree = KdTree(tree_coords);
+    }
+
+    // candidates are kept by coordinates until the nearest are known
+    vector<std::pair<double, std::pair<double, double> > > near;
+    auto consider = [&](double x, double y) {
+        Address other(x, y, 0);
+        double len = man_norm ? addr.manhattan_dist(other) : addr.euclidean_dist(other);
+        near.push_back(std::make_pair(len, std::make_pair(x, y)));
+    };
+    for (int t : insert_tree.k_nearest(addr.get_x(), addr.get_y(), INSERT_NEIGHBORS, man_norm)) {
+        consider(tree_coords.x_at(t), tree_coords.y_at(t));
+    }
+    for (int t = 0; t < pending_coords.size(); t++) {
+        consider(pending_coords.x_at(t), pending_coords.y_at(t));
+    }
+
+    int keep = std::min((int) near.size(), INSERT_NEIGHBORS);
+    std::partial_sort(near.begin(), near.begin() + keep, near.end());
+    vector<int> result;
+    for (int k = 0; k < keep; k++) {
+        result.push_back(index_of(Address(near[k].second.first, near[k].second.second, 0)));
+    }
+    return result;
+}
+
+/**
+ * Reorders the stops within INSERT_REPAIR_RADIUS of position pos with
+ * 2-opt, keeping the stops just outside that window, and the depots,
+ * in place.
+ */
+void Route::repair_around(int pos, bool man_norm) {
+    int lo = std::max(1, pos - INSERT_REPAIR_RADIUS);
+    int hi = std::min((int) addrs.size() - 2, pos + INSERT_REPAIR_RADIUS);
+    if (hi - lo < 1) return;
+
+    CoordStore window;
+    window.reserve(hi - lo + 3);
+    for (int p = lo - 1; p <= hi + 1; p++) {
+        window.push_back(coords.x_at(p), coords.y_at(p));
+    }
+    vector<int> tour(window.size());
+    for (int i = 0; i < (int) tour.size(); i++) {
+        tour[i] = i;
+    }
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(window, ManhattanMetric(), DIST_DENSE);
+        opt2_improve(dists, tour, true, OPT2_FIRST);
+    } else {
+        BasicDistanceProvider<EuclideanMetric> dists(window, EuclideanMetric(), DIST_DENSE);
+        opt2_improve(dists, tour, true, OPT2_FIRST);
+    }
+
+    vector<int> order;
+    for (int k = 1; k < (int) tour.size() - 1; k++) {
+        order.push_back(tour[k] - 1);
+    }
+    reorder_addresses(lo, order);
+}
+
+/**
+ * Returns a new route of the addresses at the indices in tour, in that
+ * order. tour must begin and end with the depots, which become the new
+ * route's depots; the stops between them are gathered with one bulk
+ * insert. Routes with fewer than two addresses are copied as they are.
+ */
+Route Route::permuted(const vector<int> &tour) const {
+    if (tour.size() < 2) {
+        Route ret = *this;
+        return ret;
+    }
+    vector<Address> middle;
+    middle.reserve(tour.size() - 2);
+    for (int p = 1; p < (int) tour.size() - 1; p++) {
+        middle.push_back(addrs[tour[p]]);
+    }
+    Route path(addrs[tour.front()], addrs[tour.back()]);
+    path.set_precision(coords.get_precision(), coords.get_unit());
+    path.insert_addresses(1, middle);
+    return path;
+}
+
+/**
+ * Follows the specification of AddressList::set_precision().
+ */
+void Route::set_precision(CoordPrecision precision, double unit) {
+    AddressList::set_precision(precision, unit);
+    // the insertion tree holds coordinates as they were
+    tree_coords.clear();
+    pending_coords.clear();
+}
+
 /**
  * Returns the address in the route right before the end depot.
  * If there are less than 2 addresses, returns the final one.
@@ -398,45 +1025,39 @@ const Address &Route::get_final_nondepot() const {
  * norm otherwise. The route is returned as a new AddressList,
  * keeping the original constant.
  */
-Route Route::greedy_route(bool man_norm) const {
-    // same as AddressList version, but preserve position of final depot
-    // time complexity O(n^2)
-    Route path(addrs.front(), addrs.back());
-
-    vector<bool> includedAddrs(addrs.size());
-    includedAddrs[0] = true;
-    includedAddrs[addrs.size() - 1] = true;
-
-    int addrsRem = addrs.size() - 2;
-
-    while (addrsRem > 0) {
-        Address curr = path.get_final_nondepot();
-        // find index of nearest address
-        int nearestInd = -1;
-        int nearestDist = std::numeric_limits<int>::max();
-        
-        for (int i = 0; i < addrs.size(); i++) {
-            if (!includedAddrs[i]) {
-                int dist;
-                if (man_norm) {
-                    dist = curr.manhattan_dist(addrs.at(i));
-                } else {
-                    dist = curr.euclidean_dist(addrs.at(i));
-                }
-                if (dist < nearestDist) {
-                    nearestDist = dist;
-                    nearestInd = i;
-                }
-            }
-        }
-
-        // add it to the path
-        path.add_address(addrs.at(nearestInd));
-        includedAddrs[nearestInd] = true;
-        addrsRem--;
+Route Route::greedy_route(bool man_norm, SolveStats *stats) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return greedy_route(dists, stats);
     }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return greedy_route(dists, stats);
+}
 
-    return path;
+/**
+ * Follows the specification of AddressList::hilbert_route(), with the
+ * change that the depots maintain position, and the curve is run in
+ * the direction that joins it to both depots more cheaply.
+ */
+Route Route::hilbert_route(bool man_norm) const {
+    return permuted(hilbert_path(coords, true, man_norm));
+}
+
+/**
+ * Follows the specification of AddressList::hilbert_reorder(), with
+ * the change that the depots maintain position.
+ */
+void Route::hilbert_reorder(bool man_norm) {
+    reorder_addresses(0, hilbert_path(coords, true, man_norm));
+}
+
+/**
+ * Follows the specification of AddressList::greedy_edge_route(), with
+ * the change that the depots maintain position: each takes only one
+ * edge, and they end up at the two ends of the route.
+ */
+Route Route::greedy_edge_route(bool man_norm) const {
+    return permuted(greedy_edge_path(coords, true, man_norm));
 }
 
 /**
@@ -455,62 +1076,136 @@ Route Route::greedy_route(bool man_norm) const {
  * norm if man_norm is true, or the Euclidean norm otherwise.
  */
 Route Route::opt2_rearrange(bool man_norm) const {
-    if (addrs.size() <= 3) {
-        Route ret = *this;
-        return ret;
+    return opt2_rearrange(man_norm, OPT2_FIRST);
+}
+
+/**
+ * Follows the specification of AddressList::opt2_rearrange() with
+ * a strategy, with the change that the depots maintain position.
+ */
+Route Route::opt2_rearrange(bool man_norm, Opt2Strategy strategy, double *final_len,
+                           SolveStats *stats, const SolveBudget *budget, bool *converged) const {
+    PhaseTimer setup(stats, PHASE_SETUP);
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        setup.stop();
+        STATS_ADD(stats, dist_evals, dists.evaluations());
+        return opt2_rearrange(dists, strategy, final_len, stats, budget, converged);
     }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    setup.stop();
+    STATS_ADD(stats, dist_evals, dists.evaluations());
+    return opt2_rearrange(dists, strategy, final_len, stats, budget, converged);
+}
 
-    vector<Address> newAddrs = addrs;
-
-    bool changed;
-
-    do {
-        changed = false;
-        for (int i = 1; i < addrs.size() - 2; i++) {
-            for (int j = i + 1; j < addrs.size() - 1; j++) {
-                double old_len, new_len;
-                if ((i != 0) && (j != addrs.size() - 1)) {
-                    if (man_norm) {
-                        old_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(i)) + newAddrs.at(j).manhattan_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(j)) + newAddrs.at(i).manhattan_dist(newAddrs.at(j+1));
-                    } else {
-                        old_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(i)) + newAddrs.at(j).euclidean_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(j)) + newAddrs.at(i).euclidean_dist(newAddrs.at(j+1));
-                    }
-                } else if ((i == 0) && (j == addrs.size() - 1)) {
-                    old_len = 0.0;
-                    new_len = 1.0;
-                } else if (i == 0) {
-                    if (man_norm) {
-                        old_len = newAddrs.at(j).manhattan_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i).manhattan_dist(newAddrs.at(j+1));
-                    } else {
-                        old_len = newAddrs.at(j).euclidean_dist(newAddrs.at(j+1));
-                        new_len = newAddrs.at(i).euclidean_dist(newAddrs.at(j+1));
-                    }
-                } else {
-                    if (man_norm) {
-                        old_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(i));
-                        new_len = newAddrs.at(i-1).manhattan_dist(newAddrs.at(j));
-                    } else {
-                        old_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(i));
-                        new_len = newAddrs.at(i-1).euclidean_dist(newAddrs.at(j));
-                    }
-                }
-                if (old_len - new_len > 0) {
-                    std::reverse(newAddrs.begin()+i, newAddrs.begin()+j+1);
-                    changed = true;
-                    goto quadbreak;
-                }
-            }
-        }
-        quadbreak:
-        ;
-    } while (changed);
+/**
+ * Follows the specification of AddressList::opt2_rearrange_parallel(),
+ * with the change that the depots maintain position.
+ */
+Route Route::opt2_rearrange_parallel(bool man_norm, int num_threads, double *final_len,
+                                     const SolveBudget *budget, bool *converged) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return opt2_rearrange_parallel(dists, num_threads, final_len, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return opt2_rearrange_parallel(dists, num_threads, final_len, budget, converged);
+}
 
-    Route path(newAddrs.front(), newAddrs.back());
-    for (Address ad : newAddrs) {
-        path.add_address(ad);
+/**
+ * Follows the specification of AddressList::opt2_rearrange() with
+ * neighbor lists, with the change that the final and initial depots
+ * maintain position.
+ */
+Route Route::opt2_rearrange(bool man_norm, const NeighborLists &nbrs,
+                           const SolveBudget *budget, bool *converged) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return opt2_rearrange(dists, nbrs, budget, converged);
     }
-    return path;
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return opt2_rearrange(dists, nbrs, budget, converged);
+}
+
+/**
+ * Follows the specification of AddressList::oropt_rearrange(),
+ * with the change that the final and initial depots maintain position.
+ */
+Route Route::oropt_rearrange(bool man_norm, const NeighborLists &nbrs,
+                             const SolveBudget *budget, bool *converged) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return oropt_rearrange(dists, nbrs, budget, converged);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return oropt_rearrange(dists, nbrs, budget, converged);
+}
+
+/**
+ * Follows the specification of AddressList::multistart_route(), with
+ * the change that the depots maintain position. Random starting points
+ * are taken among the addresses between them, and each start's route
+ * is joined to the depots where that is cheapest.
+ */
+Route Route::multistart_route(bool man_norm, int starts, int num_threads, unsigned seed) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return multistart_route(dists, starts, num_threads, seed);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return multistart_route(dists, starts, num_threads, seed);
+}
+
+/**
+ * Follows the specification of AddressList::anneal_route(), with the
+ * change that the depots maintain position.
+ */
+Route Route::anneal_route(bool man_norm, int replicas, int sweeps, unsigned seed,
+                          int num_threads, const SolveBudget *budget) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return anneal_route(dists, replicas, sweeps, seed, num_threads, budget);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return anneal_route(dists, replicas, sweeps, seed, num_threads, budget);
+}
+
+/**
+ * Follows the specification of AddressList::deadline_route(), with the
+ * change that the depots maintain position and have no deadline.
+ */
+Route Route::deadline_route(bool man_norm) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return deadline_route(dists);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return deadline_route(dists);
+}
+
+/**
+ * Follows the specification of AddressList::deadline_rearrange(), with
+ * the change that the depots maintain position and have no deadline.
+ */
+Route Route::deadline_rearrange(bool man_norm) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric());
+        return deadline_rearrange(dists);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric());
+    return deadline_rearrange(dists);
+}
+
+/**
+ * Follows the specification of AddressList::lower_bound(), with the
+ * change that routes must start at the first depot and end at the last.
+ */
+LowerBound Route::lower_bound(bool man_norm, double target_gap, int max_iters,
+                              const SolveBudget *budget) const {
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        return lower_bound(dists, target_gap, max_iters, budget);
+    }
+    BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+    return lower_bound(dists, target_gap, max_iters, budget);
 }
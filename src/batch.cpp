@@ -0,0 +1,139 @@
+// batch.cpp
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../include/addresses.hpp"
+#include "../include/batch.hpp"
+#include "../include/budget.hpp"
+#include "../include/neighbors.hpp"
+#include "../include/pool.hpp"
+#include "../include/stats.hpp"
+
+using std::vector;
+
+/**
+ * Returns the first route for route under pipeline.
+ */
+static Route construct_route(const Route &route, const BatchPipeline &pipeline,
+                             SolveStats *stats) {
+    switch (pipeline.construct) {
+        case BATCH_GREEDY:
+            return route.greedy_route(pipeline.man_norm, stats);
+        case BATCH_GREEDY_EDGE:
+            return route.greedy_edge_route(pipeline.man_norm);
+        case BATCH_HILBERT:
+            return route.hilbert_route(pipeline.man_norm);
+        default:
+            return route;
+    }
+}
+
+/**
+ * Runs pipeline on route, replacing it with the result if that is
+ * shorter, and records what was done in out.
+ */
+static void solve_route(Route &route, const BatchPipeline &pipeline, BatchRouteStats &out) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool man_norm = pipeline.man_norm;
+    std::unique_ptr<SolveBudget> budget;
+    if (pipeline.route_seconds > 0.0) {
+        budget.reset(new SolveBudget(pipeline.route_seconds));
+    }
+
+    out.stops = route.size();
+    out.start_length = man_norm ? route.man_length() : route.euc_length();
+    Route built = construct_route(route, pipeline, &out.solver);
+    if (built.size() > 3) {
+        switch (pipeline.improve) {
+            case BATCH_OPT2:
+                built = built.opt2_rearrange(man_norm, OPT2_FIRST, nullptr, &out.solver,
+                                             budget.get(), &out.converged);
+                break;
+            case BATCH_NEIGHBOR_OPT2:
+                built = built.opt2_rearrange(
+                    man_norm, NeighborLists(built.get_coords(), BATCH_NEIGHBORS, man_norm),
+                    budget.get(), &out.converged);
+                break;
+            case BATCH_OROPT:
+                built = built.oropt_rearrange(
+                    man_norm, NeighborLists(built.get_coords(), BATCH_NEIGHBORS, man_norm),
+                    budget.get(), &out.converged);
+                break;
+            default:
+                break;
+        }
+    }
+
+    double built_len = man_norm ? built.man_length() : built.euc_length();
+    out.kept_input = !(built_len < out.start_length);
+    out.length = out.kept_input ? out.start_length : built_len;
+    if (!out.kept_input) {
+        route = built;
+    }
+    std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+    out.seconds = spent.count();
+}
+
+/**
+ * Solves many independent routes, as a daily plan of trucks needs,
+ * on a WorkPool of num_threads threads (0 for one per hardware thread).
+ * Each route is built and improved as pipeline says, and replaced in
+ * place by the result unless that is no shorter, so no route comes
+ * back longer than it went in. Depots keep their positions.
+ *
+ * Consecutive routes are grouped into tasks of about
+ * BATCH_CHUNK_STOPS stops, and a larger route is a task of its own.
+ * Tasks are queued lightest first: workers run their own newest task
+ * first, so each starts on its heaviest, and idle workers steal the
+ * light ones that are left. Every route is solved the same way however
+ * many threads there are, so the result does not depend on the thread
+ * count unless route_seconds cuts a search short.
+ *
+ * Returns what was done with each route, in the order of routes.
+ */
+vector<BatchRouteStats> solve_batch(vector<Route> &routes, const BatchPipeline &pipeline,
+                                    int num_threads) {
+    int n = routes.size();
+    vector<BatchRouteStats> results(n);
+
+    // [first, last) ranges of routes, with their total stops
+    vector<std::pair<int, int> > chunks;
+    vector<long> chunk_stops;
+    long stops = 0;
+    int first = 0;
+    for (int i = 0; i < n; i++) {
+        if (routes[i].size() >= BATCH_CHUNK_STOPS && i > first) {
+            chunks.push_back(std::make_pair(first, i));
+            chunk_stops.push_back(stops);
+            first = i;
+            stops = 0;
+        }
+        stops += routes[i].size();
+        if (stops >= BATCH_CHUNK_STOPS || i == n - 1) {
+            chunks.push_back(std::make_pair(first, i + 1));
+            chunk_stops.push_back(stops);
+            first = i + 1;
+            stops = 0;
+        }
+    }
+    vector<int> by_size(chunks.size());
+    for (int c = 0; c < (int) chunks.size(); c++) {
+        by_size[c] = c;
+    }
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [&chunk_stops](int a, int b) { return chunk_stops[a] < chunk_stops[b]; });
+
+    WorkPool pool(num_threads);
+    for (int c : by_size) {
+        int lo = chunks[c].first, hi = chunks[c].second;
+        pool.submit([&routes, &results, &pipeline, lo, hi]() {
+            for (int i = lo; i < hi; i++) {
+                solve_route(routes[i], pipeline, results[i]);
+            }
+        });
+    }
+    pool.wait();
+    return results;
+}
@@ -0,0 +1,615 @@
+// coords.cpp
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "../include/coords.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using std::abs;
+using std::vector;
+
+// CoordStore class
+
+/**
+ * Returns a coordinate already rounded to a grid of the given unit in
+ * grid units, or GRID_NONE if it is not finite.
+ */
+static int32_t grid_coord(double value, double unit) {
+    return std::isfinite(value) ? (int32_t) std::nearbyint(value / unit) : GRID_NONE;
+}
+
+CoordStore::CoordStore()
+    : view_xs(nullptr), view_ys(nullptr), view_size(0), precision(COORD_DOUBLE), unit(1.0) { };
+
+/**
+ * Makes a view of n coordinates at xs_in and ys_in, which must stay
+ * valid for as long as owner_in (or a copy of it) is alive.
+ */
+CoordStore::CoordStore(std::shared_ptr<const void> owner_in, const double *xs_in,
+                       const double *ys_in, int n)
+    : owner(owner_in), view_xs(xs_in), view_ys(ys_in), view_size(n),
+      precision(COORD_DOUBLE), unit(1.0) { };
+
+bool CoordStore::is_view() const {
+    return owner != nullptr;
+}
+
+/**
+ * Copies a view into the store's own arrays, so it can be changed.
+ */
+void CoordStore::detach() {
+    if (owner) {
+        xs.assign(view_xs, view_xs + view_size);
+        ys.assign(view_ys, view_ys + view_size);
+        owner.reset();
+        view_xs = view_ys = nullptr;
+        view_size = 0;
+    }
+}
+
+void CoordStore::reserve(int n) {
+    detach();
+    xs.reserve(n);
+    ys.reserve(n);
+}
+
+/**
+ * Inserts the 32-bit copies of the count coordinates just inserted at
+ * index, which are already rounded to the store's precision.
+ */
+void CoordStore::narrow(int index, int count) {
+    if (precision == COORD_DOUBLE) return;
+    if (precision == COORD_FLOAT32) {
+        narrow_xs.insert(narrow_xs.begin() + index, xs.begin() + index,
+                         xs.begin() + index + count);
+        narrow_ys.insert(narrow_ys.begin() + index, ys.begin() + index,
+                         ys.begin() + index + count);
+        return;
+    }
+    grid_xs.insert(grid_xs.begin() + index, count, 0);
+    grid_ys.insert(grid_ys.begin() + index, count, 0);
+    for (int i = index; i < index + count; i++) {
+        grid_xs[i] = grid_coord(xs[i], unit);
+        grid_ys[i] = grid_coord(ys[i], unit);
+    }
+}
+
+void CoordStore::clear() {
+    owner.reset();
+    view_xs = view_ys = nullptr;
+    view_size = 0;
+    xs.clear();
+    ys.clear();
+    narrow_xs.clear();
+    narrow_ys.clear();
+    grid_xs.clear();
+    grid_ys.clear();
+}
+
+void CoordStore::push_back(double x, double y) {
+    detach();
+    xs.push_back(round(x));
+    ys.push_back(round(y));
+    narrow(xs.size() - 1, 1);
+}
+
+/**
+ * Inserts a coordinate pair before the given index,
+ * mirroring vector::insert.
+ */
+void CoordStore::insert(int index, double x, double y) {
+    detach();
+    xs.insert(xs.begin() + index, round(x));
+    ys.insert(ys.begin() + index, round(y));
+    narrow(index, 1);
+}
+
+/**
+ * Inserts a run of coordinate pairs before the given index.
+ * more_xs and more_ys must have the same length.
+ */
+void CoordStore::insert(int index, const vector<double> &more_xs,
+                        const vector<double> &more_ys) {
+    detach();
+    if (precision != COORD_DOUBLE) {
+        vector<double> rounded_xs(more_xs.size()), rounded_ys(more_ys.size());
+        for (int k = 0; k < (int) more_xs.size(); k++) {
+            rounded_xs[k] = round(more_xs[k]);
+            rounded_ys[k] = round(more_ys[k]);
+        }
+        xs.insert(xs.begin() + index, rounded_xs.begin(), rounded_xs.end());
+        ys.insert(ys.begin() + index, rounded_ys.begin(), rounded_ys.end());
+        narrow(index, more_xs.size());
+        return;
+    }
+    xs.insert(xs.begin() + index, more_xs.begin(), more_xs.end());
+    ys.insert(ys.begin() + index, more_ys.begin(), more_ys.end());
+}
+
+void CoordStore::set(int index, double x, double y) {
+    x = round(x);
+    y = round(y);
+    detach();
+    xs[index] = x;
+    ys[index] = y;
+    if (precision == COORD_FLOAT32) {
+        narrow_xs[index] = xs[index];
+        narrow_ys[index] = ys[index];
+    } else if (precision == COORD_FIXED) {
+        grid_xs[index] = grid_coord(xs[index], unit);
+        grid_ys[index] = grid_coord(ys[index], unit);
+    }
+}
+
+int CoordStore::size() const {
+    return owner ? view_size : xs.size();
+}
+
+double CoordStore::x_at(int index) const {
+    return owner ? view_xs[index] : xs[index];
+}
+
+double CoordStore::y_at(int index) const {
+    return owner ? view_ys[index] : ys[index];
+}
+
+const double *CoordStore::x_data() const {
+    return owner ? view_xs : xs.data();
+}
+
+const double *CoordStore::y_data() const {
+    return owner ? view_ys : ys.data();
+}
+
+/**
+ * Sets the precision of the store (see CoordPrecision), rounding the
+ * coordinates already in it and every one stored later. unit is the
+ * grid spacing for COORD_FIXED, and is otherwise ignored.
+ * Throws std::invalid_argument if unit is not positive, or if a
+ * coordinate falls more than FIXED_COORD_LIMIT units from 0; the store
+ * is then left unchanged.
+ */
+void CoordStore::set_precision(CoordPrecision precision_in, double unit_in) {
+    if (precision_in == COORD_FIXED && !(unit_in > 0.0 && std::isfinite(unit_in))) {
+        throw std::invalid_argument("the fixed-point unit must be positive");
+    }
+    if (precision_in == COORD_DOUBLE && precision == COORD_DOUBLE) return;
+
+    CoordStore rounded;
+    rounded.precision = precision_in;
+    rounded.unit = (precision_in == COORD_FIXED) ? unit_in : 1.0;
+    rounded.reserve(size());
+    for (int i = 0; i < size(); i++) {
+        rounded.push_back(x_at(i), y_at(i));
+    }
+    *this = rounded;
+}
+
+CoordPrecision CoordStore::get_precision() const {
+    return precision;
+}
+
+double CoordStore::get_unit() const {
+    return unit;
+}
+
+/**
+ * Returns value rounded as the store rounds coordinates.
+ * Throws std::invalid_argument if it is off the fixed-point grid.
+ */
+double CoordStore::round(double value) const {
+    if (precision == COORD_FLOAT32) {
+        return (float) value;
+    } else if (precision == COORD_FIXED && std::isfinite(value)) {
+        double units = std::nearbyint(value / unit);
+        if (std::abs(units) > FIXED_COORD_LIMIT) {
+            throw std::invalid_argument("coordinate outside the fixed-point grid");
+        }
+        return units * unit;
+    }
+    return value;
+}
+
+/**
+ * Returns the index of the point closest to (qx, qy) under the
+ * Manhattan norm if man_norm is true, or the Euclidean norm otherwise,
+ * as the nearest-point kernels do. In single precision the query is
+ * rounded to floats and the float copy is scanned. In fixed point the
+ * grid copy is scanned only for queries on the grid, where its
+ * distances are exact; rounding others to the grid could pick a point
+ * that is not the nearest, so they are scanned over the doubles.
+ */
+int CoordStore::nearest(double qx, double qy, bool man_norm) const {
+    int n = size();
+    if (precision == COORD_FLOAT32 && std::isfinite(qx) && std::isfinite(qy)) {
+        float fx = qx, fy = qy;
+        return man_norm ? argmin_manhattan(narrow_xs.data(), narrow_ys.data(), n, fx, fy)
+                        : argmin_sq_euclidean(narrow_xs.data(), narrow_ys.data(), n, fx, fy);
+    }
+    double gx = std::nearbyint(qx / unit), gy = std::nearbyint(qy / unit);
+    if (precision == COORD_FIXED && std::abs(gx) <= FIXED_COORD_LIMIT &&
+        std::abs(gy) <= FIXED_COORD_LIMIT && gx * unit == qx && gy * unit == qy) {
+        return man_norm ? argmin_manhattan(grid_xs.data(), grid_ys.data(), n,
+                                           (int32_t) gx, (int32_t) gy)
+                        : argmin_sq_euclidean(grid_xs.data(), grid_ys.data(), n,
+                                              (int32_t) gx, (int32_t) gy);
+    }
+    return man_norm ? argmin_manhattan(x_data(), y_data(), n, qx, qy)
+                    : argmin_sq_euclidean(x_data(), y_data(), n, qx, qy);
+}
+
+// Nearest-point kernels
+
+namespace {
+
+// Per-metric lane arithmetic. Each metric supplies the scalar
+// formula plus the same formula over a full vector register.
+
+struct SqEuclideanLanes {
+    static double scalar(double dx, double dy) {
+        return dx * dx + dy * dy;
+    }
+#if defined(__AVX__)
+    static __m256d lanes(__m256d dx, __m256d dy) {
+        return _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    }
+#elif defined(__SSE2__)
+    static __m128d lanes(__m128d dx, __m128d dy) {
+        return _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+    }
+#endif
+};
+
+struct ManhattanLanes {
+    static double scalar(double dx, double dy) {
+        return abs(dx) + abs(dy);
+    }
+#if defined(__AVX__)
+    static __m256d lanes(__m256d dx, __m256d dy) {
+        // clearing the sign bit is abs() for IEEE doubles
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        return _mm256_add_pd(_mm256_andnot_pd(sign, dx), _mm256_andnot_pd(sign, dy));
+    }
+#elif defined(__SSE2__)
+    static __m128d lanes(__m128d dx, __m128d dy) {
+        const __m128d sign = _mm_set1_pd(-0.0);
+        return _mm_add_pd(_mm_andnot_pd(sign, dx), _mm_andnot_pd(sign, dy));
+    }
+#endif
+};
+
+/**
+ * Folds the per-lane winners of a vector scan into the running
+ * best, breaking ties towards the lower index so the result
+ * matches a plain left-to-right scan.
+ */
+template <class T>
+void reduce_lanes(const T *lane_len, const T *lane_ind, int lanes, T &best_len, int &best_ind) {
+    for (int k = 0; k < lanes; k++) {
+        if (lane_ind[k] < 0) continue;
+        int ind = (int) lane_ind[k];
+        if (lane_len[k] < best_len ||
+            (lane_len[k] == best_len && ind < best_ind)) {
+            best_len = lane_len[k];
+            best_ind = ind;
+        }
+    }
+}
+
+template <class Lanes>
+int argmin_scan(const double *xs, const double *ys, int n, double qx, double qy) {
+    int best_ind = -1;
+    double best_len = std::numeric_limits<double>::infinity();
+    int i = 0;
+
+#if defined(__AVX__)
+    if (n >= 4) {
+        const __m256d vqx = _mm256_set1_pd(qx);
+        const __m256d vqy = _mm256_set1_pd(qy);
+        const __m256d step = _mm256_set1_pd(4.0);
+        __m256d vbest = _mm256_set1_pd(best_len);
+        __m256d vbest_ind = _mm256_set1_pd(-1.0);
+        __m256d vind = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+        for (; i + 4 <= n; i += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vqx);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vqy);
+            __m256d len = Lanes::lanes(dx, dy);
+            __m256d lt = _mm256_cmp_pd(len, vbest, _CMP_LT_OQ);
+            vbest = _mm256_blendv_pd(vbest, len, lt);
+            vbest_ind = _mm256_blendv_pd(vbest_ind, vind, lt);
+            vind = _mm256_add_pd(vind, step);
+        }
+
+        double lane_len[4], lane_ind[4];
+        _mm256_storeu_pd(lane_len, vbest);
+        _mm256_storeu_pd(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 4, best_len, best_ind);
+    }
+#elif defined(__SSE2__)
+    if (n >= 2) {
+        const __m128d vqx = _mm_set1_pd(qx);
+        const __m128d vqy = _mm_set1_pd(qy);
+        const __m128d step = _mm_set1_pd(2.0);
+        __m128d vbest = _mm_set1_pd(best_len);
+        __m128d vbest_ind = _mm_set1_pd(-1.0);
+        __m128d vind = _mm_set_pd(1.0, 0.0);
+
+        for (; i + 2 <= n; i += 2) {
+            __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), vqx);
+            __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), vqy);
+            __m128d len = Lanes::lanes(dx, dy);
+            __m128d lt = _mm_cmplt_pd(len, vbest);
+            // SSE2 has no blend, so select with and/andnot/or
+            vbest = _mm_or_pd(_mm_and_pd(lt, len), _mm_andnot_pd(lt, vbest));
+            vbest_ind = _mm_or_pd(_mm_and_pd(lt, vind), _mm_andnot_pd(lt, vbest_ind));
+            vind = _mm_add_pd(vind, step);
+        }
+
+        double lane_len[2], lane_ind[2];
+        _mm_storeu_pd(lane_len, vbest);
+        _mm_storeu_pd(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 2, best_len, best_ind);
+    }
+#endif
+
+    // scalar fallback, and the tail left over by the vector loop
+    for (; i < n; i++) {
+        double len = Lanes::scalar(xs[i] - qx, ys[i] - qy);
+        if (len < best_len) {
+            best_len = len;
+            best_ind = i;
+        }
+    }
+
+    return best_ind;
+}
+
+// Single-precision lanes, as above with twice as many per vector.
+
+struct SqEuclideanLanesF {
+    static float scalar(float dx, float dy) {
+        return dx * dx + dy * dy;
+    }
+#if defined(__AVX__)
+    static __m256 lanes(__m256 dx, __m256 dy) {
+        return _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    }
+#elif defined(__SSE2__)
+    static __m128 lanes(__m128 dx, __m128 dy) {
+        return _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    }
+#endif
+};
+
+struct ManhattanLanesF {
+    static float scalar(float dx, float dy) {
+        return abs(dx) + abs(dy);
+    }
+#if defined(__AVX__)
+    static __m256 lanes(__m256 dx, __m256 dy) {
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        return _mm256_add_ps(_mm256_andnot_ps(sign, dx), _mm256_andnot_ps(sign, dy));
+    }
+#elif defined(__SSE2__)
+    static __m128 lanes(__m128 dx, __m128 dy) {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        return _mm_add_ps(_mm_andnot_ps(sign, dx), _mm_andnot_ps(sign, dy));
+    }
+#endif
+};
+
+// floats count indices exactly only up to 2^24, so longer scans are
+// taken in blocks of this many points
+const int FLOAT_SCAN_BLOCK = 1 << 24;
+
+/**
+ * argmin_scan() over floats, for up to FLOAT_SCAN_BLOCK points. Leaves
+ * the distance of the point found in best_len.
+ */
+template <class Lanes>
+int argmin_scan_block(const float *xs, const float *ys, int n, float qx, float qy,
+                      float &best_len) {
+    int best_ind = -1;
+    best_len = std::numeric_limits<float>::infinity();
+    int i = 0;
+
+#if defined(__AVX__)
+    if (n >= 8) {
+        const __m256 vqx = _mm256_set1_ps(qx);
+        const __m256 vqy = _mm256_set1_ps(qy);
+        const __m256 step = _mm256_set1_ps(8.0f);
+        __m256 vbest = _mm256_set1_ps(best_len);
+        __m256 vbest_ind = _mm256_set1_ps(-1.0f);
+        __m256 vind = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+        for (; i + 8 <= n; i += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+            __m256 len = Lanes::lanes(dx, dy);
+            __m256 lt = _mm256_cmp_ps(len, vbest, _CMP_LT_OQ);
+            vbest = _mm256_blendv_ps(vbest, len, lt);
+            vbest_ind = _mm256_blendv_ps(vbest_ind, vind, lt);
+            vind = _mm256_add_ps(vind, step);
+        }
+
+        float lane_len[8], lane_ind[8];
+        _mm256_storeu_ps(lane_len, vbest);
+        _mm256_storeu_ps(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 8, best_len, best_ind);
+    }
+#elif defined(__SSE2__)
+    if (n >= 4) {
+        const __m128 vqx = _mm_set1_ps(qx);
+        const __m128 vqy = _mm_set1_ps(qy);
+        const __m128 step = _mm_set1_ps(4.0f);
+        __m128 vbest = _mm_set1_ps(best_len);
+        __m128 vbest_ind = _mm_set1_ps(-1.0f);
+        __m128 vind = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+            __m128 len = Lanes::lanes(dx, dy);
+            __m128 lt = _mm_cmplt_ps(len, vbest);
+            vbest = _mm_or_ps(_mm_and_ps(lt, len), _mm_andnot_ps(lt, vbest));
+            vbest_ind = _mm_or_ps(_mm_and_ps(lt, vind), _mm_andnot_ps(lt, vbest_ind));
+            vind = _mm_add_ps(vind, step);
+        }
+
+        float lane_len[4], lane_ind[4];
+        _mm_storeu_ps(lane_len, vbest);
+        _mm_storeu_ps(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 4, best_len, best_ind);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float len = Lanes::scalar(xs[i] - qx, ys[i] - qy);
+        if (len < best_len) {
+            best_len = len;
+            best_ind = i;
+        }
+    }
+
+    return best_ind;
+}
+
+template <class Lanes>
+int argmin_scan(const float *xs, const float *ys, int n, float qx, float qy) {
+    int best_ind = -1;
+    float best_len = std::numeric_limits<float>::infinity();
+    for (int first = 0; first < n; first += FLOAT_SCAN_BLOCK) {
+        float len;
+        int count = std::min(FLOAT_SCAN_BLOCK, n - first);
+        int ind = argmin_scan_block<Lanes>(xs + first, ys + first, count, qx, qy, len);
+        if (ind >= 0 && len < best_len) {
+            best_len = len;
+            best_ind = first + ind;
+        }
+    }
+    return best_ind;
+}
+
+/**
+ * argmin_scan() over grid coordinates. Each is widened to a double, in
+ * which, being at most FIXED_COORD_LIMIT in size, its differences and
+ * their squares and sums are exact, so the double lanes compare grid
+ * distances exactly. Points at GRID_NONE are skipped.
+ */
+template <class Lanes>
+int argmin_scan(const int32_t *xs, const int32_t *ys, int n, int32_t qx, int32_t qy) {
+    int best_ind = -1;
+    double best_len = std::numeric_limits<double>::infinity();
+    int i = 0;
+
+#if defined(__AVX__)
+    if (n >= 4) {
+        const __m256d vqx = _mm256_set1_pd(qx);
+        const __m256d vqy = _mm256_set1_pd(qy);
+        const __m256d none = _mm256_set1_pd(GRID_NONE);
+        const __m256d inf = _mm256_set1_pd(best_len);
+        const __m256d step = _mm256_set1_pd(4.0);
+        __m256d vbest = inf;
+        __m256d vbest_ind = _mm256_set1_pd(-1.0);
+        __m256d vind = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+        for (; i + 4 <= n; i += 4) {
+            __m256d px = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (xs + i)));
+            __m256d py = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (ys + i)));
+            __m256d len = Lanes::lanes(_mm256_sub_pd(px, vqx), _mm256_sub_pd(py, vqy));
+            __m256d skip = _mm256_or_pd(_mm256_cmp_pd(px, none, _CMP_EQ_OQ),
+                                        _mm256_cmp_pd(py, none, _CMP_EQ_OQ));
+            len = _mm256_blendv_pd(len, inf, skip);
+            __m256d lt = _mm256_cmp_pd(len, vbest, _CMP_LT_OQ);
+            vbest = _mm256_blendv_pd(vbest, len, lt);
+            vbest_ind = _mm256_blendv_pd(vbest_ind, vind, lt);
+            vind = _mm256_add_pd(vind, step);
+        }
+
+        double lane_len[4], lane_ind[4];
+        _mm256_storeu_pd(lane_len, vbest);
+        _mm256_storeu_pd(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 4, best_len, best_ind);
+    }
+#elif defined(__SSE2__)
+    if (n >= 2) {
+        const __m128d vqx = _mm_set1_pd(qx);
+        const __m128d vqy = _mm_set1_pd(qy);
+        const __m128d none = _mm_set1_pd(GRID_NONE);
+        const __m128d inf = _mm_set1_pd(best_len);
+        const __m128d step = _mm_set1_pd(2.0);
+        __m128d vbest = inf;
+        __m128d vbest_ind = _mm_set1_pd(-1.0);
+        __m128d vind = _mm_set_pd(1.0, 0.0);
+
+        for (; i + 2 <= n; i += 2) {
+            __m128d px = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (xs + i)));
+            __m128d py = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (ys + i)));
+            __m128d len = Lanes::lanes(_mm_sub_pd(px, vqx), _mm_sub_pd(py, vqy));
+            __m128d skip = _mm_or_pd(_mm_cmpeq_pd(px, none), _mm_cmpeq_pd(py, none));
+            len = _mm_or_pd(_mm_and_pd(skip, inf), _mm_andnot_pd(skip, len));
+            __m128d lt = _mm_cmplt_pd(len, vbest);
+            vbest = _mm_or_pd(_mm_and_pd(lt, len), _mm_andnot_pd(lt, vbest));
+            vbest_ind = _mm_or_pd(_mm_and_pd(lt, vind), _mm_andnot_pd(lt, vbest_ind));
+            vind = _mm_add_pd(vind, step);
+        }
+
+        double lane_len[2], lane_ind[2];
+        _mm_storeu_pd(lane_len, vbest);
+        _mm_storeu_pd(lane_ind, vbest_ind);
+        reduce_lanes(lane_len, lane_ind, 2, best_len, best_ind);
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (xs[i] == GRID_NONE || ys[i] == GRID_NONE) continue;
+        double len = Lanes::scalar((double) xs[i] - qx, (double) ys[i] - qy);
+        if (len < best_len) {
+            best_len = len;
+            best_ind = i;
+        }
+    }
+
+    return best_ind;
+}
+
+} // namespace
+
+int argmin_sq_euclidean(const double *xs, const double *ys, int n,
+                        double qx, double qy) {
+    return argmin_scan<SqEuclideanLanes>(xs, ys, n, qx, qy);
+}
+
+int argmin_manhattan(const double *xs, const double *ys, int n,
+                     double qx, double qy) {
+    return argmin_scan<ManhattanLanes>(xs, ys, n, qx, qy);
+}
+
+int argmin_sq_euclidean(const float *xs, const float *ys, int n,
+                        float qx, float qy) {
+    return argmin_scan<SqEuclideanLanesF>(xs, ys, n, qx, qy);
+}
+
+int argmin_manhattan(const float *xs, const float *ys, int n,
+                     float qx, float qy) {
+    return argmin_scan<ManhattanLanesF>(xs, ys, n, qx, qy);
+}
+
+int argmin_sq_euclidean(const int32_t *xs, const int32_t *ys, int n,
+                        int32_t qx, int32_t qy) {
+    return argmin_scan<SqEuclideanLanes>(xs, ys, n, qx, qy);
+}
+
+int argmin_manhattan(const int32_t *xs, const int32_t *ys, int n,
+                     int32_t qx, int32_t qy) {
+    return argmin_scan<ManhattanLanes>(xs, ys, n, qx, qy);
+}
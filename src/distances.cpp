@@ -0,0 +1,45 @@
+// distances.cpp
+#include <cmath>
+#include <cstddef>
+#include "../include/distances.hpp"
+#include "../include/metrics.hpp"
+
+using std::abs;
+using std::sqrt;
+
+// a row cache holding fewer rows than this thrashes, so DIST_AUTO
+// prefers computing on the fly instead
+static const size_t MIN_CACHED_ROWS = 64;
+
+double euclidean_metric(double x1, double y1, double x2, double y2) {
+    double dx = x1 - x2;
+    double dy = y1 - y2;
+    return sqrt(dx * dx + dy * dy);
+}
+
+double manhattan_metric(double x1, double y1, double x2, double y2) {
+    return abs(x1 - x2) + abs(y1 - y2);
+}
+
+FunctionMetric::FunctionMetric(DistanceFn fn_in) : fn(fn_in), fn_kernel(KERNEL_CUSTOM) {
+    if (fn == euclidean_metric) {
+        fn_kernel = KERNEL_EUCLIDEAN;
+    } else if (fn == manhattan_metric) {
+        fn_kernel = KERNEL_MANHATTAN;
+    }
+}
+
+/**
+ * Picks the storage mode used by DIST_AUTO: a dense matrix if it fits
+ * in the budget, else a row cache if enough rows fit to be useful,
+ * else no storage at all.
+ */
+DistanceMode choose_distance_mode(int n, size_t budget_bytes) {
+    size_t row_bytes = (size_t) n * sizeof(double);
+    if (row_bytes * n <= budget_bytes) {
+        return DIST_DENSE;
+    } else if (row_bytes * MIN_CACHED_ROWS <= budget_bytes) {
+        return DIST_ROW_CACHE;
+    }
+    return DIST_ON_THE_FLY;
+}
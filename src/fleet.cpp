@@ -0,0 +1,488 @@
+// fleet.cpp
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/addresses.hpp"
+#include "../include/coords.hpp"
+#include "../include/distances.hpp"
+#include "../include/fleet.hpp"
+#include "../include/metrics.hpp"
+#include "../include/neighbors.hpp"
+#include "../include/pool.hpp"
+
+using std::vector;
+
+// candidate neighbors per stop, for routing and for moves between trucks
+static const int FLEET_NEIGHBORS = 10;
+
+namespace {
+
+/**
+ * Relocate and exchange moves between trucks. Stops of all trucks are
+ * numbered 0..num_stops-1 in one point set, followed by the start and
+ * end depots; tours[t] lists the stops of truck t in driving order.
+ * A relocate moves a stop next to one of its listed neighbors on
+ * another truck; an exchange swaps it with that neighbor. Both are
+ * evaluated in O(1), and stops whose neighborhood offers nothing are
+ * left alone until a move changes their edges (don't-look bits).
+ */
+template <class Provider>
+class StopExchange {
+    private:
+        Provider &dists;
+        const NeighborLists &nbrs;
+        vector<vector<int> > &tours;
+        int num_stops;
+        int max_stops;
+        vector<int> owner, pos;
+        std::deque<int> queue;
+        vector<char> queued;
+
+        int pred(int s) const {
+            return pos[s] == 0 ? num_stops : tours[owner[s]][pos[s] - 1];
+        }
+        int succ(int s) const {
+            const vector<int> &tour = tours[owner[s]];
+            return pos[s] + 1 == (int) tour.size() ? num_stops + 1 : tour[pos[s] + 1];
+        }
+        void renumber(int truck);
+        void wake(int s);
+        bool try_relocate(int s);
+        bool try_exchange(int s);
+    public:
+        StopExchange(Provider &dists_in, const NeighborLists &nbrs_in,
+                     vector<vector<int> > &tours_in, int num_stops_in, int max_stops_in);
+        int run();
+};
+
+template <class Provider>
+StopExchange<Provider>::StopExchange(Provider &dists_in, const NeighborLists &nbrs_in,
+                                     vector<vector<int> > &tours_in, int num_stops_in,
+                                     int max_stops_in)
+    : dists(dists_in), nbrs(nbrs_in), tours(tours_in), num_stops(num_stops_in),
+      max_stops(max_stops_in), owner(num_stops_in), pos(num_stops_in),
+      queued(num_stops_in, 0) {
+    for (int t = 0; t < (int) tours.size(); t++) {
+        renumber(t);
+        for (int s : tours[t]) {
+            owner[s] = t;
+            wake(s);
+        }
+    }
+}
+
+template <class Provider>
+void StopExchange<Provider>::renumber(int truck) {
+    for (int p = 0; p < (int) tours[truck].size(); p++) {
+        pos[tours[truck][p]] = p;
+    }
+}
+
+template <class Provider>
+void StopExchange<Provider>::wake(int s) {
+    if (s < num_stops && !queued[s]) {
+        queued[s] = 1;
+        queue.push_back(s);
+    }
+}
+
+template <class Provider>
+bool StopExchange<Provider>::try_relocate(int s) {
+    int from = owner[s];
+    int p = pred(s), nx = succ(s);
+    double removal = dists.dist(p, s) + dists.dist(s, nx) - dists.dist(p, nx);
+    const int *cand = nbrs.of(s);
+
+    for (int m = 0; m < nbrs.per_point(); m++) {
+        int c = cand[m];
+        if (c >= num_stops) continue;
+        // lists are sorted, so later candidates are unlikely to gain
+        if (removal - dists.dist(s, c) <= OPT2_MIN_GAIN) break;
+        int to = owner[c];
+        if (to == from || (max_stops > 0 && (int) tours[to].size() >= max_stops)) continue;
+
+        for (int side = 0; side < 2; side++) {
+            int u = (side == 0) ? pred(c) : c;
+            int v = (side == 0) ? c : succ(c);
+            double cost = dists.dist(u, s) + dists.dist(s, v) - dists.dist(u, v);
+            if (removal - cost <= OPT2_MIN_GAIN) continue;
+
+            int at = (side == 0) ? pos[c] : pos[c] + 1;
+            tours[from].erase(tours[from].begin() + pos[s]);
+            tours[to].insert(tours[to].begin() + at, s);
+            owner[s] = to;
+            renumber(from);
+            renumber(to);
+            int touched[5] = { s, p, nx, u, v };
+            for (int t = 0; t < 5; t++) {
+                wake(touched[t]);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class Provider>
+bool StopExchange<Provider>::try_exchange(int s) {
+    int ps = pred(s), ns = succ(s);
+    double s_edges = dists.dist(ps, s) + dists.dist(s, ns);
+    const int *cand = nbrs.of(s);
+
+    for (int m = 0; m < nbrs.per_point(); m++) {
+        int c = cand[m];
+        if (c >= num_stops || owner[c] == owner[s]) continue;
+
+        int pc = pred(c), nc = succ(c);
+        double gain = s_edges + dists.dist(pc, c) + dists.dist(c, nc)
+                    - dists.dist(ps, c) - dists.dist(c, ns)
+                    - dists.dist(pc, s) - dists.dist(s, nc);
+        if (gain <= OPT2_MIN_GAIN) continue;
+
+        tours[owner[s]][pos[s]] = c;
+        tours[owner[c]][pos[c]] = s;
+        std::swap(owner[s], owner[c]);
+        std::swap(pos[s], pos[c]);
+        int touched[6] = { s, c, ps, ns, pc, nc };
+        for (int t = 0; t < 6; t++) {
+            wake(touched[t]);
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Applies moves until no stop's neighborhood offers one.
+ * Returns the number of moves applied.
+ */
+template <class Provider>
+int StopExchange<Provider>::run() {
+    int moves = 0;
+    while (!queue.empty()) {
+        int s = queue.front();
+        queue.pop_front();
+        queued[s] = 0;
+        if (try_relocate(s) || try_exchange(s)) {
+            moves++;
+        }
+    }
+    return moves;
+}
+
+}
+
+Fleet::Fleet(Address start_depot_in, Address end_depot_in, int num_trucks, int max_stops_in)
+    : start_depot(start_depot_in), end_depot(end_depot_in), max_stops(max_stops_in) {
+    if (num_trucks < 1) {
+        throw std::invalid_argument("fleet needs at least one truck");
+    }
+    routes.assign(num_trucks, Route(start_depot, end_depot));
+}
+
+/**
+ * Number of trucks.
+ */
+int Fleet::size() const {
+    return routes.size();
+}
+
+/**
+ * Number of addresses delivered to, over all trucks.
+ */
+int Fleet::num_stops() const {
+    int total = 0;
+    for (const Route &route : routes) {
+        total += route.size() - 2;
+    }
+    return total;
+}
+
+const Route &Fleet::get_route(int truck) const {
+    return routes.at(truck);
+}
+
+double Fleet::euc_length() const {
+    double total = 0.0;
+    for (const Route &route : routes) {
+        total += route.euc_length();
+    }
+    return total;
+}
+
+double Fleet::man_length() const {
+    double total = 0.0;
+    for (const Route &route : routes) {
+        total += route.man_length();
+    }
+    return total;
+}
+
+/**
+ * Throws std::invalid_argument if num_addrs addresses
+ * do not fit in the fleet.
+ */
+void Fleet::check_capacity(int num_addrs) const {
+    if (max_stops > 0 && num_addrs > max_stops * (int) routes.size()) {
+        throw std::invalid_argument("fleet cannot hold every address");
+    }
+}
+
+/**
+ * Replaces every truck's route with the addresses of its group,
+ * in their original order.
+ */
+void Fleet::assign_groups(const vector<Address> &addrs, const vector<int> &group) {
+    vector<vector<Address> > stops(routes.size());
+    for (int i = 0; i < (int) addrs.size(); i++) {
+        stops[group[i]].push_back(addrs[i]);
+    }
+    for (int t = 0; t < (int) routes.size(); t++) {
+        routes[t] = Route(start_depot, end_depot);
+        routes[t].bulk_add_addresses(stops[t]);
+    }
+}
+
+/**
+ * Partitions addrs among the trucks by their angle around the start
+ * depot: sorted by angle, they are cut into as many runs of near-equal
+ * size as there are trucks. Replaces any previous assignment.
+ */
+void Fleet::assign_sweep(const vector<Address> &addrs) {
+    check_capacity(addrs.size());
+    int n = addrs.size();
+    int trucks = routes.size();
+
+    vector<double> angle(n);
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        angle[i] = std::atan2(addrs[i].get_y() - start_depot.get_y(),
+                              addrs[i].get_x() - start_depot.get_x());
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&angle](int a, int b) { return angle[a] < angle[b]; });
+
+    vector<int> group(n);
+    for (int k = 0; k < n; k++) {
+        group[order[k]] = (int) ((long long) k * trucks / n);
+    }
+    assign_groups(addrs, group);
+}
+
+/**
+ * Partitions addrs among the trucks by k-means clustering, one cluster
+ * per truck, seeded by k-means++ from a generator seeded with seed and
+ * refined for at most max_iters rounds. If a cluster then holds more
+ * than max_stops addresses, those farthest from its center move to the
+ * nearest cluster with room. Replaces any previous assignment.
+ */
+void Fleet::assign_kmeans(const vector<Address> &addrs, unsigned seed, int max_iters) {
+    check_capacity(addrs.size());
+    int n = addrs.size();
+    int k = routes.size();
+    vector<int> group(n, 0);
+    if (n == 0) {
+        assign_groups(addrs, group);
+        return;
+    }
+
+    // k-means++: each further center is drawn with probability
+    // proportional to the squared distance to the nearest center so far
+    std::mt19937 gen(seed);
+    vector<double> cx, cy;
+    vector<double> near_sq(n, std::numeric_limits<double>::infinity());
+    int pick = std::uniform_int_distribution<int>(0, n - 1)(gen);
+    while ((int) cx.size() < k) {
+        cx.push_back(addrs[pick].get_x());
+        cy.push_back(addrs[pick].get_y());
+        double total = 0.0;
+        for (int i = 0; i < n; i++) {
+            double dx = addrs[i].get_x() - cx.back();
+            double dy = addrs[i].get_y() - cy.back();
+            near_sq[i] = std::min(near_sq[i], dx * dx + dy * dy);
+            total += near_sq[i];
+        }
+        if (total <= 0.0) {
+            // fewer distinct points than trucks; the rest stay empty
+            break;
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(gen);
+        pick = 0;
+        while (pick < n - 1 && (target -= near_sq[pick]) > 0.0) {
+            pick++;
+        }
+    }
+
+    for (int iter = 0; iter < max_iters; iter++) {
+        bool changed = (iter == 0);
+        for (int i = 0; i < n; i++) {
+            int best = argmin_sq_euclidean(cx.data(), cy.data(), cx.size(),
+                                           addrs[i].get_x(), addrs[i].get_y());
+            changed = changed || best != group[i];
+            group[i] = best;
+        }
+        if (!changed) break;
+
+        vector<double> sum_x(cx.size(), 0.0), sum_y(cx.size(), 0.0);
+        vector<int> count(cx.size(), 0);
+        for (int i = 0; i < n; i++) {
+            sum_x[group[i]] += addrs[i].get_x();
+            sum_y[group[i]] += addrs[i].get_y();
+            count[group[i]]++;
+        }
+        for (int c = 0; c < (int) cx.size(); c++) {
+            if (count[c] > 0) {
+                cx[c] = sum_x[c] / count[c];
+                cy[c] = sum_y[c] / count[c];
+            }
+        }
+    }
+
+    if (max_stops > 0) {
+        vector<int> count(k, 0);
+        vector<double> off_sq(n);
+        vector<int> order(n);
+        for (int i = 0; i < n; i++) {
+            count[group[i]]++;
+            double dx = addrs[i].get_x() - cx[group[i]];
+            double dy = addrs[i].get_y() - cy[group[i]];
+            off_sq[i] = dx * dx + dy * dy;
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&off_sq](int a, int b) { return off_sq[a] > off_sq[b]; });
+        for (int i : order) {
+            if (count[group[i]] <= max_stops) continue;
+            int best = -1;
+            double best_sq = 0.0;
+            for (int c = 0; c < (int) cx.size(); c++) {
+                if (count[c] >= max_stops) continue;
+                double dx = addrs[i].get_x() - cx[c];
+                double dy = addrs[i].get_y() - cy[c];
+                if (best < 0 || dx * dx + dy * dy < best_sq) {
+                    best = c;
+                    best_sq = dx * dx + dy * dy;
+                }
+            }
+            if (best < 0) {
+                // only clusters without a center have room left
+                best = cx.size();
+                while (count[best] >= max_stops) best++;
+            }
+            count[group[i]]--;
+            count[best]++;
+            group[i] = best;
+        }
+    }
+
+    assign_groups(addrs, group);
+}
+
+/**
+ * Optimizes the route of every truck independently, each on its own
+ * task of a WorkPool with num_threads threads (0 for one per hardware
+ * thread). Each route is improved as Route::oropt_rearrange() does,
+ * both from its current order and from a fresh greedy route, and the
+ * shorter result is kept. Stops never change trucks here.
+ */
+void Fleet::optimize_routes(bool man_norm, int num_threads) {
+    WorkPool pool(num_threads);
+    for (int t = 0; t < (int) routes.size(); t++) {
+        pool.submit([this, t, man_norm]() {
+            const Route &route = routes[t];
+            if (route.size() <= 3) return;
+            Route improved = route.oropt_rearrange(
+                man_norm, NeighborLists(route.get_coords(), FLEET_NEIGHBORS, man_norm));
+            Route greedy = route.greedy_route(man_norm);
+            Route rebuilt = greedy.oropt_rearrange(
+                man_norm, NeighborLists(greedy.get_coords(), FLEET_NEIGHBORS, man_norm));
+            double improved_len = man_norm ? improved.man_length() : improved.euc_length();
+            double rebuilt_len = man_norm ? rebuilt.man_length() : rebuilt.euc_length();
+            routes[t] = (rebuilt_len < improved_len) ? rebuilt : improved;
+        });
+    }
+    pool.wait();
+}
+
+/**
+ * Moves stops between trucks while that shortens the total length:
+ * a stop is either moved next to a nearby stop on another truck, or
+ * swapped with it. Trucks never exceed max_stops. Returns the number
+ * of moves made. Distance is calculated with the Manhattan norm if
+ * man_norm is true, or the Euclidean norm otherwise.
+ */
+int Fleet::exchange_stops(bool man_norm) {
+    vector<Address> stops;
+    vector<vector<int> > tours(routes.size());
+    for (int t = 0; t < (int) routes.size(); t++) {
+        for (int p = 1; p < routes[t].size() - 1; p++) {
+            tours[t].push_back(stops.size());
+            stops.push_back(routes[t].get_address_at(p));
+        }
+    }
+    int num_addrs = stops.size();
+
+    // the depots follow the stops, so they can be used as tour ends
+    CoordStore coords;
+    coords.reserve(num_addrs + 2);
+    for (const Address &addr : stops) {
+        coords.push_back(addr.get_x(), addr.get_y());
+    }
+    coords.push_back(start_depot.get_x(), start_depot.get_y());
+    coords.push_back(end_depot.get_x(), end_depot.get_y());
+    NeighborLists nbrs(coords, FLEET_NEIGHBORS, man_norm);
+
+    int moves;
+    if (man_norm) {
+        BasicDistanceProvider<ManhattanMetric> dists(coords, ManhattanMetric(), DIST_ON_THE_FLY);
+        moves = StopExchange<BasicDistanceProvider<ManhattanMetric> >(
+            dists, nbrs, tours, num_addrs, max_stops).run();
+    } else {
+        BasicDistanceProvider<EuclideanMetric> dists(coords, EuclideanMetric(), DIST_ON_THE_FLY);
+        moves = StopExchange<BasicDistanceProvider<EuclideanMetric> >(
+            dists, nbrs, tours, num_addrs, max_stops).run();
+    }
+
+    for (int t = 0; t < (int) routes.size(); t++) {
+        vector<Address> truck_stops;
+        for (int s : tours[t]) {
+            truck_stops.push_back(stops[s]);
+        }
+        routes[t] = Route(start_depot, end_depot);
+        routes[t].bulk_add_addresses(truck_stops);
+    }
+    return moves;
+}
+
+/**
+ * Plans the whole fleet: partitions addrs among the trucks, optimizes
+ * every route in parallel, moves stops between trucks, and optimizes
+ * the routes once more.
+ */
+void Fleet::plan(const vector<Address> &addrs, bool man_norm,
+                 FleetPartition partition, int num_threads) {
+    if (partition == PARTITION_KMEANS) {
+        assign_kmeans(addrs);
+    } else {
+        assign_sweep(addrs);
+    }
+    optimize_routes(man_norm, num_threads);
+    exchange_stops(man_norm);
+    optimize_routes(man_norm, num_threads);
+}
+
+string Fleet::as_string() const {
+    string str = "";
+
+    for (int t = 0; t < (int) routes.size(); t++) {
+        str += "Truck " + std::to_string(t) + ": " + routes[t].as_string() + "\n";
+    }
+
+    return str;
+}
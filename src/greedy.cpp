@@ -0,0 +1,347 @@
+// greedy.cpp
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "../include/coords.hpp"
+#include "../include/greedy.hpp"
+#include "../include/kdtree.hpp"
+#include "../include/neighbors.hpp"
+
+using std::vector;
+
+// below this many candidates a flat scan beats building a k-d tree
+static const int KDTREE_GREEDY_MIN = 256;
+
+/**
+ * Returns the nearest-neighbor visiting order of the points with
+ * indices in [first, last), starting from the point at index start
+ * (which is not itself part of the order), for the Euclidean or
+ * Manhattan norm. Ties go to the lowest index.
+ *
+ * Large inputs use a k-d tree with deletion, giving about O(n log n)
+ * overall. Small ones copy the candidates into scratch x/y arrays and
+ * scan them with the vectorized argmin kernels: visited entries are
+ * masked by setting their x coordinate to infinity, and once half the
+ * scratch entries are masked they are squeezed out, stably so that
+ * tie-breaking is unaffected. Both paths give the same order.
+ */
+vector<int> geometric_nn_order(const CoordStore &coords, int start,
+                               int first, int last, bool man_norm) {
+    int count = last - first;
+    vector<int> order;
+    order.reserve(count);
+    double qx = coords.x_at(start);
+    double qy = coords.y_at(start);
+
+    if (count >= KDTREE_GREEDY_MIN) {
+        KdTree tree(coords, first, last);
+        while (!tree.empty()) {
+            int ind = tree.nearest(qx, qy, man_norm);
+            if (ind < 0) {
+                // only non-finite coordinates remain; take them in order
+                ind = first;
+                while (!tree.contains(ind)) ind++;
+            }
+            order.push_back(ind);
+            tree.remove(ind);
+            qx = coords.x_at(ind);
+            qy = coords.y_at(ind);
+        }
+        return order;
+    }
+
+    const double inf = std::numeric_limits<double>::infinity();
+    vector<double> xs(coords.x_data() + first, coords.x_data() + last);
+    vector<double> ys(coords.y_data() + first, coords.y_data() + last);
+    vector<int> ids(count);
+    for (int k = 0; k < count; k++) {
+        ids[k] = first + k;
+    }
+    int masked = 0;
+
+    while ((int) order.size() < count) {
+        int pos;
+        if (man_norm) {
+            pos = argmin_manhattan(xs.data(), ys.data(), xs.size(), qx, qy);
+        } else {
+            pos = argmin_sq_euclidean(xs.data(), ys.data(), xs.size(), qx, qy);
+        }
+        if (pos < 0) {
+            // only non-finite coordinates remain; take them in order
+            pos = 0;
+            while (ids[pos] < 0) pos++;
+        }
+
+        order.push_back(ids[pos]);
+        qx = xs[pos];
+        qy = ys[pos];
+        xs[pos] = inf;
+        ids[pos] = -1;
+        masked++;
+
+        if (2 * masked > (int) xs.size()) {
+            int kept = 0;
+            for (int k = 0; k < (int) xs.size(); k++) {
+                if (ids[k] >= 0) {
+                    xs[kept] = xs[k];
+                    ys[kept] = ys[k];
+                    ids[kept] = ids[k];
+                    kept++;
+                }
+            }
+            xs.resize(kept);
+            ys.resize(kept);
+            ids.resize(kept);
+            masked = 0;
+        }
+    }
+
+    return order;
+}
+
+/**
+ * Distance between points i and j of coords under the Manhattan norm
+ * if man_norm is true, or the Euclidean norm otherwise.
+ */
+static double norm_dist(const CoordStore &coords, int i, int j, bool man_norm) {
+    double dx = std::abs(coords.x_at(i) - coords.x_at(j));
+    double dy = std::abs(coords.y_at(i) - coords.y_at(j));
+    return man_norm ? dx + dy : std::sqrt(dx * dx + dy * dy);
+}
+
+/**
+ * Returns the distance along the Hilbert curve through a grid of
+ * 2^HILBERT_BITS cells a side to the cell (x, y).
+ */
+static uint64_t hilbert_key(uint32_t x, uint32_t y) {
+    const uint32_t side = 1u << HILBERT_BITS;
+    uint64_t key = 0;
+    for (uint32_t s = side / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        key += (uint64_t) s * s * ((3 * rx) ^ ry);
+        // turn the quadrant so the curve inside it runs the standard way
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return key;
+}
+
+/**
+ * Returns the indices in [first, last) in the order a Hilbert curve
+ * over their bounding box visits them, in O(n log n). Points close on
+ * the curve are close in the plane, so this is a fast, if rough, tour,
+ * and a spatially coherent order to store points in. Points sharing a
+ * grid cell keep their index order; points with non-finite coordinates
+ * come last.
+ */
+vector<int> hilbert_order(const CoordStore &coords, int first, int last) {
+    double min_x = std::numeric_limits<double>::infinity(), min_y = min_x;
+    double max_x = -min_x, max_y = -min_x;
+    for (int i = first; i < last; i++) {
+        double x = coords.x_at(i), y = coords.y_at(i);
+        if (std::isfinite(x) && std::isfinite(y)) {
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+    }
+    // one scale for both axes, so the cells are square
+    double extent = std::max(max_x - min_x, max_y - min_y);
+    double scale = (extent > 0) ? ((1u << HILBERT_BITS) - 1) / extent : 0.0;
+
+    // sort keys with the index in the low bits, which breaks ties; keys
+    // fill all the high bits, so non-finite points are set aside instead
+    vector<uint64_t> keyed;
+    vector<int> unplaced;
+    keyed.reserve(last - first);
+    for (int i = first; i < last; i++) {
+        double x = coords.x_at(i), y = coords.y_at(i);
+        if (!std::isfinite(x) || !std::isfinite(y)) {
+            unplaced.push_back(i);
+            continue;
+        }
+        uint64_t key = hilbert_key((uint32_t) ((x - min_x) * scale),
+                                   (uint32_t) ((y - min_y) * scale));
+        keyed.push_back((key << 32) | (uint32_t) (i - first));
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    vector<int> order;
+    order.reserve(last - first);
+    for (uint64_t entry : keyed) {
+        order.push_back(first + (int) (entry & 0xffffffffu));
+    }
+    order.insert(order.end(), unplaced.begin(), unplaced.end());
+    return order;
+}
+
+/**
+ * Returns a tour of all points of coords that starts at point 0 (and,
+ * with fixed_ends, ends at the last point) and visits the others in
+ * Hilbert order, run in whichever direction joins the fixed points
+ * more cheaply under the Euclidean or Manhattan norm.
+ */
+vector<int> hilbert_path(const CoordStore &coords, bool fixed_ends, bool man_norm) {
+    int n = coords.size();
+    vector<int> tour;
+    tour.reserve(n);
+    if (n == 0) return tour;
+    int last = (fixed_ends && n >= 2) ? n - 1 : n;
+    vector<int> order = hilbert_order(coords, 1, last);
+
+    if (!order.empty()) {
+        double fwd = norm_dist(coords, 0, order.front(), man_norm);
+        double rev = norm_dist(coords, 0, order.back(), man_norm);
+        if (last < n) {
+            fwd += norm_dist(coords, order.back(), n - 1, man_norm);
+            rev += norm_dist(coords, order.front(), n - 1, man_norm);
+        }
+        if (rev < fwd) {
+            std::reverse(order.begin(), order.end());
+        }
+    }
+
+    tour.push_back(0);
+    tour.insert(tour.end(), order.begin(), order.end());
+    if (last < n) {
+        tour.push_back(n - 1);
+    }
+    return tour;
+}
+
+/**
+ * Returns the root of the fragment holding point i, halving the path
+ * to it on the way.
+ */
+static int fragment_root(vector<int> &parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/**
+ * Returns a tour of all points of coords that starts at point 0 (and,
+ * with fixed_ends, ends at the last point), built by the greedy edge
+ * heuristic under the Euclidean or Manhattan norm.
+ *
+ * The candidate edges to each point's GREEDY_EDGE_NEIGHBORS nearest
+ * neighbors are taken shortest first, and each is kept unless it would
+ * give a point a third edge, or close a cycle, as found with union-find
+ * over the path fragments built so far. The fixed points may only take
+ * one edge, and their fragments are never joined to each other. What
+ * is left is a set of fragments, which are strung together from point
+ * 0, each time crossing to the nearest free end of another fragment,
+ * found with a k-d tree. With fixed_ends the fragment holding the last
+ * point is kept for the end. It takes O(n log n) time, and the tour is
+ * typically 5-8% shorter than the nearest-neighbor tour, with far
+ * fewer long edges left for local search to undo.
+ */
+vector<int> greedy_edge_path(const CoordStore &coords, bool fixed_ends, bool man_norm) {
+    int n = coords.size();
+    vector<int> tour;
+    tour.reserve(n);
+    if (n <= 2) {
+        for (int i = 0; i < n; i++) {
+            tour.push_back(i);
+        }
+        return tour;
+    }
+    int end = fixed_ends ? n - 1 : -1;
+
+    // list each candidate edge once, as (length, a, b) with a < b
+    struct Edge {
+        double len;
+        int a, b;
+        bool operator<(const Edge &other) const {
+            if (len != other.len) return len < other.len;
+            return (a != other.a) ? a < other.a : b < other.b;
+        }
+    };
+    NeighborLists nbrs(coords, GREEDY_EDGE_NEIGHBORS, man_norm);
+    int k = nbrs.per_point();
+    vector<Edge> edges;
+    edges.reserve((size_t) n * k * 3 / 4);
+    for (int i = 0; i < n; i++) {
+        for (int t = 0; t < k; t++) {
+            int j = nbrs.of(i)[t];
+            const int *back = nbrs.of(j);
+            if (j < i && std::find(back, back + k, i) != back + k) continue;
+            double len = norm_dist(coords, i, j, man_norm);
+            if (std::isfinite(len)) {
+                edges.push_back(Edge{len, std::min(i, j), std::max(i, j)});
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // adj holds the (up to) two fragment neighbors of each point
+    vector<int> adj(2 * (size_t) n, -1);
+    vector<int> degree(n, 0);
+    vector<int> parent(n);
+    for (int i = 0; i < n; i++) {
+        parent[i] = i;
+    }
+    auto cap = [&](int i) { return (i == 0 || i == end) ? 1 : 2; };
+    for (const Edge &e : edges) {
+        if (degree[e.a] >= cap(e.a) || degree[e.b] >= cap(e.b)) continue;
+        int ra = fragment_root(parent, e.a), rb = fragment_root(parent, e.b);
+        if (ra == rb) continue;
+        if (end >= 0) {
+            int r0 = fragment_root(parent, 0), r_end = fragment_root(parent, end);
+            if ((ra == r0 && rb == r_end) || (ra == r_end && rb == r0)) continue;
+        }
+        parent[ra] = rb;
+        adj[2 * (size_t) e.a + degree[e.a]++] = e.b;
+        adj[2 * (size_t) e.b + degree[e.b]++] = e.a;
+    }
+
+    // only free ends of fragments stay in the tree
+    KdTree tree(coords);
+    for (int i = 0; i < n; i++) {
+        if (degree[i] == 2) {
+            tree.remove(i);
+        }
+    }
+    // walks the fragment with free end from, appending it to the tour
+    // unless only tracing, and returns the far end
+    auto walk = [&](int from, bool trace) {
+        int prev = -1, curr = from;
+        while (true) {
+            if (!trace) tour.push_back(curr);
+            tree.remove(curr);
+            int next = adj[2 * (size_t) curr];
+            if (next == prev) next = adj[2 * (size_t) curr + 1];
+            if (next < 0 || next == prev) return curr;
+            prev = curr;
+            curr = next;
+        }
+    };
+
+    int last_from = (end >= 0) ? walk(end, true) : -1;
+    int tail = walk(0, false);
+    int scan = 0;
+    while (!tree.empty()) {
+        int from = tree.nearest(coords.x_at(tail), coords.y_at(tail), man_norm);
+        if (from < 0) {
+            // only non-finite coordinates remain; take them in order
+            while (!tree.contains(scan)) scan++;
+            from = scan;
+        }
+        tail = walk(from, false);
+    }
+    if (last_from >= 0) {
+        walk(last_from, false);
+    }
+    return tour;
+}
@@ -0,0 +1,131 @@
+// indextour.cpp
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../include/addresses.hpp"
+#include "../include/coords.hpp"
+#include "../include/indextour.hpp"
+
+using std::vector;
+
+/**
+ * Makes the tour that visits the table's addresses in table order.
+ * Throws std::invalid_argument if table_in is null.
+ */
+IndexTour::IndexTour(std::shared_ptr<const AddressList> table_in, bool fixed_ends_in)
+    : table(table_in), fixed_ends(fixed_ends_in) {
+    if (!table) {
+        throw std::invalid_argument("index tour needs an address table");
+    }
+    order.resize(table->size());
+    for (int i = 0; i < (int) order.size(); i++) {
+        order[i] = i;
+    }
+}
+
+/**
+ * Makes the tour that visits the table's addresses in the order given
+ * by order_in.
+ * Throws std::invalid_argument if table_in is null or order_in is not
+ * a permutation of the table's indices.
+ */
+IndexTour::IndexTour(std::shared_ptr<const AddressList> table_in, const vector<int> &order_in,
+                     bool fixed_ends_in)
+    : table(table_in), order(order_in), fixed_ends(fixed_ends_in) {
+    if (!table) {
+        throw std::invalid_argument("index tour needs an address table");
+    }
+    int n = table->size();
+    vector<char> seen(n, 0);
+    bool valid = (int) order.size() == n;
+    for (int p = 0; p < (int) order.size() && valid; p++) {
+        valid = order[p] >= 0 && order[p] < n && !seen[order[p]];
+        if (valid) {
+            seen[order[p]] = 1;
+        }
+    }
+    if (!valid) {
+        throw std::invalid_argument("order is not a permutation of the address table");
+    }
+}
+
+/**
+ * Throws std::invalid_argument unless a provider of the given size
+ * covers exactly the addresses of the table.
+ */
+void IndexTour::check_provider(int provider_size) const {
+    if (provider_size != table->size()) {
+        throw std::invalid_argument("distance provider does not match address table");
+    }
+}
+
+const AddressList &IndexTour::get_table() const {
+    return *table;
+}
+
+const vector<int> &IndexTour::indices() const {
+    return order;
+}
+
+int IndexTour::size() const {
+    return order.size();
+}
+
+bool IndexTour::has_fixed_ends() const {
+    return fixed_ends;
+}
+
+/**
+ * Returns a const ref to the address at the specified position of the
+ * tour. Fails if the position is invalid.
+ */
+const Address &IndexTour::get_address_at(int pos) const {
+    return table->get_address_at(order.at(pos));
+}
+
+double IndexTour::euc_length() const {
+    BasicDistanceProvider<EuclideanMetric> dists(table->get_coords(), EuclideanMetric(),
+                                                 DIST_ON_THE_FLY);
+    return length(dists);
+}
+
+double IndexTour::man_length() const {
+    BasicDistanceProvider<ManhattanMetric> dists(table->get_coords(), ManhattanMetric(),
+                                                 DIST_ON_THE_FLY);
+    return length(dists);
+}
+
+/**
+ * Returns the tour as a new AddressList, in tour order.
+ */
+AddressList IndexTour::as_list() const {
+    vector<Address> ordered;
+    ordered.reserve(order.size());
+    for (int ind : order) {
+        ordered.push_back(table->get_address_at(ind));
+    }
+    AddressList path;
+    path.set_precision(table->get_coords().get_precision(), table->get_coords().get_unit());
+    path.bulk_add_addresses(ordered);
+    return path;
+}
+
+/**
+ * Returns the tour as a new Route, with its first and last stops as
+ * the depots.
+ * Throws std::logic_error if the tour has fewer than two stops.
+ */
+Route IndexTour::as_route() const {
+    if (order.size() < 2) {
+        throw std::logic_error("a route needs two depots");
+    }
+    vector<Address> middle;
+    middle.reserve(order.size() - 2);
+    for (int p = 1; p < (int) order.size() - 1; p++) {
+        middle.push_back(table->get_address_at(order[p]));
+    }
+    Route path(table->get_address_at(order.front()), table->get_address_at(order.back()));
+    path.set_precision(table->get_coords().get_precision(), table->get_coords().get_unit());
+    path.bulk_add_addresses(middle);
+    return path;
+}
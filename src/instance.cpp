@@ -0,0 +1,407 @@
+// instance.cpp
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/coords.hpp"
+#include "../include/instance.hpp"
+
+using std::vector;
+
+namespace {
+
+const char BINARY_MAGIC[8] = { 'R', 'O', 'U', 'T', 'E', 'B', 'I', 'N' };
+const uint64_t BINARY_HAS_DEADLINES = 1;
+
+// bytes read from a text file at a time
+const size_t READ_CHUNK = 1 << 20;
+
+std::runtime_error file_error(const string &path, const string &what) {
+    return std::runtime_error(path + ": " + what);
+}
+
+std::runtime_error line_error(const string &path, long line_no, const string &what) {
+    return file_error(path, "line " + std::to_string(line_no) + ": " + what);
+}
+
+/**
+ * Reads a text file one line at a time through a fixed buffer, so
+ * files of any size are parsed without holding them in memory. Lines
+ * are returned null-terminated, without their line ending, and stay
+ * valid until the next call.
+ */
+class LineReader {
+    private:
+        FILE *file;
+        vector<char> buf;
+        size_t start, end;
+        bool at_eof;
+        long line_no;
+    public:
+        LineReader(const string &path) : buf(READ_CHUNK + 1), start(0), end(0),
+                                         at_eof(false), line_no(0) {
+            file = std::fopen(path.c_str(), "rb");
+            if (!file) {
+                throw file_error(path, std::strerror(errno));
+            }
+        }
+        ~LineReader() {
+            std::fclose(file);
+        }
+        LineReader(const LineReader &) = delete;
+        LineReader &operator=(const LineReader &) = delete;
+
+        long line_number() const {
+            return line_no;
+        }
+
+        bool next(char *&line) {
+            while (true) {
+                char *nl = (char *) std::memchr(buf.data() + start, '\n', end - start);
+                if (nl || (at_eof && start < end)) {
+                    char *stop = nl ? nl : buf.data() + end;
+                    line = buf.data() + start;
+                    start = nl ? (nl - buf.data()) + 1 : end;
+                    if (stop > line && stop[-1] == '\r') stop--;
+                    *stop = '\0';
+                    line_no++;
+                    return true;
+                }
+                if (at_eof) return false;
+
+                // keep the partial line, growing the buffer if it fills it
+                std::memmove(buf.data(), buf.data() + start, end - start);
+                end -= start;
+                start = 0;
+                if (end + READ_CHUNK + 1 > buf.size()) {
+                    buf.resize(end + READ_CHUNK + 1);
+                }
+                size_t got = std::fread(buf.data() + end, 1, READ_CHUNK, file);
+                end += got;
+                at_eof = got < READ_CHUNK;
+            }
+        }
+};
+
+char *skip_space(char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+/**
+ * Parses a number at p into out and moves p past it; false if there
+ * is none.
+ */
+bool parse_double(char *&p, double &out) {
+    p = skip_space(p);
+    char *after;
+    out = std::strtod(p, &after);
+    if (after == p) return false;
+    p = after;
+    return true;
+}
+
+bool parse_int(char *&p, long &out) {
+    p = skip_space(p);
+    char *after;
+    out = std::strtol(p, &after, 10);
+    if (after == p) return false;
+    p = after;
+    return true;
+}
+
+bool blank(const char *line) {
+    while (*line == ' ' || *line == '\t') line++;
+    return *line == '\0';
+}
+
+string trimmed(const char *begin, const char *end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    return string(begin, end);
+}
+
+}
+
+/**
+ * Maps a binary instance file into memory. The returned coordinates
+ * are a view of the mapping, so no coordinate is copied or parsed and
+ * pages are only read from disk when first touched; the mapping lives
+ * as long as any CoordStore copied from it. Deadlines are copied out,
+ * or set to NO_DEADLINE if the file has none.
+ * Throws std::runtime_error if the file cannot be mapped or is not a
+ * well-formed instance file.
+ */
+Instance load_binary_instance(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw file_error(path, std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int err = errno;
+        close(fd);
+        throw file_error(path, std::strerror(err));
+    }
+    size_t bytes = info.st_size;
+    if (bytes < (size_t) BINARY_HEADER_BYTES) {
+        close(fd);
+        throw file_error(path, "too short for an instance file");
+    }
+    void *mem = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (mem == MAP_FAILED) {
+        throw file_error(path, std::strerror(err));
+    }
+    std::shared_ptr<const void> mapping(mem, [bytes](const void *ptr) {
+        munmap(const_cast<void *>(ptr), bytes);
+    });
+
+    const char *base = (const char *) mem;
+    uint64_t n, flags;
+    std::memcpy(&n, base + 8, sizeof(n));
+    std::memcpy(&flags, base + 16, sizeof(flags));
+    if (std::memcmp(base, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        throw file_error(path, "not an instance file");
+    }
+    bool has_deadlines = flags & BINARY_HAS_DEADLINES;
+    size_t per_stop = 2 * sizeof(double) + (has_deadlines ? sizeof(int32_t) : 0);
+    if (n > (uint64_t) std::numeric_limits<int>::max() ||
+        bytes - BINARY_HEADER_BYTES < n * per_stop) {
+        throw file_error(path, "truncated instance file");
+    }
+
+    Instance inst;
+    inst.name = path;
+    const double *xs = (const double *) (base + BINARY_HEADER_BYTES);
+    inst.coords = CoordStore(mapping, xs, xs + n, n);
+    if (has_deadlines) {
+        const char *dl = base + BINARY_HEADER_BYTES + 2 * n * sizeof(double);
+        vector<int32_t> raw(n);
+        std::memcpy(raw.data(), dl, n * sizeof(int32_t));
+        inst.deadlines.assign(raw.begin(), raw.end());
+    } else {
+        inst.deadlines.assign(n, NO_DEADLINE);
+    }
+    return inst;
+}
+
+/**
+ * Writes coords, and deadlines unless it is empty, as a binary
+ * instance file for load_binary_instance().
+ * Throws std::invalid_argument if deadlines is neither empty nor the
+ * size of coords, and std::runtime_error if the file cannot be written.
+ */
+void save_binary_instance(const string &path, const CoordStore &coords,
+                          const vector<int> &deadlines) {
+    uint64_t n = coords.size();
+    if (!deadlines.empty() && deadlines.size() != n) {
+        throw std::invalid_argument("deadlines do not match coordinates");
+    }
+
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw file_error(path, std::strerror(errno));
+    }
+    uint64_t header[3] = { n, deadlines.empty() ? 0 : BINARY_HAS_DEADLINES, 0 };
+    vector<int32_t> raw(deadlines.begin(), deadlines.end());
+    bool ok = std::fwrite(BINARY_MAGIC, 1, sizeof(BINARY_MAGIC), file) == sizeof(BINARY_MAGIC) &&
+              std::fwrite(header, sizeof(uint64_t), 3, file) == 3 &&
+              std::fwrite(coords.x_data(), sizeof(double), n, file) == n &&
+              std::fwrite(coords.y_data(), sizeof(double), n, file) == n &&
+              std::fwrite(raw.data(), sizeof(int32_t), raw.size(), file) == raw.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        throw file_error(path, "write failed");
+    }
+}
+
+/**
+ * Reads the NODE_COORD_SECTION of a TSPLIB .tsp file, line by line,
+ * straight into the coordinate store. Node numbers are ignored; nodes
+ * are taken in file order. The stops have no deadlines.
+ * Throws std::runtime_error if the file cannot be read, has no node
+ * coordinates, or has a different number of them than its DIMENSION.
+ */
+Instance load_tsplib(const string &path) {
+    LineReader reader(path);
+    Instance inst;
+    inst.name = path;
+    long dimension = -1;
+    bool in_coords = false;
+    char *line;
+
+    while (reader.next(line)) {
+        if (!in_coords) {
+            char *colon = std::strchr(line, ':');
+            string key = trimmed(line, colon ? colon : line + std::strlen(line));
+            string value = colon ? trimmed(colon + 1, colon + std::strlen(colon)) : "";
+            if (key == "NAME") {
+                inst.name = value;
+            } else if (key == "DIMENSION") {
+                dimension = std::atol(value.c_str());
+                if (dimension > 0 && dimension <= std::numeric_limits<int>::max()) {
+                    inst.coords.reserve(dimension);
+                }
+            } else if (key == "NODE_COORD_SECTION") {
+                in_coords = true;
+            } else if (key == "EOF") {
+                break;
+            }
+            continue;
+        }
+
+        if (blank(line)) continue;
+        char *p = line;
+        long node;
+        double x, y;
+        if (!parse_int(p, node)) break;   // the next section, or EOF
+        if (!parse_double(p, x) || !parse_double(p, y)) {
+            throw line_error(path, reader.line_number(), "expected a node number and two coordinates");
+        }
+        inst.coords.push_back(x, y);
+    }
+
+    if (!in_coords) {
+        throw file_error(path, "no NODE_COORD_SECTION");
+    }
+    if (dimension >= 0 && dimension != inst.coords.size()) {
+        throw file_error(path, "DIMENSION is " + std::to_string(dimension) + " but " +
+                               std::to_string(inst.coords.size()) + " nodes were read");
+    }
+    inst.deadlines.assign(inst.coords.size(), NO_DEADLINE);
+    return inst;
+}
+
+/**
+ * Reads a CSV file of "x,y" or "x,y,deadline" lines, line by line,
+ * straight into the coordinate store. A first line that does not start
+ * with a number is taken as a header and skipped, as are blank lines.
+ * Stops without a deadline get NO_DEADLINE.
+ * Throws std::runtime_error if the file cannot be read, a line is
+ * malformed, or a deadline does not fit in an int.
+ */
+Instance load_csv(const string &path) {
+    LineReader reader(path);
+    Instance inst;
+    inst.name = path;
+    bool first = true;
+    char *line;
+
+    while (reader.next(line)) {
+        if (blank(line)) continue;
+        char *p = line;
+        double x, y;
+        long deadline = NO_DEADLINE;
+
+        bool ok = parse_double(p, x);
+        if (!ok && first) {
+            first = false;
+            continue;
+        }
+        first = false;
+        p = skip_space(p);
+        ok = ok && *p++ == ',' && parse_double(p, y);
+        p = skip_space(p);
+        if (ok && *p == ',') {
+            p++;
+            ok = parse_int(p, deadline);
+            p = skip_space(p);
+        }
+        if (!ok || *p != '\0') {
+            throw line_error(path, reader.line_number(), "expected x,y or x,y,deadline");
+        }
+        if (deadline < std::numeric_limits<int>::min() ||
+            deadline > std::numeric_limits<int>::max()) {
+            throw line_error(path, reader.line_number(), "deadline out of range");
+        }
+        inst.coords.push_back(x, y);
+        inst.deadlines.push_back(deadline);
+    }
+    return inst;
+}
+
+/**
+ * Reads a road network in the format described in instance.hpp, line
+ * by line. Nodes and arcs may come in any order.
+ * Throws std::runtime_error if the file cannot be read, a line is
+ * malformed, an arc has a negative or non-finite length, or a node
+ * used by an arc (or below the highest numbered node) has no position.
+ */
+RoadGraph load_road_graph(const string &path) {
+    LineReader reader(path);
+    RoadGraph graph;
+    graph.name = path;
+    vector<double> xs, ys;
+    vector<char> placed;
+    long max_id = 0;
+    char *line;
+
+    while (reader.next(line)) {
+        char *p = skip_space(line);
+        char kind = *p;
+        if (kind == '\0' || kind == 'c' || kind == 'p') continue;
+        p++;
+        if (kind == 'v') {
+            long id;
+            double x, y;
+            if (!parse_int(p, id) || !parse_double(p, x) || !parse_double(p, y)) {
+                throw line_error(path, reader.line_number(), "expected v id x y");
+            }
+            if (id < 1 || id > std::numeric_limits<int>::max()) {
+                throw line_error(path, reader.line_number(), "node ids must be positive");
+            }
+            if (id > (long) xs.size()) {
+                xs.resize(id, 0.0);
+                ys.resize(id, 0.0);
+                placed.resize(id, 0);
+            }
+            xs[id - 1] = x;
+            ys[id - 1] = y;
+            placed[id - 1] = 1;
+            max_id = std::max(max_id, id);
+        } else if (kind == 'a') {
+            long u, v;
+            double len;
+            if (!parse_int(p, u) || !parse_int(p, v) || !parse_double(p, len)) {
+                throw line_error(path, reader.line_number(), "expected a u v length");
+            }
+            if (u < 1 || v < 1 || u > std::numeric_limits<int>::max() ||
+                v > std::numeric_limits<int>::max()) {
+                throw line_error(path, reader.line_number(), "node ids must be positive");
+            }
+            if (!(len >= 0.0 && len < std::numeric_limits<double>::infinity())) {
+                throw line_error(path, reader.line_number(), "road lengths must be finite and not negative");
+            }
+            graph.from.push_back(u - 1);
+            graph.to.push_back(v - 1);
+            graph.length.push_back(len);
+            max_id = std::max(max_id, std::max(u, v));
+        } else {
+            throw line_error(path, reader.line_number(), "unknown record");
+        }
+    }
+
+    if ((long) placed.size() < max_id) {
+        placed.resize(max_id, 0);
+    }
+    for (long id = 0; id < max_id; id++) {
+        if (!placed[id]) {
+            throw file_error(path, "node " + std::to_string(id + 1) + " has no position");
+        }
+    }
+    graph.nodes.insert(0, xs, ys);
+    return graph;
+}
@@ -0,0 +1,274 @@
+// kdtree.cpp
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../include/coords.hpp"
+#include "../include/kdtree.hpp"
+#include "../include/metrics.hpp"
+
+using std::max;
+using std::min;
+using std::pair;
+using std::vector;
+
+// ranges at most this long are scanned linearly instead of split
+static const int LEAF_SIZE = 8;
+
+KdTree::KdTree() : first(0), num_alive(0) { };
+
+/**
+ * Builds a tree over every point in the store.
+ */
+KdTree::KdTree(const CoordStore &coords) : KdTree(coords, 0, coords.size()) { };
+
+/**
+ * Builds a tree over the points with indices in [first_ind, last_ind).
+ * Indices passed to and returned from the tree are store indices.
+ */
+KdTree::KdTree(const CoordStore &coords, int first_ind, int last_ind)
+    : first(first_ind), num_alive(last_ind - first_ind) {
+    int n = num_alive;
+
+    ids.resize(n);
+    for (int s = 0; s < n; s++) {
+        ids[s] = first + s;
+    }
+    live.resize(n);
+    min_x.resize(n);
+    max_x.resize(n);
+    min_y.resize(n);
+    max_y.resize(n);
+    axis.resize(n);
+
+    if (n > 0) {
+        build(coords.x_data(), coords.y_data(), 0, n);
+    }
+
+    xs.resize(n);
+    ys.resize(n);
+    slot_of.resize(n);
+    for (int s = 0; s < n; s++) {
+        xs[s] = coords.x_at(ids[s]);
+        ys[s] = coords.y_at(ids[s]);
+        slot_of[ids[s] - first] = s;
+    }
+};
+
+/**
+ * Recursively arranges slots [lo, hi) into a subtree, splitting at
+ * the median of whichever axis has the larger extent.
+ */
+void KdTree::build(const double *src_x, const double *src_y, int lo, int hi) {
+    int mid = lo + (hi - lo) / 2;
+
+    double lx = src_x[ids[lo]], hx = lx;
+    double ly = src_y[ids[lo]], hy = ly;
+    for (int s = lo + 1; s < hi; s++) {
+        lx = min(lx, src_x[ids[s]]);
+        hx = max(hx, src_x[ids[s]]);
+        ly = min(ly, src_y[ids[s]]);
+        hy = max(hy, src_y[ids[s]]);
+    }
+    min_x[mid] = lx;
+    max_x[mid] = hx;
+    min_y[mid] = ly;
+    max_y[mid] = hy;
+    live[mid] = hi - lo;
+
+    if (hi - lo <= LEAF_SIZE) {
+        axis[mid] = -1;
+        return;
+    }
+
+    const double *key = (hx - lx >= hy - ly) ? src_x : src_y;
+    axis[mid] = (key == src_x) ? 0 : 1;
+    std::nth_element(ids.begin() + lo, ids.begin() + mid, ids.begin() + hi,
+                     [key](int a, int b) { return key[a] < key[b]; });
+
+    build(src_x, src_y, lo, mid);
+    build(src_x, src_y, mid + 1, hi);
+}
+
+int KdTree::size() const {
+    return num_alive;
+}
+
+bool KdTree::empty() const {
+    return num_alive == 0;
+}
+
+/**
+ * Returns true if the store index is in the tree and not yet removed.
+ */
+bool KdTree::contains(int index) const {
+    int local = index - first;
+    return local >= 0 && local < (int) slot_of.size() && slot_of[local] >= 0;
+}
+
+/**
+ * Removes a point by store index. Removing a point that is
+ * not in the tree does nothing.
+ */
+void KdTree::remove(int index) {
+    if (!contains(index)) return;
+
+    int slot = slot_of[index - first];
+    int lo = 0, hi = ids.size();
+    while (true) {
+        int mid = lo + (hi - lo) / 2;
+        live[mid]--;
+        if (slot == mid || axis[mid] < 0) break;
+        if (slot < mid) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    // an infinite coordinate never wins a distance comparison,
+    // so leaf scans need no separate liveness check
+    xs[slot] = std::numeric_limits<double>::infinity();
+    slot_of[index - first] = -1;
+    num_alive--;
+}
+
+// The searches are templates over the ranking metric (SqEuclideanMetric
+// or ManhattanMetric), so the per-point arithmetic is inlined into the
+// leaf scans instead of branching on the norm for every point.
+
+/**
+ * Lower bound on the distance from (qx, qy) to anything in the bounding
+ * box of the range around slot: the distance to the nearest point of
+ * the box. It is computed with the same arithmetic as point distances,
+ * so comparing the two is exact.
+ */
+template <class Metric>
+double KdTree::box_dist(const Metric &metric, int slot, double qx, double qy) const {
+    double bx = min(max(qx, min_x[slot]), max_x[slot]);
+    double by = min(max(qy, min_y[slot]), max_y[slot]);
+    return metric(bx, by, qx, qy);
+}
+
+template <class Metric>
+void KdTree::search(const Metric &metric, int lo, int hi, double qx, double qy,
+                    double &best_len, int &best_ind) const {
+    int mid = lo + (hi - lo) / 2;
+    if (live[mid] == 0 || box_dist(metric, mid, qx, qy) > best_len) {
+        return;
+    }
+
+    // a leaf is every slot in the range; an inner node is just its middle
+    int scan_lo = (axis[mid] < 0) ? lo : mid;
+    int scan_hi = (axis[mid] < 0) ? hi : mid + 1;
+    for (int s = scan_lo; s < scan_hi; s++) {
+        double len = metric(xs[s], ys[s], qx, qy);
+        if (len < best_len || (len == best_len && ids[s] < best_ind)) {
+            best_len = len;
+            best_ind = ids[s];
+        }
+    }
+    if (axis[mid] < 0) return;
+
+    // descend into the nearer child first so the far one is usually pruned
+    int left_mid = lo + (mid - lo) / 2;
+    int right_mid = (mid + 1) + (hi - mid - 1) / 2;
+    bool has_left = mid > lo;
+    bool has_right = hi > mid + 1;
+    double left_bound = has_left ? box_dist(metric, left_mid, qx, qy) : 0.0;
+    double right_bound = has_right ? box_dist(metric, right_mid, qx, qy) : 0.0;
+
+    if (!has_right || (has_left && left_bound <= right_bound)) {
+        if (has_left) search(metric, lo, mid, qx, qy, best_len, best_ind);
+        if (has_right) search(metric, mid + 1, hi, qx, qy, best_len, best_ind);
+    } else {
+        search(metric, mid + 1, hi, qx, qy, best_len, best_ind);
+        if (has_left) search(metric, lo, mid, qx, qy, best_len, best_ind);
+    }
+}
+
+/**
+ * Returns the store index of the remaining point nearest to (qx, qy)
+ * under the Manhattan norm if man_norm is true, or the Euclidean norm
+ * otherwise. Ties go to the lowest index. Returns -1 if the tree is empty.
+ */
+int KdTree::nearest(double qx, double qy, bool man_norm) const {
+    int best_ind = -1;
+    double best_len = std::numeric_limits<double>::infinity();
+    if (num_alive > 0 && man_norm) {
+        search(ManhattanMetric(), 0, ids.size(), qx, qy, best_len, best_ind);
+    } else if (num_alive > 0) {
+        search(SqEuclideanMetric(), 0, ids.size(), qx, qy, best_len, best_ind);
+    }
+    return best_ind;
+}
+
+/**
+ * Like search(), but keeps the k best (length, index) pairs seen so
+ * far in a max-heap, pruning boxes farther than the current k-th best.
+ */
+template <class Metric>
+void KdTree::search_k(const Metric &metric, int lo, int hi, double qx, double qy, int k,
+                      vector<pair<double, int> > &heap) const {
+    int mid = lo + (hi - lo) / 2;
+    if (live[mid] == 0) return;
+    if ((int) heap.size() == k && box_dist(metric, mid, qx, qy) > heap.front().first) {
+        return;
+    }
+
+    int scan_lo = (axis[mid] < 0) ? lo : mid;
+    int scan_hi = (axis[mid] < 0) ? hi : mid + 1;
+    for (int s = scan_lo; s < scan_hi; s++) {
+        if (slot_of[ids[s] - first] < 0) continue;
+        pair<double, int> cand(metric(xs[s], ys[s], qx, qy), ids[s]);
+        if ((int) heap.size() < k) {
+            heap.push_back(cand);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (cand < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = cand;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+    if (axis[mid] < 0) return;
+
+    int left_mid = lo + (mid - lo) / 2;
+    int right_mid = (mid + 1) + (hi - mid - 1) / 2;
+    bool has_left = mid > lo;
+    bool has_right = hi > mid + 1;
+    double left_bound = has_left ? box_dist(metric, left_mid, qx, qy) : 0.0;
+    double right_bound = has_right ? box_dist(metric, right_mid, qx, qy) : 0.0;
+
+    if (!has_right || (has_left && left_bound <= right_bound)) {
+        if (has_left) search_k(metric, lo, mid, qx, qy, k, heap);
+        if (has_right) search_k(metric, mid + 1, hi, qx, qy, k, heap);
+    } else {
+        search_k(metric, mid + 1, hi, qx, qy, k, heap);
+        if (has_left) search_k(metric, lo, mid, qx, qy, k, heap);
+    }
+}
+
+/**
+ * Returns the store indices of the (up to) k remaining points nearest
+ * to (qx, qy), nearest first, with ties going to the lowest index.
+ */
+vector<int> KdTree::k_nearest(double qx, double qy, int k, bool man_norm) const {
+    vector<pair<double, int> > heap;
+    if (k > 0 && num_alive > 0) {
+        heap.reserve(k);
+        if (man_norm) {
+            search_k(ManhattanMetric(), 0, ids.size(), qx, qy, k, heap);
+        } else {
+            search_k(SqEuclideanMetric(), 0, ids.size(), qx, qy, k, heap);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+
+    vector<int> result;
+    result.reserve(heap.size());
+    for (const pair<double, int> &entry : heap) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+// neighbors.cpp
+#include <algorithm>
+#include <vector>
+#include "../include/coords.hpp"
+#include "../include/greedy.hpp"
+#include "../include/kdtree.hpp"
+#include "../include/neighbors.hpp"
+
+using std::vector;
+
+NeighborLists::NeighborLists() : n(0), k(0) { };
+
+/**
+ * Builds the k nearest neighbors of every point under the Manhattan
+ * norm if man_norm is true, or the Euclidean norm otherwise. If there
+ * are fewer than k other points, every list holds all of them.
+ */
+NeighborLists::NeighborLists(const CoordStore &coords, int k_in, bool man_norm)
+    : n(coords.size()), k(std::max(0, std::min(k_in, coords.size() - 1))) {
+    nbrs.resize((size_t) n * k);
+    if (k == 0) return;
+
+    KdTree tree(coords);
+    // query in Hilbert order, so that each search walks much the same
+    // part of the tree as the one before, which is still in cache
+    for (int i : hilbert_order(coords, 0, n)) {
+        // ask for one extra, since the point finds itself (or an
+        // exact duplicate with a lower index) among its nearest
+        vector<int> near = tree.k_nearest(coords.x_at(i), coords.y_at(i), k + 1, man_norm);
+        int *row = nbrs.data() + (size_t) i * k;
+        int added = 0;
+        for (int j = 0; j < (int) near.size() && added < k; j++) {
+            if (near[j] != i) {
+                row[added++] = near[j];
+            }
+        }
+    }
+}
+
+/**
+ * Number of points the lists were built for.
+ */
+int NeighborLists::size() const {
+    return n;
+}
+
+/**
+ * Number of neighbors in each list.
+ */
+int NeighborLists::per_point() const {
+    return k;
+}
+
+/**
+ * Returns the per_point() neighbors of the point at index, nearest first.
+ */
+const int *NeighborLists::of(int index) const {
+    return nbrs.data() + (size_t) index * k;
+}
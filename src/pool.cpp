@@ -0,0 +1,121 @@
+// pool.cpp
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/pool.hpp"
+
+using std::vector;
+
+/**
+ * Starts num_threads workers, or one per hardware thread if it is 0.
+ */
+WorkPool::WorkPool(int num_threads) : queued(0), pending(0), next_queue(0), stopping(false) {
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    for (int t = 0; t < num_threads; t++) {
+        queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+    }
+    for (int t = 0; t < num_threads; t++) {
+        workers.push_back(std::thread(&WorkPool::work, this, t));
+    }
+}
+
+/**
+ * Finishes every submitted task, then stops the workers.
+ */
+WorkPool::~WorkPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+int WorkPool::size() const {
+    return workers.size();
+}
+
+/**
+ * Queues a task. Tasks are dealt to the workers' queues in turn.
+ */
+void WorkPool::submit(std::function<void()> task) {
+    int target;
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        target = next_queue;
+        next_queue = (next_queue + 1) % queues.size();
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        queued++;
+    }
+    wake_cv.notify_one();
+}
+
+/**
+ * Blocks until every task submitted so far has finished.
+ */
+void WorkPool::wait() {
+    std::unique_lock<std::mutex> guard(state_lock);
+    idle_cv.wait(guard, [this] { return pending == 0; });
+}
+
+/**
+ * Takes the newest task of worker self, or failing that the oldest
+ * task of the next worker that has one. Returns false if all are empty.
+ */
+bool WorkPool::take(int self, std::function<void()> &task) {
+    int n = queues.size();
+    for (int k = 0; k < n; k++) {
+        TaskQueue &queue = *queues[(self + k) % n];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+        if (k == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkPool::work(int self) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(state_lock);
+            wake_cv.wait(guard, [this] { return stopping || queued > 0; });
+            if (queued == 0) return;   // stopping, with nothing left to run
+            // claim one queued task before searching for it, so that the
+            // counter never promises another worker a task that is gone
+            queued--;
+        }
+
+        std::function<void()> task;
+        while (!take(self, task)) {
+            // every claim is backed by a queued task, but another worker
+            // may have taken it from behind this scan; look again
+            std::this_thread::yield();
+        }
+        task();
+
+        std::lock_guard<std::mutex> guard(state_lock);
+        if (--pending == 0) {
+            idle_cv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,473 @@
+// road.cpp
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "../include/coords.hpp"
+#include "../include/instance.hpp"
+#include "../include/kdtree.hpp"
+#include "../include/road.hpp"
+
+using std::vector;
+
+namespace {
+
+typedef std::pair<double, int> Entry;
+typedef std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > MinQueue;
+
+/**
+ * Tentative distances of one search, all infinite between searches;
+ * a search resets only the entries it touched. Each thread has its
+ * own, so const queries can run in parallel.
+ */
+struct Scratch {
+    vector<double> dist;
+    vector<int> touched;
+
+    void prepare(int n) {
+        if ((int) dist.size() != n) {
+            dist.assign(n, std::numeric_limits<double>::infinity());
+        }
+    }
+    void set(int v, double d) {
+        if (dist[v] == std::numeric_limits<double>::infinity()) touched.push_back(v);
+        dist[v] = d;
+    }
+    void reset() {
+        for (int v : touched) {
+            dist[v] = std::numeric_limits<double>::infinity();
+        }
+        touched.clear();
+    }
+};
+
+thread_local Scratch search_scratch, meet_scratch;
+
+}
+
+// RoadNetwork class
+
+/**
+ * Builds the contraction hierarchy over graph, and the snapping index
+ * over the nodes of its largest connected part. Roads from a node to
+ * itself are dropped.
+ */
+RoadNetwork::RoadNetwork(const RoadGraph &graph)
+    : n(graph.nodes.size()), nodes(graph.nodes), rank(n, 0), num_shortcuts(0) {
+    vector<vector<Arc> > adj(n);
+    auto add_road = [&adj](int u, int v, double len) {
+        for (Arc &arc : adj[u]) {
+            if (arc.to == v) {
+                if (len < arc.len) {
+                    arc.len = len;
+                    for (Arc &back : adj[v]) {
+                        if (back.to == u) back.len = len;
+                    }
+                }
+                return false;
+            }
+        }
+        adj[u].push_back(Arc{ v, len });
+        adj[v].push_back(Arc{ u, len });
+        return true;
+    };
+    for (int k = 0; k < (int) graph.from.size(); k++) {
+        if (graph.from[k] != graph.to[k]) {
+            add_road(graph.from[k], graph.to[k], graph.length[k]);
+        }
+    }
+
+    // the largest connected part, found by breadth-first search
+    vector<int> part(n, -1), part_size;
+    for (int s = 0; s < n; s++) {
+        if (part[s] >= 0) continue;
+        int id = part_size.size();
+        vector<int> frontier(1, s);
+        part[s] = id;
+        for (int k = 0; k < (int) frontier.size(); k++) {
+            for (const Arc &arc : adj[frontier[k]]) {
+                if (part[arc.to] < 0) {
+                    part[arc.to] = id;
+                    frontier.push_back(arc.to);
+                }
+            }
+        }
+        part_size.push_back(frontier.size());
+    }
+    int largest = std::max_element(part_size.begin(), part_size.end()) - part_size.begin();
+    CoordStore snap_coords;
+    for (int v = 0; v < n; v++) {
+        if (part[v] == largest) {
+            snap_node.push_back(v);
+            snap_coords.push_back(nodes.x_at(v), nodes.y_at(v));
+        }
+    }
+    snap_tree = KdTree(snap_coords);
+
+    build(adj);
+}
+
+/**
+ * Contracts the nodes of adj one at a time, adding shortcuts to adj,
+ * and keeps the edges to higher ranked nodes as the upward graph.
+ *
+ * The next node contracted is the one with the lowest priority: the
+ * shortcuts its contraction would add, less the edges it would remove,
+ * plus the neighbors already contracted, which spreads contraction
+ * evenly over the network. Priorities change as neighbors are
+ * contracted, so they are updated lazily: a node taken from the queue
+ * is contracted only if its current priority is still the lowest.
+ */
+void RoadNetwork::build(vector<vector<Arc> > &adj) {
+    const double inf = std::numeric_limits<double>::infinity();
+    vector<char> done(n, 0);
+    vector<int> contracted_nbrs(n, 0);
+    vector<double> witness(n, inf);
+    vector<int> touched;
+
+    // live neighbors of v, and whether a shortcut is needed for each
+    // pair of them, found by witness searches that avoid v
+    auto shortcuts_of = [&](int v, vector<std::pair<std::pair<int, int>, double> > &out) {
+        out.clear();
+        vector<Arc> nbrs;
+        double max_out = 0.0;
+        for (const Arc &arc : adj[v]) {
+            if (!done[arc.to]) {
+                nbrs.push_back(arc);
+                max_out = std::max(max_out, arc.len);
+            }
+        }
+        for (int a = 0; a + 1 < (int) nbrs.size(); a++) {
+            int u = nbrs[a].to;
+            double limit = nbrs[a].len + max_out;
+            MinQueue queue;
+            witness[u] = 0.0;
+            touched.push_back(u);
+            queue.push(Entry(0.0, u));
+            int settled = 0;
+            while (!queue.empty() && settled < ROAD_WITNESS_SETTLE) {
+                Entry top = queue.top();
+                queue.pop();
+                if (top.first > witness[top.second]) continue;
+                if (top.first > limit) break;
+                settled++;
+                for (const Arc &arc : adj[top.second]) {
+                    if (arc.to == v || done[arc.to]) continue;
+                    double d = top.first + arc.len;
+                    if (d < witness[arc.to]) {
+                        if (witness[arc.to] == inf) touched.push_back(arc.to);
+                        witness[arc.to] = d;
+                        queue.push(Entry(d, arc.to));
+                    }
+                }
+            }
+            for (int b = a + 1; b < (int) nbrs.size(); b++) {
+                double via = nbrs[a].len + nbrs[b].len;
+                if (witness[nbrs[b].to] > via) {
+                    out.push_back(std::make_pair(std::make_pair(u, nbrs[b].to), via));
+                }
+            }
+            for (int t : touched) {
+                witness[t] = inf;
+            }
+            touched.clear();
+        }
+        return (int) nbrs.size();
+    };
+
+    vector<std::pair<std::pair<int, int>, double> > added;
+    auto priority = [&](int v) {
+        int degree = shortcuts_of(v, added);
+        return (int) added.size() - degree + contracted_nbrs[v];
+    };
+
+    std::priority_queue<std::pair<int, int>, vector<std::pair<int, int> >,
+                        std::greater<std::pair<int, int> > > order;
+    for (int v = 0; v < n; v++) {
+        order.push(std::make_pair(priority(v), v));
+    }
+    int next_rank = 0;
+    while (!order.empty()) {
+        int v = order.top().second;
+        order.pop();
+        if (done[v]) continue;
+        int current = priority(v);
+        if (!order.empty() && current > order.top().first) {
+            order.push(std::make_pair(current, v));
+            continue;
+        }
+
+        // added holds v's shortcuts from priority(v)
+        for (const auto &shortcut : added) {
+            int u = shortcut.first.first, w = shortcut.first.second;
+            bool found = false;
+            for (Arc &arc : adj[u]) {
+                if (arc.to == w) {
+                    found = true;
+                    if (shortcut.second < arc.len) {
+                        arc.len = shortcut.second;
+                        for (Arc &back : adj[w]) {
+                            if (back.to == u) back.len = shortcut.second;
+                        }
+                    }
+                }
+            }
+            if (!found) {
+                adj[u].push_back(Arc{ w, shortcut.second });
+                adj[w].push_back(Arc{ u, shortcut.second });
+                num_shortcuts++;
+            }
+        }
+        rank[v] = next_rank++;
+        done[v] = 1;
+        for (const Arc &arc : adj[v]) {
+            contracted_nbrs[arc.to]++;
+        }
+    }
+
+    up_first.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        for (const Arc &arc : adj[v]) {
+            if (rank[arc.to] > rank[v]) up_first[v + 1]++;
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        up_first[v + 1] += up_first[v];
+    }
+    up_arcs.resize(up_first[n]);
+    for (int v = 0; v < n; v++) {
+        int k = up_first[v];
+        for (const Arc &arc : adj[v]) {
+            if (rank[arc.to] > rank[v]) up_arcs[k++] = arc;
+        }
+    }
+}
+
+int RoadNetwork::size() const {
+    return n;
+}
+
+// the number of shortcut edges the hierarchy added
+long RoadNetwork::shortcuts() const {
+    return num_shortcuts;
+}
+
+const CoordStore &RoadNetwork::get_nodes() const {
+    return nodes;
+}
+
+/**
+ * Returns the node nearest to (x, y) in a straight line among those
+ * of the largest connected part of the network, or -1 if there are no
+ * nodes.
+ */
+int RoadNetwork::snap(double x, double y) const {
+    int found = snap_tree.nearest(x, y, false);
+    return (found < 0) ? -1 : snap_node[found];
+}
+
+/**
+ * Runs Dijkstra's algorithm from source over the upward edges only,
+ * and leaves in settled every node it settles with its distance. Nodes
+ * reached more cheaply from a higher neighbor than upward cannot be on
+ * a shortest path climbing from source, so they are stalled: left out,
+ * and not searched from.
+ */
+void RoadNetwork::upward_search(int source, vector<std::pair<int, double> > &settled) const {
+    settled.clear();
+    Scratch &scratch = search_scratch;
+    scratch.prepare(n);
+    MinQueue queue;
+    scratch.set(source, 0.0);
+    queue.push(Entry(0.0, source));
+    while (!queue.empty()) {
+        Entry top = queue.top();
+        queue.pop();
+        int v = top.second;
+        if (top.first > scratch.dist[v]) continue;
+        bool stalled = false;
+        for (int k = up_first[v]; k < up_first[v + 1] && !stalled; k++) {
+            stalled = scratch.dist[up_arcs[k].to] + up_arcs[k].len < top.first;
+        }
+        if (stalled) continue;
+        settled.push_back(std::make_pair(v, top.first));
+        for (int k = up_first[v]; k < up_first[v + 1]; k++) {
+            const Arc &arc = up_arcs[k];
+            double d = top.first + arc.len;
+            if (d < scratch.dist[arc.to]) {
+                scratch.set(arc.to, d);
+                queue.push(Entry(d, arc.to));
+            }
+        }
+    }
+    scratch.reset();
+}
+
+/**
+ * Returns the length of the shortest road path between nodes s and t,
+ * or infinity if there is none: the least sum of the distances from
+ * both to a node their upward searches share.
+ */
+double RoadNetwork::node_distance(int s, int t) const {
+    if (s == t) return 0.0;
+    vector<std::pair<int, double> > from_s, from_t;
+    upward_search(s, from_s);
+    upward_search(t, from_t);
+    Scratch &meet = meet_scratch;
+    meet.prepare(n);
+    for (const auto &reached : from_s) {
+        meet.set(reached.first, reached.second);
+    }
+    double best = std::numeric_limits<double>::infinity();
+    for (const auto &reached : from_t) {
+        best = std::min(best, meet.dist[reached.first] + reached.second);
+    }
+    meet.reset();
+    return best;
+}
+
+/**
+ * Returns the shortest road distances from each of sources to each of
+ * targets, row after row, using RoadBuckets.
+ */
+vector<double> RoadNetwork::node_table(const vector<int> &sources,
+                                       const vector<int> &targets) const {
+    vector<double> table(sources.size() * targets.size());
+    RoadBuckets buckets(*this, targets);
+    for (int k = 0; k < (int) sources.size(); k++) {
+        buckets.distances_from(sources[k], table.data() + k * targets.size());
+    }
+    return table;
+}
+
+// RoadBuckets class
+
+/**
+ * Fills the buckets for targets, a list of nodes of network_in, which
+ * must outlive the buckets.
+ */
+RoadBuckets::RoadBuckets(const RoadNetwork &network_in, const vector<int> &targets)
+    : network(&network_in), num_targets(targets.size()), first(network_in.size() + 1, 0) {
+    vector<std::pair<int, double> > settled;
+    vector<int> node_of;
+    vector<std::pair<int, double> > unsorted;
+    for (int k = 0; k < num_targets; k++) {
+        network->upward_search(targets[k], settled);
+        for (const auto &reached : settled) {
+            node_of.push_back(reached.first);
+            unsorted.push_back(std::make_pair(k, reached.second));
+            first[reached.first + 1]++;
+        }
+    }
+    for (int v = 0; v < network->size(); v++) {
+        first[v + 1] += first[v];
+    }
+    // counting sort by node, keeping target order within each bucket
+    vector<int> fill(first.begin(), first.end() - 1);
+    entries.resize(unsorted.size());
+    for (int e = 0; e < (int) unsorted.size(); e++) {
+        entries[fill[node_of[e]]++] = unsorted[e];
+    }
+}
+
+/**
+ * Writes the shortest road distance from node source to each target,
+ * in target order, to out.
+ */
+void RoadBuckets::distances_from(int source, double *out) const {
+    std::fill(out, out + num_targets, std::numeric_limits<double>::infinity());
+    vector<std::pair<int, double> > settled;
+    network->upward_search(source, settled);
+    for (const auto &reached : settled) {
+        for (int e = first[reached.first]; e < first[reached.first + 1]; e++) {
+            double d = reached.second + entries[e].second;
+            if (d < out[entries[e].first]) {
+                out[entries[e].first] = d;
+            }
+        }
+    }
+}
+
+// RoadMetric struct
+
+RoadMetric::RoadMetric(std::shared_ptr<const RoadNetwork> network_in)
+    : network(network_in), rows(std::make_shared<RowState>()) { };
+
+/**
+ * The road distance between two points, plus the straight stretches
+ * from each to its node, added shorter first so that the distance is
+ * the same both ways. The distance from a point to itself is 0.
+ */
+static double road_dist(double road, double leg1, double leg2) {
+    return road + (std::min(leg1, leg2) + std::max(leg1, leg2));
+}
+
+double RoadMetric::operator()(double x1, double y1, double x2, double y2) const {
+    if (x1 == x2 && y1 == y2) return 0.0;
+    const CoordStore &nodes = network->get_nodes();
+    int a = network->snap(x1, y1), b = network->snap(x2, y2);
+    if (a < 0 || b < 0) return std::numeric_limits<double>::infinity();
+    double leg1 = euclidean_metric(x1, y1, nodes.x_at(a), nodes.y_at(a));
+    double leg2 = euclidean_metric(x2, y2, nodes.x_at(b), nodes.y_at(b));
+    return road_dist(network->node_distance(a, b), leg1, leg2);
+}
+
+/**
+ * Fills rows of road distances between the points of coords for a
+ * distance provider (see metric_fill_rows() in distances.hpp). The
+ * points are snapped and their buckets filled on the first call for a
+ * set of points, and reused while later calls ask about the same ones.
+ */
+bool metric_fill_rows(const RoadMetric &metric, const CoordStore &coords, const int *rows,
+                      int count, double *out) {
+    typedef RoadMetric::RowState::Points Points;
+    const RoadNetwork &network = *metric.network;
+    int n = coords.size();
+    std::shared_ptr<const Points> points;
+    {
+        std::lock_guard<std::mutex> guard(metric.rows->lock);
+        points = metric.rows->last;
+        if (!points || (int) points->xs.size() != n ||
+            !std::equal(points->xs.begin(), points->xs.end(), coords.x_data()) ||
+            !std::equal(points->ys.begin(), points->ys.end(), coords.y_data())) {
+            std::shared_ptr<Points> fresh = std::make_shared<Points>();
+            fresh->xs.assign(coords.x_data(), coords.x_data() + n);
+            fresh->ys.assign(coords.y_data(), coords.y_data() + n);
+            const CoordStore &nodes = network.get_nodes();
+            for (int i = 0; i < n; i++) {
+                int node = network.snap(coords.x_at(i), coords.y_at(i));
+                fresh->node.push_back(node);
+                fresh->leg.push_back(node < 0 ? 0.0 : euclidean_metric(
+                    coords.x_at(i), coords.y_at(i), nodes.x_at(node), nodes.y_at(node)));
+            }
+            if (network.size() > 0) {
+                fresh->buckets.reset(new RoadBuckets(network, fresh->node));
+            }
+            metric.rows->last = fresh;
+            points = fresh;
+        }
+    }
+
+    for (int k = 0; k < count; k++) {
+        int i = rows[k];
+        double *row = out + (size_t) k * n;
+        if (!points->buckets) {
+            std::fill(row, row + n, std::numeric_limits<double>::infinity());
+        } else {
+            points->buckets->distances_from(points->node[i], row);
+        }
+        for (int j = 0; j < n; j++) {
+            if (points->xs[i] == points->xs[j] && points->ys[i] == points->ys[j]) {
+                row[j] = 0.0;
+            } else {
+                row[j] = road_dist(row[j], points->leg[i], points->leg[j]);
+            }
+        }
+    }
+    return true;
+}
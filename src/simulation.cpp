@@ -0,0 +1,146 @@
+// simulation.cpp
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../include/addresses.hpp"
+#include "../include/simulation.hpp"
+
+using std::vector;
+
+/**
+ * Starts on day 0 with no orders, every truck waiting at a depot in
+ * the middle of the square.
+ * Throws std::invalid_argument if there are no trucks or they have no
+ * capacity.
+ */
+Simulation::Simulation(const SimulationConfig &config_in)
+    : config(config_in), depot(config_in.side / 2, config_in.side / 2, 0),
+      gen(config_in.seed), day(0) {
+    if (config.num_trucks < 1 || config.stops_per_day < 1) {
+        throw std::invalid_argument("simulation needs trucks with room for deliveries");
+    }
+    for (int t = 0; t < config.num_trucks; t++) {
+        plans.push_back(Route(depot, depot));
+    }
+}
+
+/**
+ * Returns the truck whose slice of the angle around the depot holds addr.
+ */
+int Simulation::truck_for(const Address &addr) const {
+    const double pi = std::acos(-1.0);
+    double angle = std::atan2(addr.get_y() - depot.get_y(), addr.get_x() - depot.get_x());
+    int truck = (int) ((angle + pi) / (2 * pi) * config.num_trucks);
+    return std::max(0, std::min(truck, config.num_trucks - 1));
+}
+
+double Simulation::length(const AddressList &route) const {
+    return config.man_norm ? route.man_length() : route.euc_length();
+}
+
+/**
+ * Runs one day: releases the day's orders, plans and drives each
+ * truck's deliveries, and moves on to the next day.
+ *
+ * New orders are put into the standing routes with
+ * Route::insert_cheapest(), and delivered ones are taken out with
+ * Route::remove_stops(). Both only repair the stretch of route around
+ * the change, so a day costs about the same however long the
+ * simulation has run. With config.rebuild the routes are instead
+ * rebuilt with greedy_route() and opt2_rearrange() every day, which is
+ * much slower, for comparison. Orders are drawn the same way in both
+ * modes.
+ */
+DayReport Simulation::step() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool man_norm = config.man_norm;
+    DayReport report = DayReport();
+    report.day = day;
+
+    std::uniform_real_distribution<double> coord(0.0, config.side);
+    std::uniform_int_distribution<int> lead(0, std::max(0, config.max_lead_days));
+    vector<vector<Address> > arrivals(config.num_trucks);
+    for (int k = 0; k < config.orders_per_day; k++) {
+        double x = coord(gen), y = coord(gen);
+        Address order(x, y, day + lead(gen));
+        arrivals[truck_for(order)].push_back(order);
+        report.released++;
+    }
+
+    for (int t = 0; t < config.num_trucks; t++) {
+        Route &plan = plans[t];
+        if (config.rebuild) {
+            for (const Address &order : arrivals[t]) {
+                plan.add_unique_address(order);
+            }
+            plan = plan.greedy_route(man_norm);
+            if (plan.size() > 3) {
+                plan = plan.opt2_rearrange(man_norm);
+            }
+        } else {
+            for (const Address &order : arrivals[t]) {
+                plan.insert_cheapest(order, man_norm);
+            }
+        }
+
+        // due stops, most overdue first, equally urgent ones in route order
+        vector<int> due;
+        for (int p = 1; p < plan.size() - 1; p++) {
+            if (plan.get_address_at(p).get_delivery_deadline() <= day) due.push_back(p);
+        }
+        std::stable_sort(due.begin(), due.end(), [&plan](int a, int b) {
+            return plan.get_address_at(a).get_delivery_deadline() <
+                   plan.get_address_at(b).get_delivery_deadline();
+        });
+        int taken = std::min((int) due.size(), config.stops_per_day);
+        vector<int> today(due.begin(), due.begin() + taken);
+        std::sort(today.begin(), today.end());
+
+        // drive today's stops in the order of the standing route
+        Route driven(depot, depot);
+        vector<Address> visits;
+        for (int p : today) {
+            const Address &stop = plan.get_address_at(p);
+            visits.push_back(stop);
+            if (stop.get_delivery_deadline() < day) report.late++;
+        }
+        driven.bulk_add_addresses(visits);
+        report.distance += length(driven);
+        report.delivered += taken;
+        report.carried += due.size() - taken;
+
+        plan.remove_stops(today, man_norm);
+    }
+
+    report.backlog = backlog();
+    std::chrono::duration<double> spent = std::chrono::steady_clock::now() - start;
+    report.seconds = spent.count();
+    day++;
+    return report;
+}
+
+int Simulation::get_day() const {
+    return day;
+}
+
+/**
+ * Returns the number of orders held by all trucks and not yet delivered.
+ */
+int Simulation::backlog() const {
+    int held = 0;
+    for (const Route &plan : plans) {
+        held += plan.size() - 2;
+    }
+    return held;
+}
+
+/**
+ * Returns the standing route of a truck, through every order it holds.
+ * Fails if the truck is invalid.
+ */
+const Route &Simulation::get_plan(int truck) const {
+    return plans.at(truck);
+}
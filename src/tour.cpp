@@ -0,0 +1,77 @@
+// tour.cpp
+#include <vector>
+#include "../include/tour.hpp"
+
+using std::vector;
+
+CyclicTour::CyclicTour() { };
+
+/**
+ * Builds the cycle visiting cities in the given order, then back to the
+ * first. City ids must be distinct and in [0, num_ids).
+ */
+CyclicTour::CyclicTour(const vector<int> &cities, int num_ids)
+    : order(cities), pos(num_ids, -1) {
+    for (int p = 0; p < (int) order.size(); p++) {
+        pos[order[p]] = p;
+    }
+}
+
+bool CyclicTour::contains(int city) const {
+    return city >= 0 && city < (int) pos.size() && pos[city] >= 0;
+}
+
+/**
+ * Reverses the path that runs from city from forward to city to,
+ * or equivalently the rest of the cycle, whichever is shorter.
+ */
+void CyclicTour::reverse(int from, int to) {
+    int n = order.size();
+    int i = pos[from], j = pos[to];
+    int len = j - i;
+    if (len < 0) len += n;
+    len += 1;
+
+    if (2 * len > n) {
+        i = (j + 1 == n) ? 0 : j + 1;
+        j = (pos[from] == 0) ? n - 1 : pos[from] - 1;
+        len = n - len;
+    }
+
+    for (int k = 0; k < len / 2; k++) {
+        int ci = order[i], cj = order[j];
+        order[i] = cj;
+        pos[cj] = i;
+        order[j] = ci;
+        pos[ci] = j;
+        if (++i == n) i = 0;
+        if (--j < 0) j = n - 1;
+    }
+}
+
+/**
+ * Two-edge exchange: removes edges (a, b) and (c, d) and adds (a, c)
+ * and (b, d). b must be adjacent to a and d to c, on the same side:
+ * either b = next(a) and d = next(c), or b = prev(a) and d = prev(c).
+ */
+void CyclicTour::exchange(int a, int b, int c, int d) {
+    if (next(a) == b) {
+        reverse(b, c);
+    } else {
+        reverse(a, d);
+    }
+}
+
+/**
+ * Returns every city, starting at start and following next().
+ */
+vector<int> CyclicTour::walk_from(int start) const {
+    vector<int> cities;
+    cities.reserve(order.size());
+    int p = pos[start];
+    for (int k = 0; k < (int) order.size(); k++) {
+        cities.push_back(order[p]);
+        if (++p == (int) order.size()) p = 0;
+    }
+    return cities;
+}
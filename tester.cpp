@@ -1,12 +1,99 @@
 // tester.cpp
 // Contains all test code.
 // Yes there's probably a better way to do TDD...
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <vector>
 #include "include/addresses.hpp"
+#include "include/batch.hpp"
+#include "include/budget.hpp"
+#include "include/coords.hpp"
+#include "include/distances.hpp"
+#include "include/fleet.hpp"
+#include "include/indextour.hpp"
+#include "include/instance.hpp"
+#include "include/kdtree.hpp"
+#include "include/metrics.hpp"
+#include "include/opt2.hpp"
+#include "include/pool.hpp"
+#include "include/road.hpp"
+#include "include/simulation.hpp"
+#include "include/stats.hpp"
+#include "include/tour.hpp"
 
 using std::cout;
 using std::endl;
+using std::vector;
+
+// every heap allocation made by the program, so tests can check that
+// a solve made none. Every form of the global operators is replaced,
+// so whatever new allocates, delete frees the same way. The helpers are
+// kept out of line, or g++ sees malloc() meet operator delete and warns
+// of a mismatch.
+std::atomic<long> heap_allocs(0);
+
+__attribute__((noinline)) void *counted_alloc(std::size_t size) noexcept {
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+__attribute__((noinline)) void counted_free(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+    void *ptr = counted_alloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    void *ptr = counted_alloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_alloc(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    counted_free(ptr);
+}
 
 // test functions return true on success
 
@@ -103,34 +190,1896 @@ bool test_opt2() {
     return true;
 }
 
+bool test_coord_kernels() {
+    // small integer grid so that ties are common
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> coord(0, 6);
+
+    for (int n = 0; n < 40; n++) {
+        CoordStore store;
+        for (int i = 0; i < n; i++) {
+            store.push_back(coord(gen), coord(gen));
+        }
+        double qx = coord(gen), qy = coord(gen);
+        Address query(qx, qy, 0);
+
+        // reference: plain left-to-right scan, first minimum wins
+        int euc_ref = -1, man_ref = -1;
+        double euc_best = 1e300, man_best = 1e300;
+        for (int i = 0; i < n; i++) {
+            Address other(store.x_at(i), store.y_at(i), 0);
+            if (query.euclidean_dist(other) < euc_best) {
+                euc_best = query.euclidean_dist(other);
+                euc_ref = i;
+            }
+            if (query.manhattan_dist(other) < man_best) {
+                man_best = query.manhattan_dist(other);
+                man_ref = i;
+            }
+        }
+
+        if (argmin_sq_euclidean(store.x_data(), store.y_data(), n, qx, qy) != euc_ref ||
+            argmin_manhattan(store.x_data(), store.y_data(), n, qx, qy) != man_ref) {
+            return false;
+        }
+    }
+
+    // greedy routes must match a plain nearest-neighbor construction
+    std::uniform_real_distribution<double> real_coord(0.0, 100.0);
+    AddressList list;
+    for (int i = 0; i < 200; i++) {
+        list.add_address(Address(real_coord(gen), real_coord(gen), 0));
+    }
+
+    for (int norm = 0; norm < 2; norm++) {
+        bool man_norm = (norm == 1);
+        AddressList greedy = list.greedy_route(man_norm);
+
+        vector<bool> used(list.size());
+        used[0] = true;
+        int curr = 0;
+        for (int step = 1; step < list.size(); step++) {
+            int next = -1;
+            double next_dist = 1e300;
+            for (int i = 0; i < list.size(); i++) {
+                if (used[i]) continue;
+                double dist = man_norm ?
+                    list.get_address_at(curr).manhattan_dist(list.get_address_at(i)) :
+                    list.get_address_at(curr).euclidean_dist(list.get_address_at(i));
+                if (dist < next_dist) {
+                    next_dist = dist;
+                    next = i;
+                }
+            }
+            if (greedy.get_address_at(step) != list.get_address_at(next)) {
+                return false;
+            }
+            used[next] = true;
+            curr = next;
+        }
+    }
+
+    return true;
+}
+
+bool test_spatial_index() {
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<int> coord(0, 60);
+
+    // integer coordinates give plenty of exact ties
+    CoordStore store;
+    for (int i = 0; i < 3000; i++) {
+        store.push_back(coord(gen), coord(gen));
+    }
+
+    for (int norm = 0; norm < 2; norm++) {
+        bool man_norm = (norm == 1);
+        KdTree tree(store);
+        vector<double> xs(store.x_data(), store.x_data() + store.size());
+        vector<double> ys(store.y_data(), store.y_data() + store.size());
+
+        // alternate queries with deletions and compare against a scan
+        for (int step = 0; step < 3000; step++) {
+            double qx = coord(gen), qy = coord(gen);
+            int expect = man_norm ?
+                argmin_manhattan(xs.data(), ys.data(), xs.size(), qx, qy) :
+                argmin_sq_euclidean(xs.data(), ys.data(), xs.size(), qx, qy);
+            if (tree.nearest(qx, qy, man_norm) != expect) return false;
+            tree.remove(expect);
+            xs[expect] = std::numeric_limits<double>::infinity();
+        }
+        if (!tree.empty() || tree.nearest(0, 0, man_norm) != -1) return false;
+    }
+
+    // large lists are built through the tree; check against a plain scan
+    AddressList list;
+    for (int i = 0; i < 1000; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    AddressList greedy = list.greedy_route(true);
+    vector<bool> used(list.size());
+    used[0] = true;
+    int curr = 0;
+    for (int step = 1; step < list.size(); step++) {
+        int next = -1;
+        double next_dist = 1e300;
+        for (int i = 0; i < list.size(); i++) {
+            double dist = list.get_address_at(curr).manhattan_dist(list.get_address_at(i));
+            if (!used[i] && dist < next_dist) {
+                next_dist = dist;
+                next = i;
+            }
+        }
+        if (greedy.get_address_at(step) != list.get_address_at(next)) return false;
+        used[next] = true;
+        curr = next;
+    }
+
+    // indexed queries agree with unindexed ones
+    AddressList indexed = list;
+    indexed.build_spatial_index();
+    for (int i = 0; i < 100; i++) {
+        Address query(coord(gen), coord(gen), 0);
+        if (indexed.euc_index_closest_to(query) != list.euc_index_closest_to(query) ||
+            indexed.man_index_closest_to(query) != list.man_index_closest_to(query)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_neighbor_opt2() {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+
+    Route deliveries(Address(0, 0, 0), Address(1000, 1000, 0));
+    for (int i = 0; i < 300; i++) {
+        deliveries.add_address(Address(coord(gen), coord(gen), 0));
+    }
+
+    for (int norm = 0; norm < 2; norm++) {
+        bool man_norm = (norm == 1);
+        Route greedy = deliveries.greedy_route(man_norm);
+        NeighborLists nbrs(greedy.get_coords(), 8, man_norm);
+
+        Route full = greedy.opt2_rearrange(man_norm);
+        Route fast = greedy.opt2_rearrange(man_norm, nbrs);
+
+        if (fast.size() != greedy.size() ||
+            fast.get_address_at(0) != greedy.get_address_at(0) ||
+            fast.get_final_addr() != greedy.get_final_addr()) {
+            return false;
+        }
+
+        double full_len = man_norm ? full.man_length() : full.euc_length();
+        double fast_len = man_norm ? fast.man_length() : fast.euc_length();
+        double greedy_len = man_norm ? greedy.man_length() : greedy.euc_length();
+
+        // should improve on greedy and land close to the full search
+        if (fast_len > greedy_len || fast_len > 1.10 * full_len) return false;
+    }
+
+    // the square from test_opt2 is solved as well
+    AddressList square;
+    square.add_address(Address(0, 0, 0));
+    square.add_address(Address(5, 5, 0));
+    square.add_address(Address(0, 5, 0));
+    square.add_address(Address(5, 0, 0));
+    AddressList opt = square.opt2_rearrange(false, NeighborLists(square.get_coords(), 3, false));
+    if (std::abs(opt.euc_length() - 15.0) > 0.01) return false;
+
+    return true;
+}
+
+double chebyshev_metric(double x1, double y1, double x2, double y2) {
+    return std::max(std::abs(x1 - x2), std::abs(y1 - y2));
+}
+
+bool test_distance_provider() {
+    std::mt19937 gen(2024);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+
+    Route deliveries(0);
+    for (int i = 0; i < 150; i++) {
+        deliveries.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    const CoordStore &coords = deliveries.get_coords();
+    int n = deliveries.size();
+
+    // every storage mode gives the same distances
+    DistanceProvider dense(coords, euclidean_metric, DIST_DENSE);
+    DistanceProvider cached(coords, euclidean_metric, DIST_ROW_CACHE, 10 * n * sizeof(double));
+    DistanceProvider fly(coords, euclidean_metric, DIST_ON_THE_FLY);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double expect = deliveries.get_address_at(i).euclidean_dist(deliveries.get_address_at(j));
+            if (dense.dist(i, j) != expect || cached.dist(j, i) != expect ||
+                fly.dist(i, j) != expect) {
+                return false;
+            }
+        }
+    }
+
+    // and the same routes
+    Route by_dense = deliveries.opt2_rearrange(dense);
+    Route by_cached = deliveries.opt2_rearrange(cached);
+    Route by_fly = deliveries.opt2_rearrange(fly);
+    if (by_dense.as_string() != by_cached.as_string() ||
+        by_dense.as_string() != by_fly.as_string() ||
+        by_dense.as_string() != deliveries.opt2_rearrange(false).as_string() ||
+        std::abs(deliveries.length(dense) - deliveries.euc_length()) > 1e-9) {
+        return false;
+    }
+
+    // automatic mode follows the budget
+    if (DistanceProvider::choose_mode(100, 100 * 100 * sizeof(double)) != DIST_DENSE ||
+        DistanceProvider::choose_mode(1000, 100 * 1000 * sizeof(double)) != DIST_ROW_CACHE ||
+        DistanceProvider::choose_mode(1000, 10 * 1000 * sizeof(double)) != DIST_ON_THE_FLY) {
+        return false;
+    }
+
+    // a user-supplied metric drives the heuristics too
+    DistanceProvider cheb(coords, chebyshev_metric);
+    Route greedy = deliveries.greedy_route(cheb);
+    if (greedy.size() != n || greedy.get_final_addr() != deliveries.get_final_addr()) {
+        return false;
+    }
+    for (int step = 1; step < n - 2; step++) {
+        // each stop is the closest among those still unvisited
+        const Address &curr = greedy.get_address_at(step);
+        double next_len = chebyshev_metric(curr.get_x(), curr.get_y(),
+            greedy.get_address_at(step + 1).get_x(), greedy.get_address_at(step + 1).get_y());
+        for (int later = step + 2; later < n - 1; later++) {
+            const Address &other = greedy.get_address_at(later);
+            if (chebyshev_metric(curr.get_x(), curr.get_y(), other.get_x(), other.get_y()) < next_len) {
+                return false;
+            }
+        }
+    }
+    Route cheb_opt = greedy.opt2_rearrange(cheb);
+    DistanceProvider cheb_opt_dists(cheb_opt.get_coords(), chebyshev_metric);
+    if (cheb_opt.length(cheb_opt_dists) > greedy.length(cheb) ||
+        deliveries.index_closest_to(Address(50, 50, 0), cheb) < 0) {
+        return false;
+    }
+
+    return true;
+}
+
+bool test_metric_policies() {
+    std::mt19937 gen(77);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+
+    Route deliveries(0);
+    for (int i = 0; i < 300; i++) {
+        deliveries.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    const CoordStore &coords = deliveries.get_coords();
+
+    // typed providers match the run-time ones and the bool API exactly
+    BasicDistanceProvider<EuclideanMetric> euc(coords);
+    BasicDistanceProvider<ManhattanMetric> man(coords);
+    DistanceProvider euc_fn(coords, euclidean_metric);
+    DistanceProvider man_fn(coords, manhattan_metric);
+    if (deliveries.greedy_route(euc).as_string() != deliveries.greedy_route(euc_fn).as_string() ||
+        deliveries.greedy_route(euc).as_string() != deliveries.greedy_route(false).as_string() ||
+        deliveries.greedy_route(man).as_string() != deliveries.greedy_route(man_fn).as_string() ||
+        deliveries.greedy_route(man).as_string() != deliveries.greedy_route(true).as_string() ||
+        deliveries.opt2_rearrange(man).as_string() != deliveries.opt2_rearrange(true).as_string() ||
+        deliveries.length(man) != deliveries.man_length()) {
+        return false;
+    }
+
+    // a scaled metric ranks like its base, so routes are unchanged
+    BasicDistanceProvider<ScaledMetric<EuclideanMetric> > minutes(coords, ScaledMetric<EuclideanMetric>(2.5));
+    Route timed = deliveries.greedy_route(minutes);
+    BasicDistanceProvider<ScaledMetric<EuclideanMetric> > timed_minutes(timed.get_coords(),
+                                                                       ScaledMetric<EuclideanMetric>(2.5));
+    if (timed.as_string() != deliveries.greedy_route(false).as_string() ||
+        std::abs(timed.length(timed_minutes) - 2.5 * timed.euc_length()) > 1e-6) {
+        return false;
+    }
+
+    // a policy metric matches the same metric passed as a function
+    BasicDistanceProvider<ChebyshevMetric> cheb(coords);
+    DistanceProvider cheb_fn(coords, chebyshev_metric);
+    if (cheb.kernel() != KERNEL_CUSTOM ||
+        deliveries.greedy_route(cheb).as_string() != deliveries.greedy_route(cheb_fn).as_string() ||
+        deliveries.opt2_rearrange(cheb).as_string() != deliveries.opt2_rearrange(cheb_fn).as_string() ||
+        deliveries.index_closest_to(Address(20, 80, 0), cheb) !=
+            deliveries.index_closest_to(Address(20, 80, 0), cheb_fn)) {
+        return false;
+    }
+
+    return true;
+}
+
+bool test_opt2_strategies() {
+    std::mt19937 gen(311);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+
+    Route deliveries(0);
+    AddressList points;
+    for (int i = 0; i < 200; i++) {
+        Address addr(coord(gen), coord(gen), 0);
+        deliveries.add_address(addr);
+        points.add_address(addr);
+    }
+
+    Opt2Strategy strategies[3] = { OPT2_FIRST, OPT2_BEST, OPT2_SWEEP };
+    for (int s = 0; s < 3; s++) {
+        for (int man = 0; man < 2; man++) {
+            double route_len = -1.0, list_len = -1.0;
+            Route route = deliveries.opt2_rearrange(man, strategies[s], &route_len);
+            AddressList list = points.opt2_rearrange(man, strategies[s], &list_len);
+
+            // the tracked length is the real one, and the depots stay put
+            double real_route = man ? route.man_length() : route.euc_length();
+            double real_list = man ? list.man_length() : list.euc_length();
+            if (std::abs(route_len - real_route) > 1e-6 ||
+                std::abs(list_len - real_list) > 1e-6 ||
+                route.size() != deliveries.size() ||
+                route.get_address_at(0) != deliveries.get_address_at(0) ||
+                route.get_final_addr() != deliveries.get_final_addr()) {
+                return false;
+            }
+
+            // every strategy ends at a 2-opt local optimum
+            DistanceProvider dists(route.get_coords(), man ? manhattan_metric : euclidean_metric);
+            vector<int> tour(route.size());
+            for (int i = 0; i < (int) tour.size(); i++) {
+                tour[i] = i;
+            }
+            Opt2Result again = opt2_improve(dists, tour, true, OPT2_FIRST);
+            if (again.moves != 0 || again.passes != 1 ||
+                std::abs(again.length - real_route) > 1e-6) {
+                return false;
+            }
+        }
+    }
+
+    // the default strategy is first improvement
+    if (deliveries.opt2_rearrange(false).as_string() !=
+        deliveries.opt2_rearrange(false, OPT2_FIRST).as_string()) {
+        return false;
+    }
+
+    return true;
+}
+
+bool test_oropt() {
+    // reversals flip the shorter side but keep the cycle's adjacency
+    vector<int> cities;
+    for (int i = 0; i < 10; i++) {
+        cities.push_back(i);
+    }
+    CyclicTour cyc(cities, 10);
+    cyc.reverse(1, 7);
+    if (!((cyc.next(0) == 7 && cyc.next(1) == 8) || (cyc.prev(0) == 7 && cyc.prev(1) == 8))) {
+        return false;
+    }
+    cyc.exchange(0, cyc.next(0), 4, cyc.next(4));
+    vector<int> walk = cyc.walk_from(0);
+    vector<int> sorted_walk(walk);
+    std::sort(sorted_walk.begin(), sorted_walk.end());
+    if (sorted_walk != cities) return false;
+
+    std::mt19937 gen(4242);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+
+    for (int man = 0; man < 2; man++) {
+        Route deliveries(0);
+        AddressList points;
+        for (int i = 0; i < 1500; i++) {
+            Address addr(coord(gen), coord(gen), 0);
+            deliveries.add_address(addr);
+            points.add_address(addr);
+        }
+
+        Route greedy = deliveries.greedy_route(man);
+        NeighborLists nbrs(greedy.get_coords(), 8, man);
+        Route two = greedy.opt2_rearrange(man, nbrs);
+        Route three = greedy.oropt_rearrange(man, nbrs);
+
+        // same stops, depots in place, and shorter than 2-opt alone
+        if (three.size() != greedy.size() ||
+            three.get_address_at(0) != greedy.get_address_at(0) ||
+            three.get_final_addr() != greedy.get_final_addr()) {
+            return false;
+        }
+        vector<string> before, after;
+        for (int i = 0; i < greedy.size(); i++) {
+            before.push_back(greedy.get_address_at(i).as_string());
+            after.push_back(three.get_address_at(i).as_string());
+        }
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        if (before != after) return false;
+        double two_len = man ? two.man_length() : two.euc_length();
+        double three_len = man ? three.man_length() : three.euc_length();
+        if (three_len >= two_len) return false;
+
+        // the free-ended version may move the ends, and does no worse
+        AddressList list_greedy = points.greedy_route(man);
+        AddressList list_three = list_greedy.oropt_rearrange(
+            man, NeighborLists(list_greedy.get_coords(), 8, man));
+        double list_len = man ? list_three.man_length() : list_three.euc_length();
+        double list_greedy_len = man ? list_greedy.man_length() : list_greedy.euc_length();
+        if (list_three.size() != points.size() || list_len >= list_greedy_len) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_parallel_opt2() {
+    std::mt19937 gen(808);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+
+    Route deliveries(0);
+    for (int i = 0; i < 400; i++) {
+        deliveries.add_address(Address(coord(gen), coord(gen), 0));
+    }
+
+    for (int man = 0; man < 2; man++) {
+        double one_len = -1.0;
+        Route one = deliveries.opt2_rearrange_parallel(man, 1, &one_len);
+        double real_len = man ? one.man_length() : one.euc_length();
+        if (std::abs(one_len - real_len) > 1e-6 ||
+            one.get_address_at(0) != deliveries.get_address_at(0) ||
+            one.get_final_addr() != deliveries.get_final_addr() ||
+            one.size() != deliveries.size()) {
+            return false;
+        }
+
+        // the same route for any number of threads
+        for (int threads = 2; threads <= 5; threads++) {
+            if (deliveries.opt2_rearrange_parallel(man, threads).as_string() != one.as_string()) {
+                return false;
+            }
+        }
+
+        // and a 2-opt local optimum
+        DistanceProvider dists(one.get_coords(), man ? manhattan_metric : euclidean_metric);
+        vector<int> tour(one.size());
+        for (int i = 0; i < (int) tour.size(); i++) {
+            tour[i] = i;
+        }
+        if (opt2_improve(dists, tour, true, OPT2_FIRST).moves != 0) return false;
+    }
+
+    AddressList points;
+    for (int i = 0; i < 200; i++) {
+        points.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    double list_len = -1.0;
+    AddressList list = points.opt2_rearrange_parallel(false, 3, &list_len);
+    if (list.size() != points.size() || std::abs(list_len - list.euc_length()) > 1e-6 ||
+        list_len > points.opt2_rearrange(false, OPT2_FIRST).euc_length() * 1.10) {
+        return false;
+    }
+
+    return true;
+}
+
+bool test_multistart() {
+    // the pool runs every task, including ones submitted by tasks
+    std::atomic<int> done(0);
+    {
+        WorkPool pool(3);
+        for (int t = 0; t < 200; t++) {
+            pool.submit([&pool, &done, t]() {
+                if (t % 10 == 0) {
+                    pool.submit([&done]() { done++; });
+                }
+                done++;
+            });
+        }
+        pool.wait();
+        if (done.load() != 220) return false;
+    }
+
+    std::mt19937 gen(99);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    Route deliveries(0);
+    AddressList points;
+    for (int i = 0; i < 300; i++) {
+        Address addr(coord(gen), coord(gen), 0);
+        deliveries.add_address(addr);
+        points.add_address(addr);
+    }
+
+    for (int man = 0; man < 2; man++) {
+        Route best = deliveries.multistart_route(man, 12, 4, 7);
+        Route single = deliveries.multistart_route(man, 1, 1, 7);
+        if (best.size() != deliveries.size() ||
+            best.get_address_at(0) != deliveries.get_address_at(0) ||
+            best.get_final_addr() != deliveries.get_final_addr()) {
+            return false;
+        }
+
+        // more starts never do worse than the greedy start alone
+        double best_len = man ? best.man_length() : best.euc_length();
+        double single_len = man ? single.man_length() : single.euc_length();
+        if (best_len > single_len + 1e-9) return false;
+
+        // the same seed on one thread gives the same route
+        if (deliveries.multistart_route(man, 6, 1, 3).as_string() !=
+            deliveries.multistart_route(man, 6, 1, 3).as_string()) {
+            return false;
+        }
+    }
+
+    AddressList list = points.multistart_route(false, 8, 2, 5);
+    if (list.size() != points.size() ||
+        list.euc_length() > points.multistart_route(false, 1, 1, 5).euc_length() + 1e-9) {
+        return false;
+    }
+
+    return true;
+}
+
+bool test_fleet() {
+    std::mt19937 gen(515);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    vector<Address> addrs;
+    for (int i = 0; i < 600; i++) {
+        addrs.push_back(Address(coord(gen), coord(gen), i % 7));
+    }
+    Address depot(50, 50, 0);
+
+    for (int part = 0; part < 2; part++) {
+        for (int man = 0; man < 2; man++) {
+            Fleet fleet(depot, depot, 12, 60);
+            if (part == 0) {
+                fleet.assign_sweep(addrs);
+            } else {
+                fleet.assign_kmeans(addrs, 3);
+            }
+            fleet.optimize_routes(man, 4);
+            double before = man ? fleet.man_length() : fleet.euc_length();
+            fleet.exchange_stops(man);
+            double after = man ? fleet.man_length() : fleet.euc_length();
+
+            // every address is delivered exactly once, within capacity
+            vector<string> seen;
+            for (int t = 0; t < fleet.size(); t++) {
+                const Route &route = fleet.get_route(t);
+                if (route.size() - 2 > 60 || route.get_address_at(0) != depot ||
+                    route.get_final_addr() != depot) {
+                    return false;
+                }
+                for (int p = 1; p < route.size() - 1; p++) {
+                    seen.push_back(route.get_address_at(p).as_string());
+                }
+            }
+            vector<string> expect;
+            for (const Address &addr : addrs) {
+                expect.push_back(addr.as_string());
+            }
+            std::sort(seen.begin(), seen.end());
+            std::sort(expect.begin(), expect.end());
+            if (seen != expect || fleet.num_stops() != (int) addrs.size()) return false;
+
+            // moves between trucks only shorten the fleet
+            if (after > before + 1e-6) return false;
+        }
+    }
+
+    // the whole pipeline beats a single partition pass
+    Fleet planned(depot, depot, 12, 60);
+    planned.plan(addrs, false, PARTITION_KMEANS, 3);
+    Fleet partitioned(depot, depot, 12, 60);
+    partitioned.assign_kmeans(addrs);
+    if (planned.euc_length() >= partitioned.euc_length()) return false;
+
+    // capacity is enforced
+    try {
+        Fleet small(depot, depot, 2, 10);
+        small.assign_sweep(addrs);
+        return false;
+    } catch (const std::invalid_argument &) {
+    }
+
+    return true;
+}
+
 // Results
 
-int main() {
-    int total = 0;
-    int total_pass = 0;
+// arrival time at each address of route, driven in order from time 0
+vector<double> arrival_times(const AddressList &route, bool man_norm) {
+    vector<double> arrive(route.size(), 0.0);
+    for (int p = 1; p < route.size(); p++) {
+        const Address &a = route.get_address_at(p-1), &b = route.get_address_at(p);
+        arrive[p] = arrive[p-1] + (man_norm ? a.manhattan_dist(b) : a.euclidean_dist(b));
+    }
+    return arrive;
+}
 
-    cout << "Test Results:\n\n";
+bool test_deadlines() {
+    std::mt19937 gen(1111);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    std::uniform_int_distribution<int> due(200, 12000);
 
-    cout << "Addresses: ";
-    if (test_addresses()) {
-        cout << "success\n";
-        total_pass++;
-    } else {
-        cout << "failure\n";
+    for (int man = 0; man < 2; man++) {
+        Route route(Address(50, 50, 0), Address(50, 50, 0));
+        for (int i = 0; i < 300; i++) {
+            route.add_address(Address(coord(gen), coord(gen), due(gen)));
+        }
+
+        // lateness() agrees with driving the route by hand
+        vector<double> arrive = arrival_times(route, man);
+        double late = 0.0;
+        int count = 0;
+        for (int p = 1; p < route.size() - 1; p++) {
+            double over = arrive[p] - route.get_address_at(p).get_delivery_deadline();
+            if (over > 0) {
+                late += over;
+                count++;
+            }
+        }
+        int got_count = -1;
+        if (std::abs(route.lateness(man, &got_count) - late) > 1e-6 || got_count != count) {
+            return false;
+        }
+
+        // rearranging shortens the route, but no address gets later than
+        // the later of its deadline and its old arrival
+        Route shorter = route.deadline_rearrange(man);
+        vector<double> after = arrival_times(shorter, man);
+        double len = man ? route.man_length() : route.euc_length();
+        double new_len = man ? shorter.man_length() : shorter.euc_length();
+        if (new_len >= len || shorter.size() != route.size()) return false;
+        for (int p = 1; p < shorter.size() - 1; p++) {
+            const Address &addr = shorter.get_address_at(p);
+            int q = 1;
+            while (route.get_address_at(q) != addr) q++;
+            double allowed = std::max((double) addr.get_delivery_deadline(), arrive[q]);
+            if (after[p] > allowed + 1e-6) return false;
+        }
+        if (shorter.lateness(man) > route.lateness(man) + 1e-6) return false;
+
+        // deadline construction is much more punctual than plain greedy
+        Route timed = route.deadline_route(man);
+        Route greedy = route.greedy_route(man);
+        if (timed.size() != route.size() || timed.get_final_addr() != route.get_final_addr()) {
+            return false;
+        }
+        if (timed.lateness(man) >= greedy.lateness(man) * 0.5) return false;
+
+        // and, without deadlines, the search is plain 2-opt with relocation
+        Route relaxed(Address(50, 50, 0), Address(50, 50, 0));
+        for (int p = 1; p < route.size() - 1; p++) {
+            const Address &addr = route.get_address_at(p);
+            relaxed.add_address(Address(addr.get_x(), addr.get_y(), 1000000));
+        }
+        Route free_route = relaxed.deadline_rearrange(man);
+        Route opt2_route = relaxed.opt2_rearrange(man);
+        double free_len = man ? free_route.man_length() : free_route.euc_length();
+        double opt2_len = man ? opt2_route.man_length() : opt2_route.euc_length();
+        if (free_len > opt2_len * 1.05 || free_route.lateness(man) != 0.0) return false;
     }
-    total++;
+    return true;
+}
 
-    cout << "Greedy Routing: ";
-    if (test_greedy_route()) {
-        cout << "success\n";
-        total_pass++;
-    } else {
-        cout << "failure\n";
+bool test_incremental_insert() {
+    // index_of finds the first equal address, through inserts anywhere
+    AddressList list;
+    list.add_address(Address(1, 1, 0));
+    list.add_address(Address(2, 2, 0));
+    list.add_address(Address(1, 1, 0));
+    list.bulk_add_addresses({ Address(3, 3, 0), Address(2, 2, 0) });
+    if (list.index_of(Address(1, 1, 9)) != 0 || list.index_of(Address(2, 2, 0)) != 1 ||
+        list.index_of(Address(3, 3, 0)) != 3 || list.index_of(Address(4, 4, 0)) != -1) {
+        return false;
+    }
+    Route depots(Address(0, 0, 0), Address(0, 0, 0));
+    depots.add_unique_address(Address(5, 5, 8));
+    depots.add_unique_address(Address(5, 5, 3));
+    depots.add_unique_address(Address(5, 5, 6));
+    if (depots.size() != 3 || depots.get_address_at(1).get_delivery_deadline() != 3) {
+        return false;
     }
-    total++;
 
-    cout << "2-opt Modification: ";
-    if (test_opt2()) {
+    std::mt19937 gen(1212);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    for (int man = 0; man < 2; man++) {
+        Route base(Address(50, 50, 0), Address(0, 0, 0));
+        for (int i = 0; i < 1000; i++) {
+            base.add_address(Address(coord(gen), coord(gen), 0));
+        }
+        Route route = base.greedy_route(man);
+        route = route.oropt_rearrange(man, NeighborLists(route.get_coords(), 8, man));
+
+        // stream in late orders, some of them repeats
+        vector<Address> late;
+        for (int i = 0; i < 600; i++) {
+            if (i % 6 == 5) {
+                late.push_back(route.get_address_at(1 + i % 900));
+            } else {
+                late.push_back(Address(coord(gen), coord(gen), 0));
+            }
+        }
+        Route streamed = route, appended = route;
+        for (const Address &addr : late) {
+            streamed.insert_cheapest(addr, man);
+            appended.add_unique_address(addr);
+        }
+        if (streamed.size() != 1502 || appended.size() != 1502 ||
+            streamed.get_address_at(0) != Address(50, 50, 0) ||
+            streamed.get_final_addr() != Address(0, 0, 0)) {
+            return false;
+        }
+        for (int p = 0; p < streamed.size(); p++) {
+            int q = streamed.index_of(streamed.get_address_at(p));
+            if (q != p && !(p == streamed.size() - 1 && q == 0)) return false;
+            if (appended.index_of(streamed.get_address_at(p)) < 0) return false;
+        }
+
+        // close to reoptimizing from scratch
+        Route redone = appended.greedy_route(man);
+        redone = redone.oropt_rearrange(man, NeighborLists(redone.get_coords(), 8, man));
+        double streamed_len = man ? streamed.man_length() : streamed.euc_length();
+        double redone_len = man ? redone.man_length() : redone.euc_length();
+        if (streamed_len > redone_len * 1.1) return false;
+    }
+    return true;
+}
+
+bool test_instance_files() {
+    const string bin_path = "tester_instance.bin";
+    const string tsp_path = "tester_instance.tsp";
+    const string csv_path = "tester_instance.csv";
+    bool ok = true;
+
+    // binary files round-trip, and load as a view of the mapping
+    CoordStore coords;
+    vector<int> deadlines;
+    for (int i = 0; i < 1000; i++) {
+        coords.push_back(i * 0.5, -i * 0.25);
+        deadlines.push_back(i % 11);
+    }
+    save_binary_instance(bin_path, coords, deadlines);
+    Instance inst = load_binary_instance(bin_path);
+    ok = ok && inst.coords.is_view() && inst.coords.size() == 1000 && inst.deadlines == deadlines;
+    for (int i = 0; i < 1000 && ok; i++) {
+        ok = inst.coords.x_at(i) == coords.x_at(i) && inst.coords.y_at(i) == coords.y_at(i);
+    }
+
+    // an empty list takes the view over; changing it makes a copy
+    AddressList list;
+    list.add_instance(inst);
+    ok = ok && list.size() == 1000 && list.get_coords().is_view() &&
+         list.get_address_at(7).get_delivery_deadline() == 7 &&
+         list.get_coords().x_data() == inst.coords.x_data();
+    list.add_address(Address(-1, -1, 0));
+    ok = ok && !list.get_coords().is_view() && list.size() == 1001 &&
+         list.get_coords().x_at(999) == 499.5 && list.index_of(Address(-1, -1, 0)) == 1000;
+
+    Route route(Address(0, 1, 0), Address(0, 2, 0));
+    route.add_instance(inst);
+    ok = ok && route.size() == 1002 && route.get_final_addr() == Address(0, 2, 0) &&
+         route.get_address_at(1) == Address(0, 0, 0) && inst.coords.is_view();
+
+    // short or foreign files are rejected
+    std::FILE *file = std::fopen(bin_path.c_str(), "r+b");
+    std::fputc('X', file);
+    std::fclose(file);
+    try {
+        load_binary_instance(bin_path);
+        ok = false;
+    } catch (const std::runtime_error &) {
+    }
+
+    file = std::fopen(tsp_path.c_str(), "w");
+    std::fputs("NAME : tiny\nTYPE : TSP\nDIMENSION : 3\nEDGE_WEIGHT_TYPE : EUC_2D\n"
+               "NODE_COORD_SECTION\n1 1.5 2\n2 3 4e1\r\n3 -5 6\nEOF\n", file);
+    std::fclose(file);
+    Instance tsp = load_tsplib(tsp_path);
+    ok = ok && tsp.name == "tiny" && tsp.coords.size() == 3 && tsp.coords.y_at(1) == 40.0 &&
+         tsp.coords.x_at(2) == -5.0 && tsp.deadlines[0] == NO_DEADLINE;
+
+    file = std::fopen(tsp_path.c_str(), "w");
+    std::fputs("DIMENSION: 4\nNODE_COORD_SECTION\n1 0 0\n2 1 1\nEOF\n", file);
+    std::fclose(file);
+    try {
+        load_tsplib(tsp_path);
+        ok = false;
+    } catch (const std::runtime_error &) {
+    }
+
+    file = std::fopen(csv_path.c_str(), "w");
+    std::fputs("x,y,deadline\n1,2,3\n\n4.5, 5.5\n-1,-2,7\n", file);
+    std::fclose(file);
+    Instance csv = load_csv(csv_path);
+    ok = ok && csv.coords.size() == 3 && csv.coords.x_at(1) == 4.5 && csv.deadlines[0] == 3 &&
+         csv.deadlines[1] == NO_DEADLINE && csv.deadlines[2] == 7;
+
+    file = std::fopen(csv_path.c_str(), "w");
+    std::fputs("1,2\n3;4\n", file);
+    std::fclose(file);
+    try {
+        load_csv(csv_path);
+        ok = false;
+    } catch (const std::runtime_error &) {
+    }
+
+    // deadlines must fit in an int
+    file = std::fopen(csv_path.c_str(), "w");
+    std::fputs("1,2,3\n3,4,4294967296\n", file);
+    std::fclose(file);
+    try {
+        load_csv(csv_path);
+        ok = false;
+    } catch (const std::runtime_error &) {
+    }
+
+    std::remove(bin_path.c_str());
+    std::remove(tsp_path.c_str());
+    std::remove(csv_path.c_str());
+    return ok;
+}
+
+bool test_solver_stats() {
+    std::mt19937 gen(1515);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    Route route(Address(0, 0, 0), Address(100, 100, 0));
+    for (int i = 0; i < 300; i++) {
+        route.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    STATS_ONLY(int n = route.size();)
+
+    SolveStats stats;
+    int reports = 0, improve_reports = 0;
+    stats.on_progress = [&](const SolveStats &, SolvePhase phase) {
+        reports++;
+        improve_reports += phase == PHASE_IMPROVE;
+    };
+    Route greedy = route.greedy_route(false, &stats);
+    double final_len = 0.0;
+    Route improved = greedy.opt2_rearrange(false, OPT2_FIRST, &final_len, &stats);
+
+#ifdef ROUTE_STATS
+    // setup fills the table, one report per phase and per pass
+    if (stats.passes < 2 || stats.moves_applied < 1 ||
+        stats.moves_tried < stats.passes * (long) (n - 3) * (n - 2) / 2 ||
+        stats.dist_evals < (long) n * (n - 1) / 2 || std::abs(stats.length - final_len) > 1e-9) {
+        return false;
+    }
+    if (reports != 3 + stats.passes || improve_reports != 1 + stats.passes) return false;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        if (stats.phase_seconds[p] < 0.0) return false;
+    }
+    if (stats.phase_seconds[PHASE_IMPROVE] <= 0.0) return false;
+
+    // custom metrics count the greedy construction too
+    SolveStats custom;
+    BasicDistanceProvider<ChebyshevMetric> cheb(route.get_coords(), ChebyshevMetric(), DIST_ON_THE_FLY);
+    route.greedy_route(cheb, &custom);
+    if (custom.dist_evals != (long) (n - 2) * n) return false;
+#else
+    // without ROUTE_STATS nothing is recorded
+    if (stats.passes != 0 || stats.moves_tried != 0 || stats.dist_evals != 0 || reports != 0) {
+        return false;
+    }
+#endif
+
+    // instrumented or not, the route is the same
+    return improved.euc_length() == greedy.opt2_rearrange(false, OPT2_FIRST).euc_length();
+}
+
+bool test_solve_budget() {
+    std::mt19937 gen(1616);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+    AddressList list;
+    for (int i = 0; i < 1500; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route route(Address(0, 0, 0), Address(1000, 1000, 0));
+    for (int i = 0; i < 300; i++) {
+        route.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    NeighborLists nbrs(list.get_coords(), 8, false);
+
+    // without a budget every search runs to the end
+    bool converged = false;
+    AddressList full = list.opt2_rearrange(false, OPT2_FIRST, nullptr, nullptr, nullptr, &converged);
+    if (!converged) return false;
+    list.oropt_rearrange(false, nbrs, nullptr, &converged);
+    if (!converged) return false;
+
+    // a move limit stops early, with a route no longer than the input
+    SolveBudget few_moves(0.0, 5);
+    double len = 0.0;
+    AddressList cut = list.opt2_rearrange(false, OPT2_FIRST, &len, nullptr, &few_moves, &converged);
+    if (converged || cut.size() != list.size() || len >= list.euc_length() ||
+        len <= full.euc_length() || std::abs(cut.euc_length() - len) > 1e-6) {
+        return false;
+    }
+    cut = list.opt2_rearrange_parallel(false, 4, &len, &few_moves, &converged);
+    if (converged || cut.size() != list.size() || len >= list.euc_length()) return false;
+    Route fixed = route.opt2_rearrange(false, OPT2_SWEEP, nullptr, nullptr, &few_moves, &converged);
+    if (converged || fixed.size() != route.size() ||
+        !(fixed.get_address_at(0) == route.get_address_at(0)) ||
+        !(fixed.get_final_addr() == route.get_final_addr())) {
+        return false;
+    }
+
+    // a cancelled budget leaves the input as it is
+    std::atomic<bool> cancel(true);
+    SolveBudget cancelled(0.0, 0, &cancel);
+    if (!(list.opt2_rearrange(false, OPT2_FIRST, nullptr, nullptr, &cancelled, &converged).as_string() ==
+          list.as_string()) || converged) {
+        return false;
+    }
+    if (!(list.opt2_rearrange(false, nbrs, &cancelled, &converged).as_string() == list.as_string()) ||
+        converged) {
+        return false;
+    }
+    AddressList moved = list.oropt_rearrange(false, nbrs, &cancelled, &converged);
+    if (converged || moved.size() != list.size()) return false;
+
+    // a time limit bounds the search, which takes far longer in full
+    AddressList big;
+    for (int i = 0; i < 4000; i++) {
+        big.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    auto start = std::chrono::steady_clock::now();
+    SolveBudget timed(0.02);
+    AddressList quick = big.opt2_rearrange(false, OPT2_BEST, &len, nullptr, &timed, &converged);
+    double spent = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return !converged && quick.size() == big.size() && len <= big.euc_length() && spent < 1.0;
+}
+
+bool test_index_tour() {
+    std::mt19937 gen(1717);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    std::shared_ptr<AddressList> list = std::make_shared<AddressList>();
+    for (int i = 0; i < 400; i++) {
+        list->add_address(Address(coord(gen), coord(gen), 0));
+    }
+    std::shared_ptr<const AddressList> table = list;
+
+    // copies share the table
+    IndexTour tour(table);
+    IndexTour copy = tour;
+    if (&copy.get_table() != table.get() || tour.size() != 400 ||
+        std::abs(tour.euc_length() - table->euc_length()) > 1e-9) {
+        return false;
+    }
+
+    // optimizing in place matches the AddressList member
+    BasicDistanceProvider<EuclideanMetric> dists(table->get_coords(), EuclideanMetric());
+    Opt2Workspace work;
+    double len = 0.0;
+    AddressList expected = table->opt2_rearrange(dists, OPT2_FIRST, &len);
+    Opt2Result result = tour.opt2_optimize(dists, work);
+    if (!result.converged || std::abs(result.length - len) > 1e-9 ||
+        !(tour.as_list().as_string() == expected.as_string()) ||
+        !(copy.as_list().as_string() == table->as_string())) {
+        return false;
+    }
+
+    // once the workspace is warm, further solves allocate nothing
+    vector<int> order(400);
+    for (int i = 0; i < 400; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), gen);
+    IndexTour shuffled(table, order);
+    IndexTour again = shuffled;
+    NeighborLists nbrs(table->get_coords(), 8, false);
+    bool converged = false;
+    shuffled.opt2_optimize(dists, nbrs, work);
+    long allocs_before = heap_allocs.load();
+    again.opt2_optimize(dists, work, OPT2_BEST);
+    again.opt2_optimize(dists, nbrs, work, nullptr, &converged);
+    if (heap_allocs.load() != allocs_before || !converged ||
+        again.euc_length() >= table->euc_length()) {
+        return false;
+    }
+
+    // tours over a route keep its depots
+    Route route(Address(0, 0, 0), Address(100, 100, 0));
+    for (int i = 0; i < 50; i++) {
+        route.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    IndexTour route_tour(std::make_shared<Route>(route), true);
+    BasicDistanceProvider<ManhattanMetric> man(route.get_coords(), ManhattanMetric());
+    route_tour.opt2_optimize(man, work);
+    if (!(route_tour.as_route().as_string() == route.opt2_rearrange(true).as_string()) ||
+        route_tour.indices().front() != 0 || route_tour.indices().back() != 51) {
+        return false;
+    }
+
+    // orders that are not permutations are rejected
+    order[1] = order[0];
+    try {
+        IndexTour bad(table, order);
+        return false;
+    } catch (const std::invalid_argument &e) { }
+    return true;
+}
+
+bool test_anneal() {
+    std::mt19937 gen(1818);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    AddressList list;
+    for (int i = 0; i < 300; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+
+    // never worse than the local search it starts from
+    AddressList greedy = list.greedy_route(false);
+    NeighborLists nbrs(greedy.get_coords(), 8, false);
+    double start_len = greedy.oropt_rearrange(false, nbrs).euc_length();
+    AddressList annealed = list.anneal_route(false, 4, 60, 7, 4);
+    if (annealed.size() != list.size() || annealed.euc_length() > start_len + 1e-9) {
+        return false;
+    }
+    for (int i = 0; i < list.size(); i++) {
+        if (annealed.index_of(list.get_address_at(i)) < 0) return false;
+    }
+
+    // the same seed gives the same route on any number of threads
+    if (!(list.anneal_route(false, 4, 60, 7, 1).as_string() == annealed.as_string())) {
+        return false;
+    }
+
+    // routes keep their depots
+    Route route(Address(0, 0, 0), Address(100, 100, 0));
+    for (int i = 0; i < 100; i++) {
+        route.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route annealed_route = route.anneal_route(true, 3, 40, 11);
+    if (annealed_route.size() != route.size() ||
+        !(annealed_route.get_address_at(0) == route.get_address_at(0)) ||
+        !(annealed_route.get_final_addr() == route.get_final_addr())) {
+        return false;
+    }
+
+    // a spent budget still returns a complete route
+    std::atomic<bool> cancel(true);
+    SolveBudget cancelled(0.0, 0, &cancel);
+    return list.anneal_route(false, 4, 1000, 7, 0, &cancelled).size() == list.size();
+}
+
+bool test_hilbert() {
+    // a 16 x 16 lattice: the curve steps between neighboring points only
+    std::mt19937 gen(1919);
+    vector<Address> lattice;
+    for (int i = 0; i < 256; i++) {
+        lattice.push_back(Address(i % 16, i / 16, 0));
+    }
+    std::shuffle(lattice.begin() + 1, lattice.end(), gen);
+    AddressList grid;
+    grid.bulk_add_addresses(lattice);
+    AddressList curve = grid.hilbert_route(false);
+    if (curve.size() != 256 || !(curve.get_address_at(0) == grid.get_address_at(0))) {
+        return false;
+    }
+    for (int i = 1; i < 256; i++) {
+        const Address &a = curve.get_address_at(i - 1), &b = curve.get_address_at(i);
+        if (i > 1 && a.manhattan_dist(b) != 1.0) return false;
+        if (grid.index_of(b) < 0) return false;
+    }
+
+    // random stops: a reasonable start, and the same order in place
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+    AddressList list;
+    for (int i = 0; i < 2000; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    AddressList route = list.hilbert_route(true);
+    if (route.man_length() > 1.5 * list.greedy_route(true).man_length()) return false;
+    AddressList in_place = list;
+    in_place.hilbert_reorder(true);
+    if (!(in_place.as_string() == route.as_string())) return false;
+    for (int i = 0; i < list.size(); i++) {
+        if (in_place.index_of(route.get_address_at(i)) != i) return false;
+    }
+
+    // points with non-finite coordinates come last, in index order
+    CoordStore odd;
+    const double inf = std::numeric_limits<double>::infinity();
+    double odd_xs[] = { 0, inf, 5, 9, std::nan("") }, odd_ys[] = { 0, 0, 5, 9, 1 };
+    for (int i = 0; i < 5; i++) {
+        odd.push_back(odd_xs[i], odd_ys[i]);
+    }
+    vector<int> odd_order = hilbert_order(odd, 0, 5);
+    if (odd_order.size() != 5 || odd_order[0] != 0 || odd_order[3] != 1 || odd_order[4] != 4) {
+        return false;
+    }
+
+    // routes keep their depots
+    Route depots(Address(0, 0, 0), Address(1000, 0, 0));
+    for (int i = 0; i < 500; i++) {
+        depots.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route hilbert = depots.hilbert_route(false);
+    Route reordered = depots;
+    reordered.hilbert_reorder(false);
+    return hilbert.size() == depots.size() &&
+           hilbert.get_address_at(0) == depots.get_address_at(0) &&
+           hilbert.get_final_addr() == depots.get_final_addr() &&
+           reordered.as_string() == hilbert.as_string() &&
+           hilbert.euc_length() < depots.euc_length();
+}
+
+bool test_greedy_edge() {
+    std::mt19937 gen(2020);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+
+    // tiny lists come back as they are
+    for (int n = 0; n <= 3; n++) {
+        AddressList tiny;
+        for (int i = 0; i < n; i++) {
+            tiny.add_address(Address(coord(gen), coord(gen), 0));
+        }
+        AddressList built = tiny.greedy_edge_route(false);
+        if (built.size() != n || (n > 0 && !(built.get_address_at(0) == tiny.get_address_at(0)))) {
+            return false;
+        }
+    }
+
+    // a permutation from the first address, shorter than nearest-neighbor
+    AddressList list;
+    for (int i = 0; i < 2000; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    for (int norm = 0; norm < 2; norm++) {
+        bool man_norm = norm == 1;
+        AddressList route = list.greedy_edge_route(man_norm);
+        if (route.size() != list.size() || !(route.get_address_at(0) == list.get_address_at(0))) {
+            return false;
+        }
+        for (int i = 0; i < route.size(); i++) {
+            if (list.index_of(route.get_address_at(i)) < 0) return false;
+        }
+        double edge_len = man_norm ? route.man_length() : route.euc_length();
+        AddressList nn = list.greedy_route(man_norm);
+        if (edge_len >= (man_norm ? nn.man_length() : nn.euc_length())) return false;
+        if (!(list.greedy_edge_route(man_norm).as_string() == route.as_string())) return false;
+    }
+
+    // points off the map are still visited
+    AddressList stray = list;
+    stray.add_address(Address(std::numeric_limits<double>::infinity(), 0, 0));
+    if (stray.greedy_edge_route(false).size() != stray.size()) return false;
+
+    // routes keep their depots, even when the depots are close together
+    Route depots(Address(500, 500, 0), Address(501, 500, 0));
+    for (int i = 0; i < 500; i++) {
+        depots.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route built = depots.greedy_edge_route(true);
+    return built.size() == depots.size() &&
+           built.get_address_at(0) == depots.get_address_at(0) &&
+           built.get_final_addr() == depots.get_final_addr() &&
+           built.man_length() < depots.greedy_route(true).man_length();
+}
+
+bool test_batch_solve() {
+    // a plan of many small routes and a few large ones
+    std::mt19937 gen(2121);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+    std::uniform_int_distribution<int> small(0, 60);
+    vector<Route> plan;
+    for (int r = 0; r < 400; r++) {
+        int stops = (r % 100 == 7) ? 1500 : small(gen);
+        Route route(Address(coord(gen), coord(gen), 0), Address(coord(gen), coord(gen), 0));
+        for (int i = 0; i < stops; i++) {
+            route.add_address(Address(coord(gen), coord(gen), 0));
+        }
+        plan.push_back(route);
+    }
+
+    // matches solving one at a time, in order, whatever the threads
+    BatchPipeline pipeline(BATCH_GREEDY, BATCH_OROPT, true);
+    vector<Route> serial = plan, parallel = plan;
+    vector<BatchRouteStats> one = solve_batch(serial, pipeline, 1);
+    vector<BatchRouteStats> four = solve_batch(parallel, pipeline, 4);
+    if (one.size() != plan.size() || four.size() != plan.size()) return false;
+    for (int r = 0; r < (int) plan.size(); r++) {
+        Route expected = plan[r].greedy_route(true);
+        if (expected.size() > 3) {
+            NeighborLists nbrs(expected.get_coords(), BATCH_NEIGHBORS, true);
+            expected = expected.oropt_rearrange(true, nbrs);
+        }
+        if (expected.man_length() >= plan[r].man_length()) {
+            expected = plan[r];
+        }
+        const BatchRouteStats &stats = four[r];
+        if (!(parallel[r].as_string() == expected.as_string()) ||
+            !(serial[r].as_string() == expected.as_string())) {
+            return false;
+        }
+        if (stats.stops != plan[r].size() || stats.start_length != plan[r].man_length() ||
+            std::abs(stats.length - expected.man_length()) > 1e-6 || stats.length > stats.start_length ||
+            !stats.converged || stats.seconds < 0.0) {
+            return false;
+        }
+        if (!(parallel[r].get_address_at(0) == plan[r].get_address_at(0)) ||
+            !(parallel[r].get_final_addr() == plan[r].get_final_addr())) {
+            return false;
+        }
+    }
+
+    // a second pass starting from the solved routes keeps what it cannot beat
+    vector<BatchRouteStats> again = solve_batch(parallel, BatchPipeline(BATCH_KEEP, BATCH_NO_IMPROVE), 2);
+    for (int r = 0; r < (int) plan.size(); r++) {
+        if (!again[r].kept_input || again[r].length != again[r].start_length) return false;
+    }
+    vector<Route> none;
+    return solve_batch(none, pipeline).empty();
+}
+
+bool test_simulation() {
+    // removing stops keeps lookups and depots right, including repeats
+    Route small(Address(0, 0, 0), Address(0, 0, 0));
+    small.bulk_add_addresses({ Address(1, 1, 0), Address(2, 2, 0), Address(1, 1, 0),
+                               Address(3, 3, 0), Address(2, 2, 0) });
+    small.remove_stops({ 1, 5, 1 }, false);
+    if (small.size() != 5 || small.index_of(Address(1, 1, 0)) < 0 ||
+        small.index_of(Address(3, 3, 0)) < 0 || small.index_of(Address(2, 2, 0)) < 0 ||
+        small.get_address_at(0) != Address(0, 0, 0) || small.get_final_addr() != Address(0, 0, 0)) {
+        return false;
+    }
+    small.remove_stops({ 1, 2, 3 }, false);
+    if (small.size() != 2 || small.index_of(Address(2, 2, 0)) != -1) return false;
+    try {
+        small.remove_stops({ 0 }, false);
+        return false;
+    } catch (const std::invalid_argument &) { }
+
+    std::mt19937 gen(2222);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    Route base(Address(50, 50, 0), Address(50, 50, 0));
+    for (int i = 0; i < 1000; i++) {
+        base.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route route = base.greedy_route(true);
+    route = route.oropt_rearrange(true, NeighborLists(route.get_coords(), 8, true));
+    vector<int> gone;
+    for (int p = 3; p < route.size() - 1; p += 3) {
+        gone.push_back(p);
+    }
+    Route repaired = route;
+    repaired.remove_stops(gone, true);
+    if (repaired.size() != route.size() - (int) gone.size()) return false;
+    for (int p = 0; p < route.size(); p++) {
+        bool removed = std::find(gone.begin(), gone.end(), p) != gone.end();
+        if ((repaired.index_of(route.get_address_at(p)) < 0) != removed) return false;
+    }
+    for (int p = 1; p < repaired.size() - 1; p++) {
+        if (repaired.index_of(repaired.get_address_at(p)) != p) return false;
+    }
+    // and then takes insertions again
+    repaired.insert_cheapest(Address(-5, -5, 0), true);
+    if (repaired.index_of(Address(-5, -5, 0)) < 0) return false;
+
+    // a month of days: every order is accounted for, both ways alike
+    SimulationConfig config;
+    config.num_trucks = 4;
+    config.orders_per_day = 200;
+    config.stops_per_day = 55;
+    config.max_lead_days = 4;
+    Simulation incremental(config);
+    config.rebuild = true;
+    Simulation rebuilt(config);
+    long released = 0, delivered = 0;
+    double incremental_len = 0.0, rebuilt_len = 0.0;
+    DayReport a, b;
+    for (int d = 0; d < 30; d++) {
+        a = incremental.step();
+        b = rebuilt.step();
+        released += a.released;
+        delivered += a.delivered;
+        incremental_len += a.distance;
+        rebuilt_len += b.distance;
+        if (a.day != d || a.released != b.released || a.delivered != b.delivered ||
+            a.carried != b.carried || a.backlog != incremental.backlog()) {
+            return false;
+        }
+    }
+    if (released != delivered + incremental.backlog() || incremental.get_day() != 30) {
+        return false;
+    }
+    // only what the trucks had no room for is still due
+    int still_due = 0;
+    for (int t = 0; t < config.num_trucks; t++) {
+        const Route &plan = incremental.get_plan(t);
+        for (int p = 1; p < plan.size() - 1; p++) {
+            if (plan.get_address_at(p).get_delivery_deadline() < 30) still_due++;
+        }
+    }
+    return still_due == a.carried && incremental_len < rebuilt_len * 1.1;
+}
+
+bool test_lower_bound() {
+    // below the shortest route through a few points, found by brute force
+    std::mt19937 gen(2323);
+    std::uniform_real_distribution<double> coord(0.0, 100.0);
+    vector<Address> few;
+    for (int i = 0; i < 8; i++) {
+        few.push_back(Address(coord(gen), coord(gen), 0));
+    }
+    AddressList tiny;
+    tiny.bulk_add_addresses(few);
+    double shortest = std::numeric_limits<double>::infinity();
+    vector<int> order = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    do {
+        double len = 0.0;
+        for (int i = 1; i < 8; i++) {
+            len += few[order[i-1]].euclidean_dist(few[order[i]]);
+        }
+        shortest = std::min(shortest, len);
+    } while (std::next_permutation(order.begin(), order.end()));
+    LowerBound tiny_bound = tiny.lower_bound(false, 0.0, 500);
+    if (!tiny_bound.proven || tiny_bound.value > shortest + 1e-6 ||
+        tiny_bound.value < 0.9 * shortest) {
+        return false;
+    }
+
+    // routes need not start at the first address: from the middle of a
+    // line, the shortest route still runs end to end
+    AddressList line;
+    line.add_address(Address(5, 0, 0));
+    for (int x = 0; x <= 10; x++) {
+        line.add_address(Address(x, 0, 0));
+    }
+    LowerBound line_bound = line.lower_bound(false);
+    AddressList line_route = line.opt2_rearrange(false);
+    if (line_bound.value > 10.0 + 1e-6 || line_bound.value < 9.0 ||
+        line_bound.gap(line_route.euc_length()) < -1e-9) {
+        return false;
+    }
+
+    // a tight bound on a lattice, whose shortest route is known
+    AddressList grid;
+    for (int i = 0; i < 100; i++) {
+        grid.add_address(Address(i / 10, i % 10, 0));
+    }
+    LowerBound grid_bound = grid.lower_bound(true);
+    if (grid_bound.value > 99.0 + 1e-6 || grid_bound.value < 98.0) return false;
+
+    // below a good route, and not far below it
+    AddressList list;
+    for (int i = 0; i < 1000; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    NeighborLists nbrs(list.get_coords(), 8, false);
+    AddressList good = list.greedy_edge_route(false).oropt_rearrange(false, nbrs);
+    LowerBound bound = good.lower_bound(false);
+    if (!bound.proven || bound.value > good.euc_length() || bound.gap(good.euc_length()) > 0.2) {
+        return false;
+    }
+
+    // routes must end at their last depot
+    Route route(Address(0, 0, 0), Address(100, 100, 0));
+    for (int i = 0; i < 200; i++) {
+        route.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    Route good_route = route.greedy_route(true);
+    good_route = good_route.oropt_rearrange(true, NeighborLists(good_route.get_coords(), 8, true));
+    LowerBound route_bound = good_route.lower_bound(true);
+    if (!route_bound.proven || route_bound.value > good_route.man_length() ||
+        route_bound.value < route.get_address_at(0).manhattan_dist(route.get_final_addr())) {
+        return false;
+    }
+
+    // searches stop once within a gap of the bound
+    AddressList start = list.greedy_route(false);
+    double target = bound.value * 1.25;
+    SolveBudget budget;
+    budget.set_target_length(target);
+    bool converged = true;
+    AddressList stopped = start.opt2_rearrange(false, OPT2_FIRST, nullptr, nullptr, &budget,
+                                               &converged);
+    if (converged || stopped.euc_length() > target + 1e-6) return false;
+    converged = true;
+    stopped = start.oropt_rearrange(false, nbrs, &budget, &converged);
+    if (converged || stopped.euc_length() > target + 1e-6) return false;
+    converged = true;
+    stopped = start.opt2_rearrange(false, nbrs, &budget, &converged);
+    return !converged && stopped.euc_length() <= target + 1e-6;
+}
+
+bool test_coord_precision() {
+    // single precision: stored values are floats, and scans agree with
+    // double scans over them when no two distances nearly tie
+    std::mt19937 gen(2424);
+    std::uniform_real_distribution<double> coord(0.0, 1000.0);
+    CoordStore narrow;
+    narrow.set_precision(COORD_FLOAT32);
+    for (int i = 0; i < 1000; i++) {
+        double x = coord(gen), y = coord(gen);
+        narrow.push_back(x, y);
+        if (narrow.x_at(i) != (double) (float) x || narrow.y_at(i) != (double) (float) y) {
+            return false;
+        }
+    }
+    for (int q = 0; q < 50; q++) {
+        double qx = (float) coord(gen), qy = (float) coord(gen);
+        for (int man = 0; man < 2; man++) {
+            int wide = man ? argmin_manhattan(narrow.x_data(), narrow.y_data(), 1000, qx, qy)
+                           : argmin_sq_euclidean(narrow.x_data(), narrow.y_data(), 1000, qx, qy);
+            if (narrow.nearest(qx, qy, man) != wide) return false;
+        }
+    }
+
+    // fixed point: coordinates on the grid, exact ties to the lowest index
+    CoordStore grid;
+    grid.push_back(2.4, 0.0);
+    grid.push_back(0.0, 1.6);
+    grid.push_back(-2.0, 0.3);
+    grid.set_precision(COORD_FIXED);
+    if (grid.x_at(0) != 2.0 || grid.y_at(1) != 2.0 || grid.y_at(2) != 0.0) return false;
+    if (grid.nearest(0.0, 0.0, false) != 0 || grid.nearest(0.0, 0.0, true) != 0 ||
+        grid.nearest(0.2, 1.4, false) != 1) {
+        return false;
+    }
+    grid.push_back(std::numeric_limits<double>::infinity(), 0.0);
+    if (grid.nearest(100.0, 0.0, true) != 0) return false;
+    // queries off the grid are not rounded onto it: (0.6, 0.4) rounds
+    // to (1, 0), nearer (2, 0), but is itself nearer (0, 1)
+    CoordStore pair;
+    pair.set_precision(COORD_FIXED);
+    pair.push_back(2.0, 0.0);
+    pair.push_back(0.0, 1.0);
+    if (pair.nearest(0.6, 0.4, false) != 1 || pair.nearest(0.6, 0.4, true) != 1) return false;
+    CoordStore halves;
+    halves.set_precision(COORD_FIXED, 0.5);
+    halves.push_back(1.3, -0.7);
+    if (halves.x_at(0) != 1.5 || halves.y_at(0) != -0.5) return false;
+
+    // TSPLIB rounding, and exact lengths on the grid
+    RoundedEuclideanMetric rounded;
+    if (rounded(0, 0, 3, 4) != 5.0 || rounded(0, 0, 1, 1) != 1.0 || rounded(0, 0, 1, 2) != 2.0) {
+        return false;
+    }
+    AddressList list;
+    for (int i = 0; i < 500; i++) {
+        list.add_address(Address(coord(gen), coord(gen), 0));
+    }
+    AddressList fixed = list;
+    fixed.set_precision(COORD_FIXED);
+    AddressList route = fixed.greedy_route(true);
+    double len = route.man_length();
+    if (route.get_coords().get_precision() != COORD_FIXED || len != std::floor(len) ||
+        route.as_string() != fixed.greedy_route(true).as_string()) {
+        return false;
+    }
+    BasicDistanceProvider<RoundedEuclideanMetric> tsplib(fixed.get_coords());
+    double tsp_len = fixed.opt2_rearrange(tsplib).length(tsplib);
+    if (tsp_len != std::floor(tsp_len)) return false;
+
+    // nearest addresses agree with and without the spatial index
+    AddressList indexed = fixed;
+    indexed.build_spatial_index();
+    for (int q = 0; q < 200; q++) {
+        Address query(coord(gen), coord(gen), 0);
+        if (fixed.euc_index_closest_to(query) != indexed.euc_index_closest_to(query) ||
+            fixed.man_index_closest_to(query) != indexed.man_index_closest_to(query)) {
+            return false;
+        }
+    }
+
+    // addresses are found by their rounded coordinates
+    fixed.add_address(Address(2000.2, 0.4, 0));
+    if (fixed.index_of(Address(2000.0, 0.0, 0)) != 500 ||
+        fixed.index_of(Address(1999.9, -0.3, 0)) != 500 || fixed.index_of(Address(1e12, 0, 0)) != -1) {
+        return false;
+    }
+
+    // coordinates off the grid are refused, leaving the list as it was
+    try {
+        fixed.add_address(Address(1e9, 0.0, 0));
+        return false;
+    } catch (const std::invalid_argument &) { }
+    AddressList far = list;
+    far.add_address(Address(1e9, 0.0, 0));
+    try {
+        far.set_precision(COORD_FIXED, 1e-3);
+        return false;
+    } catch (const std::invalid_argument &) { }
+    try {
+        far.set_precision(COORD_FIXED, 0.0);
+        return false;
+    } catch (const std::invalid_argument &) { }
+    if (far.get_coords().get_precision() != COORD_DOUBLE || far.size() != 501 ||
+        fixed.size() != 501) {
+        return false;
+    }
+
+    // routes keep their depots through rounding
+    Route truck(Address(0.2, 0.2, 0), Address(10.4, 10.4, 0));
+    truck.set_precision(COORD_FIXED);
+    truck.insert_cheapest(Address(5.3, 5.1, 0), true);
+    if (truck.size() != 3 || !(truck.get_address_at(0) == Address(0, 0, 0)) ||
+        !(truck.get_final_addr() == Address(10, 10, 0)) || truck.index_of(Address(5, 5, 0)) != 1) {
+        return false;
+    }
+
+    // and keep rounding after stops are removed
+    Route van(Address(0, 0, 0), Address(10, 10, 0));
+    van.set_precision(COORD_FIXED, 0.5);
+    van.add_address(Address(1.2, 1.2, 0));
+    van.add_address(Address(4.1, 3.9, 0));
+    van.add_address(Address(7.4, 8.1, 0));
+    van.remove_stops({ 1 }, false);
+    if (van.get_coords().get_precision() != COORD_FIXED || van.get_coords().get_unit() != 0.5) {
+        return false;
+    }
+    van.add_address(Address(1.3, 2.7, 0));
+    if (van.index_of(Address(1.5, 2.5, 0)) < 0 || van.index_of(Address(1.3, 2.7, 0)) !=
+        van.index_of(Address(1.5, 2.5, 0))) {
+        return false;
+    }
+    try {
+        van.add_address(Address(1e9, 0.0, 0));
+        return false;
+    } catch (const std::invalid_argument &) { }
+    return van.size() == 5;
+}
+
+// shortest road distances from source by plain Dijkstra, roads two-way
+vector<double> road_dijkstra(const RoadGraph &graph, int source) {
+    int n = graph.nodes.size();
+    vector<vector<std::pair<int, double> > > adj(n);
+    for (int k = 0; k < (int) graph.from.size(); k++) {
+        adj[graph.from[k]].push_back(std::make_pair(graph.to[k], graph.length[k]));
+        adj[graph.to[k]].push_back(std::make_pair(graph.from[k], graph.length[k]));
+    }
+    vector<double> dist(n, std::numeric_limits<double>::infinity());
+    vector<bool> done(n, false);
+    dist[source] = 0.0;
+    for (int step = 0; step < n; step++) {
+        int v = -1;
+        for (int u = 0; u < n; u++) {
+            if (!done[u] && (v < 0 || dist[u] < dist[v])) v = u;
+        }
+        done[v] = true;
+        for (const auto &arc : adj[v]) {
+            dist[arc.first] = std::min(dist[arc.first], dist[v] + arc.second);
+        }
+    }
+    return dist;
+}
+
+bool test_road_network() {
+    // a 20 x 20 street grid with some streets missing and roads winding,
+    // plus two nodes joined only to each other
+    const string path = "tester_roads.txt";
+    std::mt19937 gen(2525);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    std::fputs("c test streets\np sp 402 0\n", file);
+    for (int i = 0; i < 400; i++) {
+        std::fprintf(file, "v %d %d %d\n", i + 1, 10 * (i % 20), 10 * (i / 20));
+    }
+    std::fputs("v 401 500 500\nv 402 510 500\na 401 402 10\n", file);
+    for (int i = 0; i < 400; i++) {
+        int right = (i % 20 < 19) ? i + 1 : -1, up = (i < 380) ? i + 20 : -1;
+        for (int j : { right, up }) {
+            if (j < 0 || unit(gen) < 0.2) continue;
+            double len = 10.0 * (1.0 + unit(gen));
+            std::fprintf(file, "a %d %d %.3f\n", i + 1, j + 1, len);
+            if (unit(gen) < 0.5) std::fprintf(file, "a %d %d %.3f\n", j + 1, i + 1, len + 5.0);
+        }
+    }
+    std::fclose(file);
+    RoadGraph graph = load_road_graph(path);
+    if (graph.nodes.size() != 402 || graph.nodes.x_at(401) != 510.0) return false;
+
+    // contraction hierarchy queries agree with Dijkstra
+    RoadNetwork network(graph);
+    for (int s : { 0, 57, 211, 399 }) {
+        vector<double> expected = road_dijkstra(graph, s);
+        vector<int> targets;
+        for (int t = 0; t < 402; t++) {
+            targets.push_back(t);
+            if (std::abs(network.node_distance(s, t) - expected[t]) > 1e-9 &&
+                !(std::isinf(expected[t]) && std::isinf(network.node_distance(s, t)))) {
+                return false;
+            }
+        }
+        vector<double> table = network.node_table({ s }, targets);
+        for (int t = 0; t < 400; t++) {
+            if (std::abs(table[t] - expected[t]) > 1e-9) return false;
+        }
+    }
+    // addresses snap to the connected streets, not the island
+    if (network.snap(505, 500) == 400 || network.snap(505, 500) == 401 ||
+        network.snap(11, 19) != 41) {
+        return false;
+    }
+
+    // routing on roads, with the table filled by rows, cached or on the fly
+    RoadMetric roads(std::make_shared<RoadNetwork>(graph));
+    AddressList list;
+    for (int i = 0; i < 150; i++) {
+        list.add_address(Address(190 * unit(gen), 190 * unit(gen), 0));
+    }
+    BasicDistanceProvider<RoadMetric> dense(list.get_coords(), roads, DIST_DENSE);
+    BasicDistanceProvider<RoadMetric> cached(list.get_coords(), roads, DIST_ROW_CACHE, 4096);
+    BasicDistanceProvider<RoadMetric> fly(list.get_coords(), roads, DIST_ON_THE_FLY);
+    for (int i = 0; i < 150; i += 7) {
+        for (int j = 0; j < 150; j += 3) {
+            double d = dense.dist(i, j);
+            if (std::abs(cached.dist(i, j) - d) > 1e-9 || std::abs(fly.dist(i, j) - d) > 1e-9 ||
+                d != dense.dist(j, i) || d < list.get_address_at(i).euclidean_dist(
+                                                 list.get_address_at(j)) - 1e-9) {
+                return false;
+            }
+        }
+        if (dense.dist(i, i) != 0.0) return false;
+    }
+    AddressList route = list.greedy_route(dense);
+    AddressList improved = route.opt2_rearrange(dense);
+    if (improved.size() != list.size() || improved.length(dense) > route.length(dense) + 1e-9 ||
+        route.length(dense) > list.length(dense)) {
+        return false;
+    }
+
+    // malformed files are refused
+    file = std::fopen(path.c_str(), "w");
+    std::fputs("v 1 0 0\na 1 2 5\n", file);
+    std::fclose(file);
+    bool refused = false;
+    try {
+        load_road_graph(path);
+    } catch (const std::runtime_error &) {
+        refused = true;
+    }
+    std::remove(path.c_str());
+    return refused;
+}
+
+int main() {
+    int total = 0;
+    int total_pass = 0;
+
+    cout << "Test Results:\n\n";
+
+    cout << "Addresses: ";
+    if (test_addresses()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Greedy Routing: ";
+    if (test_greedy_route()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "2-opt Modification: ";
+    if (test_opt2()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Coordinate Kernels: ";
+    if (test_coord_kernels()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Spatial Index: ";
+    if (test_spatial_index()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Neighbor-List 2-opt: ";
+    if (test_neighbor_opt2()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Distance Provider: ";
+    if (test_distance_provider()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Metric Policies: ";
+    if (test_metric_policies()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "2-opt Strategies: ";
+    if (test_opt2_strategies()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Or-opt: ";
+    if (test_oropt()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Parallel 2-opt: ";
+    if (test_parallel_opt2()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Multi-start: ";
+    if (test_multistart()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Fleet: ";
+    if (test_fleet()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Deadlines: ";
+    if (test_deadlines()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Incremental Insertion: ";
+    if (test_incremental_insert()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Instance Files: ";
+    if (test_instance_files()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Solver Statistics: ";
+    if (test_solver_stats()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Solve Budget: ";
+    if (test_solve_budget()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Index Tours: ";
+    if (test_index_tour()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Annealing: ";
+    if (test_anneal()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Hilbert Curve: ";
+    if (test_hilbert()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Greedy Edge: ";
+    if (test_greedy_edge()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Batch Solve: ";
+    if (test_batch_solve()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Simulation: ";
+    if (test_simulation()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Lower Bound: ";
+    if (test_lower_bound()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Coordinate Precision: ";
+    if (test_coord_precision()) {
+        cout << "success\n";
+        total_pass++;
+    } else {
+        cout << "failure\n";
+    }
+    total++;
+
+    cout << "Road Network: ";
+    if (test_road_network()) {
         cout << "success\n";
         total_pass++;
     } else {